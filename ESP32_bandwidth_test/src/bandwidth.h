@@ -0,0 +1,66 @@
+/**
+ * The sweep settings shared by the ESP32 build (main.cpp) and the host build
+ * (host_main.cpp) of the bandwidth test.
+ *
+ * @file bandwidth.h
+ * @author Philip Giacalone
+ */
+
+#ifndef BANDWIDTH_H
+#define BANDWIDTH_H
+
+#include <math.h>
+#include <stdio.h>
+
+#include "sweep.h"
+
+//Configurable items: the sweep
+#define SAMPLES_PER_SECOND  20000   // limited by adc1_get_raw() (about 10 usec per conversion)
+#define SWEEP_SPACING       SWEEP_LOG   // SWEEP_LOG or SWEEP_LINEAR
+#define START_FREQUENCY     20      // Hz
+#define STOP_FREQUENCY      9000    // Hz, below SAMPLES_PER_SECOND / 2
+#define BINS                48      // frequencies measured
+#define MIN_CYCLES          8       // each bin lasts at least this many cycles of its frequency...
+#define MIN_SAMPLES         256     // ...and at least this many samples
+#define AMPLITUDE           100     // DAC steps either side of mid-scale (at most 127)
+#define SETTLE_SAMPLES      2000    // samples at mid-scale before the sweep starts
+
+/**
+ * @brief Returns the sweep settings
+ */
+static inline sweep_config_t bandwidthConfig() {
+  sweep_config_t config;
+  config.spacing = SWEEP_SPACING;
+  config.start_frequency = START_FREQUENCY;
+  config.stop_frequency = STOP_FREQUENCY;
+  config.bins = BINS;
+  config.sample_rate = SAMPLES_PER_SECOND;
+  config.min_cycles = MIN_CYCLES;
+  config.min_samples = MIN_SAMPLES;
+  config.amplitude = AMPLITUDE;
+  config.settle_samples = SETTLE_SAMPLES;
+  return config;
+}
+
+/**
+ * @brief Formats one result as a CSV line: frequency, gain in dB relative to the first bin, phase
+ */
+static inline void formatBin(char *line, size_t size, const sweep_bin_t &bin, const sweep_bin_t &first) {
+  snprintf(line, size, "%.1f,%.2f,%.1f", bin.frequency, 20.0 * log10(bin.magnitude / first.magnitude), bin.phase);
+}
+
+/**
+ * @brief Returns the first bin that is more than 3 dB below the first bin, or -1 if there is none
+ */
+static inline int cutoffBin(const sweep_bin_t *bins, int count) {
+  for (int i = 1; i < count; i++){
+    if (bins[i].magnitude < bins[0].magnitude * M_SQRT1_2){
+      return i;
+    }
+  }
+  return -1;
+}
+
+#define CSV_HEADER          "Frequency (Hz),Gain (dB),Phase (degrees)"
+
+#endif // BANDWIDTH_H
@@ -0,0 +1,74 @@
+/**
+ * Host build of the bandwidth test (pio run -e native): the same sweep as on
+ * the ESP32, against a simulated RC low-pass filter instead of the DAC -> circuit
+ * -> ADC path. Prints the measured response next to the filter's exact response,
+ * and how long the sweep took to compute.
+ *
+ *   .pio/build/native/program [cutoff Hz]
+ *
+ * @file host_main.cpp
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sweep.h"
+#include "bandwidth.h"
+
+#define ADC_COUNTS_PER_DAC_STEP 16.0f   // 12-bit ADC, 8-bit DAC, same voltage range
+
+sweep_bin_t results[BINS];
+
+int main(int argc, char **argv) {
+  float cutoff = argc > 1 ? atof(argv[1]) : 1000.0f;
+
+  sweep_t sweep;
+  sweep_rc_t rc;
+  sweep_config_t config = bandwidthConfig();
+  if (!sweep_init(&sweep, &config, results)){
+    printf("Invalid sweep settings\n");
+    return 1;
+  }
+  sweep_rc_init(&rc, cutoff, SAMPLES_PER_SECOND, 128 * ADC_COUNTS_PER_DAC_STEP);
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  bool running = true;
+  while (running){
+    //the ADC rounds to whole counts
+    float response = sweep_rc_next(&rc, sweep_next(&sweep) * ADC_COUNTS_PER_DAC_STEP);
+    running = sweep_capture(&sweep, floorf(response + 0.5f));
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+  uint32_t samples = sweep_total_samples(&config);
+
+  printf("%s,Exact gain (dB),Exact phase (degrees)\n", CSV_HEADER);
+  float maxGainError = 0;
+  float maxPhaseError = 0;
+  char line[64];
+  for (int i = 0; i < BINS; i++){
+    float magnitude, phase;
+    sweep_rc_response(&rc, results[i].frequency, SAMPLES_PER_SECOND, &magnitude, &phase);
+    float gain = 20.0f * log10f(magnitude);
+    formatBin(line, sizeof(line), results[i], results[0]);
+    printf("%s,%.2f,%.1f\n", line, gain, phase);
+
+    float error = fabsf(20.0f * log10f(results[i].magnitude / (magnitude * ADC_COUNTS_PER_DAC_STEP)));
+    maxGainError = error > maxGainError ? error : maxGainError;
+    maxPhaseError = fabsf(results[i].phase - phase) > maxPhaseError ? fabsf(results[i].phase - phase) : maxPhaseError;
+  }
+  int cutoffIndex = cutoffBin(results, BINS);
+  if (cutoffIndex > 0){
+    printf("-3 dB between %.1f and %.1f Hz (RC cutoff %.1f Hz)\n",
+           results[cutoffIndex - 1].frequency, results[cutoffIndex].frequency, cutoff);
+  }
+  printf("max error %.3f dB, %.2f degrees\n", maxGainError, maxPhaseError);
+  printf("%u samples (%.1f seconds on the ESP32) computed in %.1f ms (%.0fx real time)\n",
+         samples, (double)samples / SAMPLES_PER_SECOND, seconds * 1000.0,
+         samples / (double)SAMPLES_PER_SECOND / seconds);
+  return 0;
+}
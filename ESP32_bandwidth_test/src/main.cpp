@@ -1,36 +1,111 @@
-#include <Wire.h>
+/**
+ * Measures the frequency response (bandwidth) of a circuit connected between
+ * a DAC pin (the stimulus) and an ADC pin (the response), e.g. an RC filter or
+ * an amplifier, with a swept sine (see lib/sweep).
+ *
+ * Every sample, paced by the CPU cycle counter at SAMPLES_PER_SECOND:
+ *  1) the next value of a phase-continuous chirp is written to the DAC (isr_dac_write())
+ *  2) the response is read from the ADC
+ *  3) Goertzel filters at the current bin's frequency accumulate the stimulus and the response
+ *
+ * The gain and phase of each bin are then printed as CSV (paste into a spreadsheet to plot).
+ * Send any character over the serial port to sweep again.
+ *
+ * The ADC conversion time delays the response a little, which shows up as extra phase lag
+ * (about 360 * frequency * delay degrees). Connect the DAC pin straight to the ADC pin
+ * to measure it.
+ *
+ * The same sweep runs on the host against a simulated RC filter (see host_main.cpp).
+ *
+ * @file main.cpp
+ * @author Philip Giacalone
+ */
+
 #include <Arduino.h>
+#include "driver/dac.h"
+#include "driver/adc.h"
+#include "isr_safe.h"
+#include "sweep.h"
+#include "bandwidth.h"
 
-unsigned long duration  = 60000;  //milliseconds
-int OUTPUT_PIN          = 25;     //DAC_1
+#define DAC_CHANNEL         DAC_CHANNEL_1   // GPIO25, the stimulus
+#define ADC_CHANNEL         ADC1_CHANNEL_6  // GPIO34, the response
 
-void setup(void) {
+sweep_bin_t results[BINS];
+
+/**
+ * @brief Plays the sweep and captures the response
+ *
+ * @return the number of samples that started late (the ADC could not keep up)
+ */
+uint32_t runSweep() {
+  sweep_t sweep;
+  sweep_config_t config = bandwidthConfig();
+  if (!sweep_init(&sweep, &config, results)){
+    Serial.println("Invalid sweep settings");
+    return 0;
+  }
+
+  uint32_t cyclesPerSample = getCpuFrequencyMhz() * 1000000UL / SAMPLES_PER_SECOND;
+  uint32_t late = 0;
+  uint32_t next = isr_cycle_count();
+  bool running = true;
+  while (running){
+    while ((int32_t)(isr_cycle_count() - next) < 0){
+      //wait for the sample time
+    }
+    next += cyclesPerSample;
+    isr_dac_write(DAC_CHANNEL, sweep_next(&sweep));
+    running = sweep_capture(&sweep, adc1_get_raw(ADC_CHANNEL));
+    if ((int32_t)(isr_cycle_count() - next) > 0){
+      late++;
+    }
+  }
+  isr_dac_write(DAC_CHANNEL, 128);
+  return late;
+}
+
+/**
+ * @brief Runs a sweep and prints the results
+ */
+void measure() {
+  sweep_config_t config = bandwidthConfig();
+  Serial.printf("Sweeping %d to %d Hz (%u samples, %.1lf seconds) \n", START_FREQUENCY, STOP_FREQUENCY,
+    sweep_total_samples(&config), (double)sweep_total_samples(&config) / SAMPLES_PER_SECOND);
+
+  uint32_t late = runSweep();
 
+  Serial.println(CSV_HEADER);
+  char line[64];
+  for (int i = 0; i < BINS; i++){
+    formatBin(line, sizeof(line), results[i], results[0]);
+    Serial.println(line);
+  }
+  int cutoff = cutoffBin(results, BINS);
+  if (cutoff > 0){
+    Serial.printf("-3 dB between %.1f and %.1f Hz \n", results[cutoff - 1].frequency, results[cutoff].frequency);
+  }
+  if (late > 0){
+    Serial.printf("%u samples were late, lower SAMPLES_PER_SECOND \n", late);
+  }
+}
+
+void setup(void) {
   Serial.begin(115200);
   delay(500);
-  Serial.println("Frequency,Amplitude ");
 
-  //setup an array of sine values to be output
-  int arraySize = 360;
-  float values[arraySize];
+  dac_output_enable(DAC_CHANNEL);
+  adc1_config_width(ADC_WIDTH_BIT_12);
+  adc1_config_channel_atten(ADC_CHANNEL, ADC_ATTEN_DB_11);  //the full 0 to 3.3V range of the DAC
 
-  for (int i = 0; i < arraySize; i++) {
-    float omega = 2.0 * PI * ((float)i);
-    int value = 255 * sin(2 * PI * omega) + 128;
-    values[i] = value;
-  }
+  measure();
+}
 
-  unsigned long start = millis();
-  unsigned long now = millis();
-  while ((now - start) < duration) {
-    for (int i = 0; i < arraySize; i++) {
-      dacWrite(OUTPUT_PIN, values[i]);
-      now = millis();
-      delay(10);
+void loop(void) {
+  if (Serial.available() > 0){
+    while (Serial.available() > 0){
+      Serial.read();
     }
+    measure();
   }
 }
-
-void loop(void) {
-  //do nothing
-}
\ No newline at end of file
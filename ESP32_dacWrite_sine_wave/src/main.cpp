@@ -1,49 +1,60 @@
 #include <Arduino.h>
+#include "wave_table.h"
+#include "dds.h"
 
 #define UNDEFINED_WAVE  0
 #define SINE_WAVE       1
 #define SQUARE_WAVE     2
 #define TRIANGLE_WAVE   3
-
-const float deg_to_rad = PI/180;
+#define SAWTOOTH_WAVE   4
+#define PULSE_WAVE      5
 
 //ESP32 has two 8-bit DAC (digital to analog converter) channels, connected to GPIO25 (Channel 1) and GPIO26 (Channel 2)
 //out_voltage = Vref * digi_val / 255
 //Vref is internal (ESP32 does NOT support an external voltage reference)
 int OUTPUT_PIN = 25;
 
-int WAVE_TYPE = SINE_WAVE;
+#define WAVE_TYPE           SINE_WAVE
+#define SAMPLES_PER_CYCLE   360     // dacWrite() calls per cycle of the waveform (one per degree)
+#define HARMONICS           11      // the highest harmonic of the square, triangle, sawtooth and pulse waves
+#define PULSE_DUTY          0.25    // PULSE_WAVE: the fraction of the cycle that is high
+#define WAVE_TABLE_BITS     10      // the wave table holds 2^10 = 1024 samples of one cycle
+#define DAC_AMPLITUDE       80      // the output is DAC_MIDPOINT +/- DAC_AMPLITUDE
+#define DAC_MIDPOINT        128     // 255= 3.3V 128=1.65V
 
-float angles[360] = {};
+//harmonics at or above SAMPLES_PER_CYCLE/2 would fold back (alias) to lower frequencies
+static_assert(HARMONICS <= wave_table::maxHarmonic(1, SAMPLES_PER_CYCLE), "HARMONICS must be below SAMPLES_PER_CYCLE/2");
 
-void setup() {
-  Serial.begin(115200);
+constexpr wave_table::Shape waveShape() {
+  return WAVE_TYPE == SQUARE_WAVE   ? wave_table::Shape::Square
+       : WAVE_TYPE == TRIANGLE_WAVE ? wave_table::Shape::Triangle
+       : WAVE_TYPE == SAWTOOTH_WAVE ? wave_table::Shape::Sawtooth
+       : WAVE_TYPE == PULSE_WAVE    ? wave_table::Shape::Pulse
+       : wave_table::Shape::Sine;
 }
 
-boolean firstLoop = true;
+//one band-limited cycle of the waveform, computed by the compiler (see lib/wave_table).
+//this replaces summing 5 or 6 sin() (and pow()) calls for every sample.
+constexpr auto waveValues = wave_table::makeWaveCycle<1 << WAVE_TABLE_BITS>(
+  waveShape(), HARMONICS, 1.0, DAC_AMPLITUDE, (double)DAC_MIDPOINT / DAC_AMPLITUDE, PULSE_DUTY);
 
-void loop() {
-  //store the angles in an array 
-  if (firstLoop == true) {
-    for (int deg = 0; deg < 360; deg++){
-      angles[deg] = deg * deg_to_rad;
-      firstLoop = false;
-    }
-  }
+//steps through the waveValues, SAMPLES_PER_CYCLE steps per cycle (see lib/dds)
+dds_table_player_t wavePlayer;
 
-  for (int deg = 0; deg < 360; deg++){
-    float val = angles[deg];
-//    printf("Angle in Radians = %f\n", val);
+void setup() {
+  Serial.begin(115200);
+  //one cycle per SAMPLES_PER_CYCLE calls to dds_table_next()
+  dds_table_init(&wavePlayer, waveValues.values, WAVE_TABLE_BITS, 1.0, SAMPLES_PER_CYCLE);
+}
 
-    if (WAVE_TYPE == SINE_WAVE){
-      dacWrite(25, int(100 + 64 * (sin(angles[deg]))));
-    } else if (WAVE_TYPE == SQUARE_WAVE){
-      dacWrite(OUTPUT_PIN, int(128 + 80 * (sin(angles[deg])+sin(3*angles[deg])/3+sin(5*angles[deg])/5+sin(7*angles[deg])/7+sin(9*angles[deg])/9+sin(11*angles[deg])/11)));
-    } else if (WAVE_TYPE == TRIANGLE_WAVE){
-      dacWrite(OUTPUT_PIN, int(128 + 80 * (sin(angles[deg])+1/pow(3,2)*sin(3*angles[deg])+1/pow(5,2)*sin(5*angles[deg])+1/pow(7,2)*sin(7*angles[deg])+1/pow(9,2)*sin(9*angles[deg])))); 
+void loop() {
+  for (int i = 0; i < SAMPLES_PER_CYCLE; i++){
+    if (WAVE_TYPE != UNDEFINED_WAVE){
+      // one table read per sample, whatever the shape
+      dacWrite(OUTPUT_PIN, dds_table_next(&wavePlayer));
     } else {
       //default to this...
-      dacWrite(DAC1, 128);//255= 3.3V 128=1.65V
+      dacWrite(DAC1, DAC_MIDPOINT);//255= 3.3V 128=1.65V
       delay(100);
     }
   }
@@ -51,7 +62,5 @@ void loop() {
 
 // Square wave   = amplitude . sin(x) + sin(3.x) / 3 +  sin (5.x) / 5 + sin (7.x) / 7  + sin (9.x) / 9  + sin (11.x) / 11  Odd harmonics
 // Triangle wave = amplitude . sin(x) - 1/3^2.sin(3.x) +  1/5^2.sin(5.x) - 1/7^2.sin (7.x) + 1/9^2.sin(9.x) - 1/11^2.sin (11.x) Odd harmonics
-// dacWrite(25, int(128 + 80 * (sin(angles[deg])))); // GPIO Pin mode (OUTPUT) is set by the dacWrite function
-// dacWrite(25, int(128 + 80 * (sin(angles[deg])+sin(3*angles[deg])/3+sin(5*angles[deg])/5+sin(7*angles[deg])/7+sin(9*angles[deg])/9+sin(11*angles[deg])/11))); // Square
-// dacWrite(25, int(128 + 80 * (sin(angles[deg])+1/pow(3,2)*sin(3*angles[deg])+1/pow(5,2)*sin(5*angles[deg])+1/pow(7,2)*sin(7*angles[deg])+1/pow(9,2)*sin(9*angles[deg])))); // Triangle
-
+// Sawtooth wave = amplitude . sin(x) - sin(2.x) / 2 + sin(3.x) / 3 - sin(4.x) / 4 ...  All harmonics
+// These sums are now done once, by wave_table::makeWaveCycle(), when the code is compiled.
@@ -32,7 +32,14 @@ f is the frequency of the wave in cycles per second
 
 */
 
-#include "FastTrig.h"
+#include "dds.h"
+#include "envelope.h"
+#include "fast_trig.h"
+#include "time_base.h"
+#include "block_buffer.h"
+#include "isr_safe.h"
+#include "modulation.h"
+#include "cycle_probe.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -55,6 +62,7 @@ f is the frequency of the wave in cycles per second
 
 
 #define VERSION         1      //used to switch from v0 (old) to v1 (new) code
+#define TRIG_TIER       FAST_TRIG_POLY     //the sine of v0, one of the tiers of lib/fast_trig
 
 // configurable setting
 #define SAMPLES_PER_SECOND          100000   //max is ~1800 for ESP32 boards
@@ -70,6 +78,7 @@ int callbackInMicroseconds = 100;
 
 // holds the variables needed by the waveform equation
 // y(t) = A * e^(-at) * sin(2πft + φ)
+// the attack, sustain and release fields extend e^(-at) into an ADSR envelope
 struct waveform {
     // f - frequency in cycles/second
     float frequency;    
@@ -81,11 +90,37 @@ struct waveform {
     float decay;
     // vertical offset
     float y_offset;
+    // seconds to ramp up from zero to A (0.0 for no attack)
+    float attack;
+    // level (0.0 to 1.0) that the decay settles at
+    float sustain;
+    // controls the decay rate after the envelope is released
+    float release;
+    // DDS_MODE_TABLE (sine table lookup) or DDS_MODE_ROTOR (recurrence, no table)
+    dds_mode_t mode;
+    // MODULATION_NONE (mixed into the output), or MODULATION_AM, MODULATION_FM or MODULATION_PM:
+    // not heard, modulates waveforms[modulates] instead. see lib/modulation
+    modulation_type_t modulation;
+    // index of the waveform that this one modulates (the carrier)
+    int modulates;
+    // AM: 0.0 to 1.0 of the carrier's amplitude, FM: peak deviation in Hz, PM: peak deviation in radians
+    float depth;
 };
 
-struct waveform waveforms[];
+#define MAX_WAVEFORMS   8
+
+struct waveform waveforms[MAX_WAVEFORMS];
 int waveCount;
 
+// one DDS voice (phase accumulator) per waveform. see lib/dds
+dds_voice_t voices[MAX_WAVEFORMS];
+// one envelope per waveform, replaces pow(M_E, -at) per sample. see lib/envelope
+envelope_t envelopes[MAX_WAVEFORMS];
+// where each modulating waveform's value goes, and the modulation collected for each carrier
+modulation_route_t routes[MAX_WAVEFORMS];
+modulation_input_t mod_inputs[MAX_WAVEFORMS];
+bool carriers[MAX_WAVEFORMS];
+
 void setupWaveforms(){
 
     waveCount = 1;
@@ -97,17 +132,178 @@ void setupWaveforms(){
     w1.phase_angle = 1.57;
     w1.decay = 0.02;
     w1.y_offset = 1.0;  //must be set to 1.0 to avoid negative voltage outputs
+    w1.attack = 0.0;
+    w1.sustain = 0.0;   //0.0 gives the plain e^(-at) decay
+    w1.release = 0.0;
+    w1.mode = DDS_MODE_TABLE;
+    w1.modulation = MODULATION_NONE;
+    w1.modulates = -1;  //ignored unless modulation is set
+    w1.depth = 0.0;
 
     waveforms[0] = w1;
 
+    // struct waveform vibrato;    //a 6 Hz vibrato of w1, +-20 Hz
+    // vibrato.frequency = 6.0;
+    // vibrato.amplitude = 1.0;
+    // vibrato.phase_angle = 0.0;
+    // vibrato.decay = 0.0;
+    // vibrato.y_offset = 0.0;     //ignored, a modulator's value is bipolar
+    // vibrato.attack = 0.0;
+    // vibrato.sustain = 1.0;
+    // vibrato.release = 0.0;
+    // vibrato.mode = DDS_MODE_TABLE;
+    // vibrato.modulation = MODULATION_FM;
+    // vibrato.modulates = 0;
+    // vibrato.depth = 20.0;
+
+    // waveforms[1] = vibrato;
+
     // struct waveform w2;
     // w2.frequency = 1000.0;
     // w2.amplitude = 0.2;
     // w2.phase_angle = 3.14;
     // w2.decay = 0.02;
     // w1.y_offset = 1.0;  //must be set to 1.0 to avoid negative voltage outputs
+    // w2.mode = DDS_MODE_ROTOR;
 
     // waveforms[1] = w2;
+
+    // the timer period is a whole number of microseconds, so use the real sample rate
+    double sampleRate = (double)MICROSECONDS_PER_SECOND / MICROSECONDS_PER_SAMPLE;
+    dds_init();
+    for (int i=0; i<waveCount; i++){
+        carriers[i] = false;
+    }
+    for (int i=0; i<waveCount; i++){
+        struct waveform w = waveforms[i];
+        double y_offset = w.modulation == MODULATION_NONE ? w.y_offset : 0.0;
+        dds_voice_init(&voices[i], w.frequency, w.amplitude, w.phase_angle, y_offset, sampleRate);
+        dds_voice_set_mode(&voices[i], w.mode);
+        envelope_init(&envelopes[i], w.attack, w.decay, w.sustain, w.release, sampleRate);
+        envelope_trigger(&envelopes[i]);
+
+        // a route to a waveform that does not exist is dropped (the modulator stays silent)
+        bool valid = w.modulation != MODULATION_NONE && w.modulates >= 0 && w.modulates < waveCount;
+        modulation_route_init(&routes[i], valid ? w.modulation : MODULATION_NONE, valid ? w.modulates : 0,
+                              w.depth, sampleRate);
+        if (valid) {
+            carriers[w.modulates] = true;
+        }
+        modulation_input_clear(&mod_inputs[i]);
+    }
+}
+
+// the waveforms are rendered in blocks by render_task() and played by
+// periodic_timer_callback(), which only copies samples (see lib/block_buffer)
+static block_buffer_t sample_buffer;
+static TaskHandle_t render_task_handle = NULL;
+
+// computes the next sample of the sum of all the waveforms
+static uint8_t render_sample(void)
+{
+    // each voice advances its phase accumulator by a fixed increment per sample
+    // and looks up the sine table or rotates its recurrence, depending on its
+    // mode (no sin() per sample). see lib/dds
+    int32_t y = 0;  //Q15 sum of all the voices (DDS_Q15_ONE == 1.0)
+    for (int i=0; i<waveCount; i++){
+        // A * (y_offset + sin(2πft + φ)), a carrier also adds its AM, FM and PM inputs
+        int32_t sample = carriers[i] ? modulation_voice_next(&voices[i], &mod_inputs[i])
+                                     : dds_voice_next(&voices[i]);
+        // e^(-at), one multiply per sample
+        int32_t value = envelope_apply(&envelopes[i], sample);
+        if (waveforms[i].modulation == MODULATION_NONE) {
+            y += value;
+        } else {
+            // one multiply, into the carrier's inputs
+            modulation_apply(&routes[i], mod_inputs, value);
+        }
+    }
+    int output = (127 * y) >> 15;
+    if (output > 255){
+        output = 255;
+    } else if (output < 0){
+        output = 0;
+    }
+    return (uint8_t)output;
+}
+
+// fills every free block of the sample buffer
+static void render_blocks(void)
+{
+    uint8_t *block;
+    while ((block = block_buffer_acquire(&sample_buffer)) != NULL) {
+        for (int i = 0; i < BLOCK_BUFFER_SAMPLES; i++) {
+            block[i] = render_sample();
+        }
+        block_buffer_commit(&sample_buffer);
+    }
+}
+
+// renders a block, then sleeps until periodic_timer_callback() uses one up
+static void render_task(void* arg)
+{
+    while (true) {
+        render_blocks();
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+// VERSION 1 only reads the block buffer (integer math, IRAM and DRAM only),
+// so esp_timer can call it straight from its interrupt handler
+#define CALLBACK_DISPATCH   ESP_TIMER_ISR
+#else
+//data for each waveform (frequency, amplitude, phase angle, attenuation)
+static const float wave1[] = {100.0, 0.5, 0.0, 0.5};
+static const float wave2[] = {1000.0, 0.1, 0.0, 0.5};
+
+// the phase of each waveform is its increment times the samples played, instead of
+// 2πft with t from the clock, so it stays exact at any uptime and a late callback
+// does not move it. see lib/time_base
+static time_base_t time_base;
+static uint64_t wave1_increment, wave2_increment;
+static uint32_t wave1_phase, wave2_phase;   //φ
+
+static void setupTimeBase(){
+    time_base_init(&time_base, (double)MICROSECONDS_PER_SECOND / MICROSECONDS_PER_SAMPLE);
+    wave1_increment = time_base_increment(&time_base, wave1[0]);
+    wave2_increment = time_base_increment(&time_base, wave2[0]);
+    wave1_phase = fast_trig_phase(wave1[2]);
+    wave2_phase = fast_trig_phase(wave2[2]);
+}
+
+// VERSION 0 uses floats, so it has to run in the esp_timer task
+#define CALLBACK_DISPATCH   ESP_TIMER_TASK
+#endif
+
+// CPU cycles spent in each periodic_timer_callback() (see lib/isr_safe)
+static isr_cycle_stats_t callback_cycles;
+
+// the paths through periodic_timer_callback(), then the DAC write (see lib/cycle_probe)
+enum {
+    PROBE_VERSION_0,
+    PROBE_VERSION_1,
+    PROBE_VERSION_1_WAKE,
+    PROBE_PATHS,
+    PROBE_DAC_WRITE = PROBE_PATHS,
+    PROBES
+};
+
+#if CYCLE_PROBE_ENABLED
+static const char *const probe_names[PROBES] = {"version 0", "version 1", "version 1 +wake", "dac write"};
+static cycle_probe_table_t callback_probes;
+
+// the cycles of each path since the last call, as a table (the waveform benchmarks print the same on the host)
+static void printCycleProbes(){
+    static cycle_probe_table_t snapshot;
+    char line[96];
+    cycle_probe_take(&callback_probes, &snapshot);
+    printf("%s  (cycles, less %u for the probe)\n", CYCLE_PROBE_HEADER, (unsigned)snapshot.overhead);
+    for (uint32_t i = 0; i < snapshot.count; i++){
+        if (snapshot.probes[i].stats.count > 0){
+            cycle_probe_format(&snapshot, i, PROBE_PATHS, line, sizeof(line));
+            printf("%s\n", line);
+        }
+    }
 }
 #endif
 
@@ -129,11 +325,24 @@ static const char* TAG = "example";
 
 void app_main(void)
 {
+    #if VERSION == 0
+    fast_trig_init();   //fills the table of the FAST_TRIG_LUT tiers
+    setupTimeBase();
+    #endif
     #if VERSION == 1
     setupWaveforms();
+
+    block_buffer_init(&sample_buffer, 127);
+    render_blocks();    //both blocks are ready before the timer starts
+    // on the other core from the timer interrupt
+    xTaskCreatePinnedToCore(render_task, "render", 4096, NULL, configMAX_PRIORITIES - 4, &render_task_handle, 1);
     #endif
 
     dac_output_enable(DAC_CHANNEL_1);
+    isr_cycle_stats_reset(&callback_cycles);
+    #if CYCLE_PROBE_ENABLED
+    cycle_probe_init(&callback_probes, probe_names, PROBES);
+    #endif
 
     /* Create two timers:
      * 1. a periodic timer which will run every 0.5s, and print a message
@@ -145,6 +354,7 @@ void app_main(void)
 
     const esp_timer_create_args_t periodic_timer_args = {
             .callback = &periodic_timer_callback,
+            .dispatch_method = CALLBACK_DISPATCH,
             /* name is optional, but may help identify the timer when debugging */
             .name = "periodic"
     };
@@ -196,56 +406,73 @@ void app_main(void)
     // ESP_ERROR_CHECK(esp_timer_delete(periodic_timer));
     // ESP_ERROR_CHECK(esp_timer_delete(oneshot_timer));
     // ESP_LOGI(TAG, "Stopped and deleted timers");
+
+    /* Print the callback cost (and block buffer statistics) every 10 seconds */
+    while (true) {
+        vTaskDelay(10000 / portTICK_PERIOD_MS);
+        #if CYCLE_PROBE_ENABLED
+        printCycleProbes();
+        #endif
+        isr_cycle_stats_t cycles = callback_cycles;
+        isr_cycle_stats_reset(&callback_cycles);
+        ESP_LOGI(TAG, "callback cycles min/mean/max: %u/%u/%u (%u calls)",
+                 (unsigned)cycles.min, (unsigned)isr_cycle_stats_mean(&cycles),
+                 (unsigned)cycles.max, (unsigned)cycles.count);
+        #if VERSION == 1
+        block_buffer_stats_t stats = sample_buffer.stats;
+        ESP_LOGI(TAG, "blocks played: %u, underruns: %u, fill min/mean/max: %u/%u/%u samples",
+                 (unsigned)stats.blocks_played, (unsigned)stats.underruns, (unsigned)stats.min_fill,
+                 (unsigned)block_buffer_mean_fill(&sample_buffer), (unsigned)stats.max_fill);
+        #endif
+    }
 }
 
-static void periodic_timer_callback(void* arg)
+static void IRAM_ATTR periodic_timer_callback(void* arg)
 {
-    int64_t time_since_boot = esp_timer_get_time(); //microseconds
-    double _t_ = time_since_boot/1000000.0;
-    // ESP_LOGI(TAG, "Periodic timer called, time since boot: %lld us", time_since_boot);
+    uint32_t start_cycles = isr_cycle_count();
 
 #if VERSION == 1
 
-    // ------------- START new way not working --------------
-    float y = 0;  //the final value to be sent to the ESP32 output pin (between 0 and 255)
-    for (int i=0; i<waveCount; i++){
-        struct waveform w = waveforms[i];
-        // y(t) = A * e^(-at) * sin(2πft + 
-        float exponential = 1.0;
-        if (w.decay > 0){
-            exponential = pow(M_E, (-1) * w.decay * _t_);
+    // the waveform math runs in render_task(). this only plays the next rendered sample
+    uint8_t output;
+    bool released = block_buffer_read(&sample_buffer, &output);
+    if (released) {
+        // a block was used up, wake render_task() to render the next one
+        BaseType_t higher_priority_task_woken = pdFALSE;
+        vTaskNotifyGiveFromISR(render_task_handle, &higher_priority_task_woken);
+        if (higher_priority_task_woken) {
+            esp_timer_isr_dispatch_need_yield();
         }
-        float angle = M_TWOPI * w.frequency * _t_ + w.phase_angle;
-        //sum all the y values as floats in order to maintain resolution during the calculations
-        // y = y + ( w.amplitude * exponential * ( 127.0 + ( 127.0 * isin(angle) ))); //isin() FastTrig value lookup
-        y = y + (127 * w.amplitude * exponential * ( w.y_offset + isin(angle) )); //isin() FastTrig value lookup
     }
-    dac_output_voltage(DAC_CHANNEL_1, ((int)y));
-    // ------------- END new way not working --------------
+    // dac_output_voltage() is in flash, so write the DAC register directly
+    CYCLE_PROBE_BEGIN(write_cycles);
+    isr_dac_write(DAC_CHANNEL_1, output);
+    CYCLE_PROBE_END(&callback_probes, PROBE_DAC_WRITE, write_cycles);
+    CYCLE_PROBE_END(&callback_probes, released ? PROBE_VERSION_1_WAKE : PROBE_VERSION_1, start_cycles);
 
 #elif VERSION == 0
 
-//    -------- old way that was working ----------
-    //data for each waveform (frequency, amplitude, phase angle, attenuation)
-    float wave1[] = {100.0, 0.5, 0.0, 0.5};
-    float wave2[] = {1000.0, 0.1, 0.0, 0.5};
-
-    // ESP_LOGI(TAG, "Periodic timer called, time since boot: %lld us", time_since_boot);
-
     // formula for a sine wave with frequency (ω) amplitude (A) and phase angle (φ)
-    //   f(t) = A sin(ωt + φ)    
-    float waveform1 = (wave1[3] * ( ((float)127) + ( ((float)127) * (wave1[1] * (sin(M_TWOPI * wave1[0] * _t_ + wave1[2])))))); 
-    float waveform2 = (wave2[3] * ( ((float)127) + ( ((float)127) * (wave2[1] * (sin(M_TWOPI * wave2[0] * _t_ + wave2[2])))))); 
+    //   f(t) = A sin(ωt + φ), where ωt is the phase of the current sample
+    float sin1 = fast_trig_sin(TRIG_TIER, time_base_phase(&time_base, wave1_increment) + wave1_phase) / (float)FAST_TRIG_ONE;
+    float sin2 = fast_trig_sin(TRIG_TIER, time_base_phase(&time_base, wave2_increment) + wave2_phase) / (float)FAST_TRIG_ONE;
+    time_base_tick(&time_base);
+    float waveform1 = (wave1[3] * ( ((float)127) + ( ((float)127) * (wave1[1] * sin1)))); 
+    float waveform2 = (wave2[3] * ( ((float)127) + ( ((float)127) * (wave2[1] * sin2)))); 
     // printf("%.9f\t", now);
     // printf("%.3f\t", waveform1);
     // printf("%.3f\t", waveform2);
     int output = (int)(waveform1 + waveform2);
     // printf("%d\n", output);
     
+    CYCLE_PROBE_BEGIN(write_cycles);
     dac_output_voltage(DAC_CHANNEL_1, output);
+    CYCLE_PROBE_END(&callback_probes, PROBE_DAC_WRITE, write_cycles);
+    CYCLE_PROBE_END(&callback_probes, PROBE_VERSION_0, start_cycles);
 
 #endif
 
+    isr_cycle_stats_add(&callback_cycles, isr_cycle_count() - start_cycles);
 }
 
 // static void oneshot_timer_callback(void* arg)
@@ -0,0 +1,228 @@
+/**
+ * The runtime settings of the STATIC function generator. See generator.h
+ *
+ * @file generator.cpp
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "generator.h"
+
+const double MICROSECONDS_PER_SECOND = 1000000.0; //the timer has a resolution of 1 microsecond
+
+//the sample rate and DAC channel (0 here) are kept from the current settings
+const GeneratorSettings presets[] = {
+  {wave_table::Shape::Sine,     200.0,  0.5, 0, 0},
+  {wave_table::Shape::Square,   200.0,  0.5, 0, 0},
+  {wave_table::Shape::Triangle, 200.0,  0.5, 0, 0},
+  {wave_table::Shape::Sawtooth, 200.0,  0.5, 0, 0},
+  {wave_table::Shape::Pulse,    200.0,  0.5, 0, 0},
+  {wave_table::Shape::Square,   1000.0, 0.5, 0, 0},
+};
+const int presetCount = sizeof(presets) / sizeof(presets[0]);
+
+//a step up in frequency, a square wave that fades out, then two bursts of 5 cycles, over and over
+const SequenceStep sequenceSteps[] = {
+  {0.0,  SEQUENCER_TABLE,     (double)wave_table::Shape::Sine},
+  {0.0,  SEQUENCER_FREQUENCY, 200.0},
+  {0.0,  SEQUENCER_AMPLITUDE, 1.0},
+  {0.0,  SEQUENCER_GATE,      1},
+  {0.25, SEQUENCER_FREQUENCY, 400.0},
+  {0.5,  SEQUENCER_TABLE,     (double)wave_table::Shape::Square},
+  {0.5,  SEQUENCER_AMPLITUDE, 0.0, 0.25},
+  {0.75, SEQUENCER_TABLE,     (double)wave_table::Shape::Sine},
+  {0.75, SEQUENCER_AMPLITUDE, 1.0},
+  {0.75, SEQUENCER_FREQUENCY, 1000.0},
+  {0.75, SEQUENCER_BURST,     5},
+  {0.85, SEQUENCER_BURST,     5},
+  {1.0,  SEQUENCER_REPEAT},
+};
+const int sequenceStepCount = sizeof(sequenceSteps) / sizeof(sequenceSteps[0]);
+
+GeneratorSettings settings;
+dds_table_player_t wavePlayer;
+retune_t waveRetune;
+wave_cache::Cache<1 << WAVE_TABLE_BITS, PRESET_CACHE_TABLES> waveCache(MAX_DAC_AMPLITUDE);
+sequencer_t sequencer;
+
+//the sequenceSteps[] in samples, and the table of each shape they switch to (read by onTimer())
+static sequencer_event_t sequenceEvents[SEQUENCE_MAX_EVENTS];
+static const uint8_t *sequenceTables[(int)wave_table::Shape::Pulse + 1];
+
+static const char *shapeNames[] = {"sine", "square", "triangle", "sawtooth", "pulse"};
+
+const char *shapeName(wave_table::Shape shape) {
+  return shapeNames[(int)shape];
+}
+
+double timerSampleRate(double samplesPerSecond) {
+  return MICROSECONDS_PER_SECOND / (uint64_t)(MICROSECONDS_PER_SECOND / samplesPerSecond);
+}
+
+void generatorBegin(const GeneratorSettings &initial, const uint8_t *table) {
+  settings = initial;
+  dds_table_init(&wavePlayer, table, WAVE_TABLE_BITS, initial.frequency, timerSampleRate(initial.samplesPerSecond));
+  //the sine, square, triangle and sawtooth tables are all at their midpoint here
+  retune_init(&waveRetune, RETUNE_AT_ZERO_CROSSING, initial.dacChannel);
+}
+
+const char *parseCommand(const char *line, GeneratorSettings &next) {
+  char command;
+  char argument[16];
+  if (sscanf(line, " %c %15s", &command, argument) != 2){
+    return "expected a command and a value, e.g. \"f 440\"";
+  }
+  char *end;
+  double value = strtod(argument, &end);
+  bool isNumber = *end == '\0';
+
+  switch (command){
+    case 'f':
+      if (!isNumber) return "the frequency must be a number";
+      next.frequency = value;
+      return NULL;
+    case 'a':
+      if (!isNumber) return "the attenuation must be a number";
+      next.attenuation = value;
+      return NULL;
+    case 'r':
+      if (!isNumber) return "the sample rate must be a number";
+      next.samplesPerSecond = value;
+      return NULL;
+    case 'c':
+      if (!isNumber || (value != 1 && value != 2)) return "the DAC channel must be 1 or 2";
+      next.dacChannel = (uint32_t)value - 1;
+      return NULL;
+    case 'p': {
+      if (!isNumber || value < 0 || value >= presetCount || value != (int)value){
+        return "no such preset";
+      }
+      const GeneratorSettings &preset = presets[(int)value];
+      next.shape = preset.shape;
+      next.frequency = preset.frequency;
+      next.attenuation = preset.attenuation;
+      return NULL;
+    }
+    case 's':
+      for (int i = 0; i < (int)(sizeof(shapeNames) / sizeof(shapeNames[0])); i++){
+        if (strcasecmp(argument, shapeNames[i]) == 0){
+          next.shape = (wave_table::Shape)i;
+          return NULL;
+        }
+      }
+      return "the shape must be sine, square, triangle, sawtooth or pulse";
+    default:
+      return "unknown command (f, a, s, r, c or p)";
+  }
+}
+
+const char *requestSettings(const GeneratorSettings &next, bool *rendered) {
+  if (next.samplesPerSecond < 1.0 || next.samplesPerSecond > MICROSECONDS_PER_SECOND){
+    return "the sample rate must be between 1 and 1000000 samples per second";
+  }
+  double sampleRate = timerSampleRate(next.samplesPerSecond);
+  if (!wave_table::validFrequency(next.frequency, sampleRate)){
+    return "the frequency must be positive and at most half the sample rate";
+  }
+  if (!wave_table::validAttenuation(next.attenuation)){
+    return "the attenuation must be between 0.0 and 1.0";
+  }
+  if (next.dacChannel >= DAC_CHANNELS){
+    return "the DAC channel must be 1 or 2";
+  }
+  //the ISR still owns the previous parameter block
+  if (retune_pending(&waveRetune)){
+    return "the previous change has not been picked up yet";
+  }
+
+  wave_cache::Key key = {next.shape, (float)next.frequency, (float)next.attenuation, (float)sampleRate};
+  uint32_t misses = waveCache.stats().misses;
+  const uint8_t *table = waveCache.get(key);
+  if (table == NULL){
+    return "not enough memory to render the table";
+  }
+  *rendered = waveCache.stats().misses != misses;
+  //pins the new table and the one playing now, so neither is evicted while the ISR may read it
+  waveCache.setPlaying(table);
+
+  //a new sample rate goes with the increment computed for it, so onTimer() changes both on the same sample
+  uint32_t period = next.samplesPerSecond != settings.samplesPerSecond
+    ? (uint32_t)(MICROSECONDS_PER_SECOND / next.samplesPerSecond) : 0;
+  retune_params_t params = {table, dds_phase_increment(next.frequency, sampleRate), next.dacChannel, period};
+  retune_request(&waveRetune, &params);
+  settings = next;
+  return NULL;
+}
+
+const char *sequenceBegin() {
+  if (sequenceStepCount > SEQUENCE_MAX_EVENTS){
+    return "too many steps, raise SEQUENCE_MAX_EVENTS";
+  }
+  double sampleRate = timerSampleRate(settings.samplesPerSecond);
+  //every table is played at up to the highest frequency, so band limit them all there
+  double highest = settings.frequency;
+  for (int i = 0; i < sequenceStepCount; i++){
+    if (sequenceSteps[i].type == SEQUENCER_FREQUENCY && sequenceSteps[i].value > highest){
+      highest = sequenceSteps[i].value;
+    }
+  }
+
+  for (int i = 0; i < sequenceStepCount; i++){
+    const SequenceStep &step = sequenceSteps[i];
+    sequencer_event_t &event = sequenceEvents[i];
+    double samples = llround(step.time * sampleRate);
+    double ramp = llround(step.ramp * sampleRate);
+    if (step.time < 0.0 || samples >= UINT32_MAX || ramp < 0.0 || ramp > SEQUENCER_MAX_LENGTH){
+      return "a step time or ramp is out of range";
+    }
+    event.at = (uint32_t)samples;
+    event.type = step.type;
+    event.length = (uint32_t)ramp;
+    switch (step.type){
+      case SEQUENCER_FREQUENCY:
+        if (!wave_table::validFrequency(step.value, sampleRate)){
+          return "a step frequency must be positive and at most half the sample rate";
+        }
+        event.value = dds_phase_increment(step.value, sampleRate);
+        break;
+      case SEQUENCER_TABLE: {
+        int shape = (int)step.value;
+        if (shape < 0 || shape > (int)wave_table::Shape::Pulse){
+          return "no such shape";
+        }
+        if (sequenceTables[shape] == NULL){
+          //the cache is only used here while the sequence plays, so the table is never evicted
+          wave_cache::Key key = {(wave_table::Shape)shape, (float)highest, (float)settings.attenuation, (float)sampleRate};
+          sequenceTables[shape] = waveCache.get(key);
+          if (sequenceTables[shape] == NULL){
+            return "not enough memory to render the table";
+          }
+        }
+        event.value = (uint32_t)shape;
+        break;
+      }
+      case SEQUENCER_AMPLITUDE:
+        if (!wave_table::validAttenuation(step.value)){
+          return "a step amplitude must be between 0.0 and 1.0";
+        }
+        event.value = (uint32_t)lround(step.value * SEQUENCER_UNITY_GAIN);
+        break;
+      default:
+        event.value = step.value > 0.0 ? (uint32_t)step.value : 0;
+        break;
+    }
+  }
+
+  //the midpoint of the sequenceTables, truncated like them, so gating them off does not step the output
+  int32_t middle = (int32_t)wave_table::cycleMiddle(settings.attenuation, MAX_DAC_AMPLITUDE);
+  if (!sequencer_init(&sequencer, sequenceEvents, sequenceStepCount, sequenceTables,
+                      sizeof(sequenceTables) / sizeof(sequenceTables[0]), middle)){
+    return "a step is invalid (e.g. a repeat at time 0)";
+  }
+  return NULL;
+}
@@ -0,0 +1,131 @@
+/**
+ * The runtime settings of the STATIC function generator, and the commands
+ * that change them while the waveform plays.
+ *
+ * A control task (loop() on the ESP32, stdin on the host) parses commands
+ * into a GeneratorSettings and hands it to requestSettings(). That renders
+ * (or finds) the table in the waveCache and publishes it as a retune
+ * parameter block. onTimer() picks the block up at the next zero crossing,
+ * without locks and without a phase discontinuity (see lib/retune).
+ *
+ * Commands, one per line:
+ *
+ *   f 440        frequency in Hz
+ *   a 0.5        attenuation (0.0 to 1.0)
+ *   s square     shape: sine, square, triangle, sawtooth or pulse
+ *   r 100000     sample rate in samples per second
+ *   c 2          DAC channel: 1 or 2
+ *   p 3          one of the presets[]
+ *
+ * With SEQUENCE (main.cpp), the changes come from the sequenceSteps[]
+ * timeline instead: sequenceBegin() turns it into sample indices, and
+ * onTimer() applies each step at its exact sample (see lib/sequencer).
+ *
+ * This file builds for the ESP32 and the host (see platformio.ini, env:native).
+ *
+ * @file generator.h
+ * @author Philip Giacalone
+ */
+
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdint.h>
+
+#include "wave_table.h"
+#include "wave_cache.h"
+#include "dds.h"
+#include "retune.h"
+#include "sequencer.h"
+
+#define WAVE_TABLE_BITS     10      // the wave table holds 2^10 = 1024 samples of one cycle, for any frequency
+#define PRESET_CACHE_TABLES 8       // the most tables kept rendered at once (1 KB each)
+#define MAX_DAC_AMPLITUDE   127     // (127) amplitude is half of peak-to-peak
+#define DAC_CHANNELS        2       // DAC_CHANNEL_1 (0) and DAC_CHANNEL_2 (1)
+#define SEQUENCE_MAX_EVENTS 32      // the most steps in the sequenceSteps[]
+
+struct GeneratorSettings {
+  wave_table::Shape shape;
+  //frequency of the output waveform in Hz
+  double frequency;
+  //output waveform voltage attenuation (0.0 to 1.0)
+  double attenuation;
+  //the requested sample rate (the timer runs at timerSampleRate() of it)
+  double samplesPerSecond;
+  //DAC_CHANNEL_1 (0) or DAC_CHANNEL_2 (1)
+  uint32_t dacChannel;
+};
+
+//one step of the SEQUENCE timeline, in seconds and Hz (see lib/sequencer for the types)
+struct SequenceStep {
+  //seconds from the start of the timeline
+  double time;
+  sequencer_event_type_t type;
+  //FREQUENCY: Hz, TABLE: a wave_table::Shape, AMPLITUDE: 0.0 to 1.0, GATE: 1 or 0, BURST: cycles
+  double value;
+  //AMPLITUDE: seconds to ramp to the value (0.0 for a step)
+  double ramp;
+};
+
+//the preset waveforms, selected with "p <index>". they keep the sample rate and DAC channel
+extern const GeneratorSettings presets[];
+extern const int presetCount;
+
+//the settings that were last requested (and are playing once the retune is picked up)
+extern GeneratorSettings settings;
+
+//played by onTimer() with retune_next(&waveRetune, &wavePlayer, ...)
+extern dds_table_player_t wavePlayer;
+extern retune_t waveRetune;
+
+//SEQUENCE: the timeline, and the sequencer that plays it with the wavePlayer,
+//from onTimer() with sequencer_next(&sequencer, &wavePlayer)
+extern const SequenceStep sequenceSteps[];
+extern const int sequenceStepCount;
+extern sequencer_t sequencer;
+
+//the rendered tables, so switching back to recent settings is a lookup, not a rebuild (see lib/wave_cache)
+extern wave_cache::Cache<1 << WAVE_TABLE_BITS, PRESET_CACHE_TABLES> waveCache;
+
+/**
+ * @brief Returns the rate at which the timer really calls onTimer().
+ * The timer period is a whole number of microseconds, so this can differ from samplesPerSecond.
+ */
+double timerSampleRate(double samplesPerSecond);
+
+/**
+ * @brief Starts playing a table (one cycle, 2^WAVE_TABLE_BITS entries) with the initial settings
+ */
+void generatorBegin(const GeneratorSettings &initial, const uint8_t *table);
+
+/**
+ * @brief Parses one command line into a copy of the settings
+ *
+ * @return NULL on success, otherwise what is wrong with the line
+ */
+const char *parseCommand(const char *line, GeneratorSettings &next);
+
+/**
+ * @brief Requests new settings. The table is rendered here on a cache miss (not in onTimer()).
+ * onTimer() picks them up at the next zero crossing. Call from the control task only.
+ *
+ * @param rendered set to true if the table was rendered, false if it was cached
+ * @return NULL on success, otherwise why the settings were not requested
+ */
+const char *requestSettings(const GeneratorSettings &next, bool *rendered);
+
+/**
+ * @brief Converts the sequenceSteps[] to sample indices at the timer's real rate, renders the
+ * tables they switch to (in the waveCache, band limited at the highest frequency of the timeline)
+ * and sets up the sequencer. Call after generatorBegin(), before the timer starts.
+ *
+ * @return NULL on success, otherwise what is wrong with the timeline
+ */
+const char *sequenceBegin();
+
+/**
+ * @brief Returns the name of a shape, e.g. "square"
+ */
+const char *shapeName(wave_table::Shape shape);
+
+#endif // GENERATOR_H
@@ -0,0 +1,183 @@
+/**
+ * Host build of the STATIC function generator (pio run -e native), for trying
+ * runtime changes without a board. It reads commands from stdin (see
+ * generator.h), and plays the samples that onTimer() would, through the same
+ * retune path, until each change is picked up. For each change it prints the
+ * retune latency and the output step where the change happened, e.g.
+ *
+ *   printf 'f 440\ns square\np 5\nr 100000\n' | .pio/build/native/program
+ *
+ * With --sequence it plays the sequenceSteps[] timeline (see generator.cpp)
+ * instead, with the same integer code as onTimer() with SEQUENCE, so the
+ * samples are bit-exact with the board's. It prints the sample index and
+ * output of each event as it is applied, and a checksum of every sample:
+ *
+ *   .pio/build/native/program --sequence 2.0
+ *
+ * @file host_main.cpp
+ * @author Philip Giacalone
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "generator.h"
+
+#define INTERPOLATE         false   // same as main.cpp
+
+//what onTimer() would have written to the DAC
+static uint8_t dacValue = 0;
+static uint64_t sampleCount = 0;
+//the timer period (usec) onTimer() would have written, and the sample it wrote it on
+static uint32_t timerPeriod = 0;
+static uint64_t periodAt = 0;
+
+//one onTimer() call, minus the DAC write
+static uint8_t playSample() {
+  dacValue = retune_next(&waveRetune, &wavePlayer, INTERPOLATE);
+  if (waveRetune.period != 0){
+    timerPeriod = waveRetune.period;
+    periodAt = sampleCount;
+    waveRetune.period = 0;
+  }
+  sampleCount++;
+  return dacValue;
+}
+
+//the largest step between neighbouring samples over one cycle of the current waveform
+static int largestStep() {
+  if (wavePlayer.phase_inc == 0){
+    return 0;
+  }
+  uint32_t samples = (uint32_t)(4294967296.0 / wavePlayer.phase_inc) + 1;
+  int largest = 0;
+  int previous = playSample();
+  for (uint32_t i = 0; i < samples; i++){
+    int value = playSample();
+    largest = abs(value - previous) > largest ? abs(value - previous) : largest;
+    previous = value;
+  }
+  return largest;
+}
+
+static const char *eventNames[] = {"frequency", "table", "amplitude", "gate", "burst", "repeat"};
+
+//plays the sequenceSteps[] for some seconds, like onTimer() with SEQUENCE
+static int playSequence(double seconds) {
+  const char *error = sequenceBegin();
+  if (error != NULL){
+    printf("error in the sequenceSteps[]: %s\n", error);
+    return 1;
+  }
+  uint64_t samples = (uint64_t)(seconds * timerSampleRate(settings.samplesPerSecond));
+  //FNV-1a over every sample, to compare runs (and builds) bit for bit
+  uint32_t checksum = 2166136261U;
+  uint8_t previous = (uint8_t)sequencer.middle;
+  //with the gate off (or no gain) the output must be the table's value at phase 0, its midpoint,
+  //or every gate change steps it
+  uint64_t silent = 0;
+  uint64_t offMiddle = 0;
+  for (uint64_t i = 0; i < samples; i++){
+    bool quiet = (sequencer.gate == 0 || sequencer.gain == 0) && sequencer.sample != sequencer.next_at;
+    uint32_t fired = sequencer.fired;
+    uint32_t next = sequencer.next;
+    uint32_t at = sequencer.sample;
+    uint8_t value = sequencer_next(&sequencer, &wavePlayer);
+    for (uint32_t e = next; fired != sequencer.fired; fired++){
+      const sequencer_event_t &event = sequencer.events[e];
+      printf("sample %8llu (timeline %7u): %-9s %10u, output %3u -> %3u\n", (unsigned long long)i,
+             (unsigned)at, eventNames[event.type], (unsigned)event.value, previous, value);
+      //after a repeat, the events at sample 0 of the next pass
+      e = event.type == SEQUENCER_REPEAT ? 0 : e + 1;
+      at = event.type == SEQUENCER_REPEAT ? 0 : at;
+    }
+    if (quiet){
+      silent++;
+      offMiddle += value != wavePlayer.table[0];
+    }
+    checksum = (checksum ^ value) * 16777619U;
+    previous = value;
+  }
+  printf("%llu samples, %u events, %u repeats, checksum %08x\n", (unsigned long long)samples,
+         (unsigned)sequencer.fired, (unsigned)sequencer.repeats, (unsigned)checksum);
+  printf("%llu samples gated off or at zero gain, %llu of them away from the table's value at phase 0 (%u): %s\n",
+         (unsigned long long)silent, (unsigned long long)offMiddle, (unsigned)wavePlayer.table[0],
+         offMiddle == 0 ? "ok" : "DC STEP");
+  return offMiddle == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  GeneratorSettings initial = {wave_table::Shape::Sine, 200.0, 0.5, 150000.0, 0};
+  wave_cache::Key key = {initial.shape, (float)initial.frequency, (float)initial.attenuation,
+                         (float)timerSampleRate(initial.samplesPerSecond)};
+  generatorBegin(initial, waveCache.get(key));
+  if (argc > 1 && strcmp(argv[1], "--sequence") == 0){
+    return playSequence(argc > 2 ? atof(argv[2]) : 2.0);
+  }
+  int stepBefore = largestStep();
+
+  char line[64];
+  while (fgets(line, sizeof(line), stdin) != NULL){
+    GeneratorSettings next = settings;
+    const char *error = parseCommand(line, next);
+    bool rendered = false;
+    if (error == NULL){
+      error = requestSettings(next, &rendered);
+    }
+    if (error != NULL){
+      printf("%s", line);
+      printf("  error: %s\n", error);
+      continue;
+    }
+
+    //play until onTimer() would pick the change up, then one more sample with it
+    uint32_t phaseBefore = 0;
+    uint32_t incBefore = 0;
+    uint32_t applied = waveRetune.applied;
+    uint8_t previous = dacValue;
+    uint32_t waited = 0;
+    while (waveRetune.applied == applied){
+      phaseBefore = wavePlayer.phase;
+      incBefore = wavePlayer.phase_inc;
+      previous = playSample();
+      waited++;
+    }
+    uint32_t phaseAt = wavePlayer.phase;
+    uint64_t pickedAt = sampleCount - 1;
+    //the largest step from the last sample with the old settings, through the fade to the new table
+    int stepAt = 0;
+    uint32_t faded = 0;
+    do {
+      uint8_t value = playSample();
+      stepAt = abs((int)value - (int)previous) > stepAt ? abs((int)value - (int)previous) : stepAt;
+      previous = value;
+      faded++;
+    } while (retune_pending(&waveRetune));
+    int stepAfter = largestStep();
+
+    printf("%s", line);
+    printf("  %s %.3lf Hz, attenuation %.2lf, %.0lf samples/s, DAC channel %u (table %s)\n",
+           shapeName(settings.shape), settings.frequency, settings.attenuation,
+           timerSampleRate(settings.samplesPerSecond), (unsigned)settings.dacChannel + 1,
+           rendered ? "rendered" : "cached");
+    printf("  picked up after %u samples, phase %s, largest output step %d over the %u samples of the change "
+           "(largest step in the waveform before/after: %d/%d)\n",
+           (unsigned)waited, phaseAt == phaseBefore + incBefore ? "continuous" : "DISCONTINUOUS",
+           stepAt, (unsigned)faded, stepBefore, stepAfter);
+    if (periodAt == pickedAt && timerPeriod != 0){
+      printf("  timer period %u usec from the same sample as the new increment\n", (unsigned)timerPeriod);
+    }
+    stepBefore = stepAfter;
+  }
+
+  isr_cycle_stats_t &samples = waveRetune.latency_samples;
+  isr_cycle_stats_t &cycles = waveRetune.latency_cycles;
+  printf("%u changes, %llu samples played\n", (unsigned)waveRetune.applied, (unsigned long long)sampleCount);
+  if (samples.count > 0){
+    printf("retune latency min/mean/max: %u / %u / %u samples, %u / %u / %u host cycles\n",
+           samples.min, isr_cycle_stats_mean(&samples), samples.max,
+           cycles.min, isr_cycle_stats_mean(&cycles), cycles.max);
+  }
+  return 0;
+}
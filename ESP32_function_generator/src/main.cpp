@@ -32,24 +32,59 @@
 
 
 #include <Arduino.h>
+#include <LittleFS.h>
 #include "driver/dac.h"
 #include "driver/timer.h"
 #include "clk.h"
 #include <stdio.h>
+#include "envelope.h"
+#include "block_buffer.h"
+#include "wave_table.h"
+#include "dds.h"
+#include "noise.h"
+#include "isr_safe.h"
+#include "generator.h"
+#include "sample_stream.h"
+#include "upsample.h"
+#include "quantize.h"
+#include "modulation.h"
+#include "timer_trace.h"
+#include "cycle_probe.h"
 
 // If using the FreeRTOS timer (which is faster than the built-in timer peripherals)
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
 
-//Configurable items: specify the output frequency, sample rate, attenuation and DAC Channel
+//Configurable items: specify the output frequency, sample rate, attenuation and DAC Channel.
+//For STATIC generation these are the settings at start-up. They can be changed while the waveform
+//plays by sending commands over the serial port, e.g. "f 440" or "s square" (see generator.h)
 #define FREQUENCY           200    // the desired frequency (Hz) of the output waveform
 #define SAMPLES_PER_SECOND  150000  // ADC samples per second. Per Nyquist, set this at least 2 x FREQUENCY
 #define ATTENUATION         0.5     // output waveform voltage attenuation (must be 1.0 or less)
 #define DAC_CHANNEL         DAC_CHANNEL_1 // the waveform output pin. (e.g., DAC_CHANNEL_1 or DAC_CHANNEL_2)
 #define STATIC              0
 #define DYNAMIC             1
+#define STREAM              2       // play the samples in STREAM_FILE
 #define GENERATE_WAVES      STATIC 
+#define INTERPOLATE         false   // STATIC: interpolate linearly between table entries (smoother, slightly slower)
+#define FAST_DAC_WRITE      true    // true: IRAM safe register write. false: dac_output_voltage() (in flash, slower)
+#define WAVE_SHAPE          wave_table::Shape::Sine   // STATIC: Sine, Square, Triangle, Sawtooth or Pulse
+#define PULSE_DUTY          0.5     // STATIC Pulse: the fraction of the cycle that is high
+#define PACKED_TABLE        false   // STATIC Sine, Square or Triangle: store only a quarter of the cycle (4x less memory)
+#define SEQUENCE            false   // STATIC: play the sequenceSteps[] timeline (see generator.cpp) instead of serial commands
+#define MIPMAP              false   // STATIC: one table per octave, so WAVE_SHAPE does not alias at any frequency ("f" commands)
+#define STREAM_FILE         "/littlefs/wave.raw"  // STREAM: 8-bit unsigned mono samples at SAMPLES_PER_SECOND
+#define STREAM_LOOP         true    // STREAM: start over at the end of the file
+#define DUAL_CHANNEL        false   // STATIC or DYNAMIC: drive DAC_CHANNEL_1 and DAC_CHANNEL_2 from the same timer
+#define CHANNEL_2_FREQUENCY FREQUENCY   // STATIC, DUAL_CHANNEL: the frequency of DAC_CHANNEL_2
+#define CHANNEL_2_PHASE     90.0    // DUAL_CHANNEL: degrees that DAC_CHANNEL_2 leads DAC_CHANNEL_1 (90.0 for I/Q)
+#define UPSAMPLE_FACTOR     1       // DYNAMIC: compute the waves at SAMPLES_PER_SECOND/UPSAMPLE_FACTOR and interpolate (1 = off)
+#define UPSAMPLE_TAPS       8       // DYNAMIC: interpolation filter taps per phase (more = sharper cutoff, slower)
+#define DAC_QUANTIZER       QUANTIZE_TRUNCATE   // DYNAMIC: QUANTIZE_TRUNCATE, _ROUND, _TPDF (dither), _SHAPED_1 or _SHAPED_2
+
+//STREAM: the file is uploaded from the data folder with "pio run -t uploadfs", e.g. converted with
+//  sox recording.wav -r 150000 -c 1 -b 8 -e unsigned-integer data/wave.raw
 
 double frequencies[] = {100.0};   // Hz, frequencies of the sine waves
 double amplitudes[] = {0.5};       // amplitudes of the sine waves (range is from 0.0 to 1.0)
@@ -59,12 +94,17 @@ double decay = 0.99;          // decay coefficient
 //These items should probably be left as-is
 #define DAC_BIT_DEPTH       8       // ESP32: 8 bits (fixed within ESP32 hardware)
 #define DEBUG               false
+#define HARMONICS           wave_table::maxHarmonic(FREQUENCY, SAMPLES_PER_SECOND) // band limit, so nothing aliases
  
 //Do NOT change the following 
-#define SAMPLES_PER_CYCLE   SAMPLES_PER_SECOND/FREQUENCY 
+#define SAMPLES_PER_CYCLE   ((double)SAMPLES_PER_SECOND/FREQUENCY)   // need not be a whole number
 #define MAX_DAC_VALUE       255     // (255) the maximum ESP32 DAC value, peak-to-peak (8 bit DAC fixed in hardware)
-#define MAX_DAC_AMPLITUDE   127     // (127) amplitude is half of peak-to-peak
 #define TIMER_DIVIDER       80      // (80) timer frequency divider. timer runs at 80MHz by default. 
+#define TIMER_ID            1       // the timerBegin() timer of onTimer(). On the Arduino-ESP32 2.x core
+#define TIMER_GROUP         1       // (platformio.ini pins it) timer 1 is timer group 1,
+#define TIMER_INDEX         0       // timer 0 (isr_timer_alarm_write() changes its period from onTimer()). 3.x numbers timers differently
+#define STREAM_RING_SAMPLES 8192    // STREAM: samples buffered ahead of onTimer() (55 ms at 150000 samples/s)
+#define STREAM_CHUNK_SAMPLES 1024   // STREAM: samples read from the file at a time
 
 //FreeRTOS testing
 typedef struct {
@@ -80,16 +120,80 @@ StaticTask_t timer_task;
 
 //the following are set by the system at runtime
 double now = 0.0;                     // seconds. keeps track of the time (time since start-up in seconds)
-double sampleCount = 0.0;               // keeps track of time steps, when dynamically generating the waveforms
+uint32_t sampleCount = 0;               // keeps track of time steps, when dynamically generating the waveforms
 int numberOfWaves = 0;              // set automatically at runtime. 
 double MICROSECONDS_PER_SAMPLE = 0.0;  //set automatically at runtime.
 double SECONDS_PER_SAMPLE = 0.0;       //set automatically at runtime.
 const double MICROSECONDS_PER_SECOND = 1000000.0; //the timer has a resolution of 1 microsecond (nice!) 
 
-//the array that will hold all of the digital waveform values
-int waveValues[SAMPLES_PER_CYCLE];
-//holds the current index to the waveValues array 
-int waveSampleIndex = 0;
+//the configuration is checked by the compiler (this used to be done at runtime by checkConfig())
+static_assert(wave_table::validFrequency(FREQUENCY, SAMPLES_PER_SECOND), "FREQUENCY must be positive and at most SAMPLES_PER_SECOND/2");
+static_assert(wave_table::validAttenuation(ATTENUATION), "ATTENUATION must be between 0.0 and 1.0");
+static_assert(!DUAL_CHANNEL || wave_table::validFrequency(CHANNEL_2_FREQUENCY, SAMPLES_PER_SECOND), "CHANNEL_2_FREQUENCY must be positive and at most SAMPLES_PER_SECOND/2");
+static_assert(!DUAL_CHANNEL || GENERATE_WAVES != STREAM, "DUAL_CHANNEL works with STATIC or DYNAMIC generation");
+static_assert(UPSAMPLE_FACTOR >= 1 && UPSAMPLE_FACTOR <= UPSAMPLE_MAX_FACTOR && BLOCK_BUFFER_SAMPLES % UPSAMPLE_FACTOR == 0,
+  "UPSAMPLE_FACTOR must be between 1 and UPSAMPLE_MAX_FACTOR and divide BLOCK_BUFFER_SAMPLES");
+static_assert(UPSAMPLE_TAPS >= 1 && UPSAMPLE_TAPS <= UPSAMPLE_MAX_TAPS, "UPSAMPLE_TAPS must be between 1 and UPSAMPLE_MAX_TAPS");
+static_assert(!DUAL_CHANNEL || UPSAMPLE_FACTOR == 1, "DUAL_CHANNEL does not upsample");
+static_assert(!PACKED_TABLE || wave_table::quarterSymmetric(WAVE_SHAPE), "PACKED_TABLE works with Sine, Square or Triangle");
+static_assert(!PACKED_TABLE || (GENERATE_WAVES == STATIC && !DUAL_CHANNEL), "PACKED_TABLE works with STATIC generation on one channel");
+static_assert(!SEQUENCE || (GENERATE_WAVES == STATIC && !DUAL_CHANNEL && !PACKED_TABLE && !INTERPOLATE),
+  "SEQUENCE works with STATIC generation on one channel, from the full table, without INTERPOLATE");
+static_assert(!MIPMAP || (GENERATE_WAVES == STATIC && !DUAL_CHANNEL && !PACKED_TABLE && !SEQUENCE),
+  "MIPMAP works with STATIC generation on one channel, without PACKED_TABLE or SEQUENCE");
+
+//one band-limited cycle of the waveform as 8-bit DAC values, computed by the compiler (see lib/wave_table).
+//it stays in flash unless built with -D WAVE_TABLE_IN_DRAM=1 (see platformio.ini).
+//with PACKED_TABLE it is never played, so it shrinks to 4 entries
+WAVE_TABLE_ATTR constexpr auto waveValues = 
+  wave_table::makeWaveCycle<PACKED_TABLE ? 4 : 1 << WAVE_TABLE_BITS>(WAVE_SHAPE, HARMONICS, ATTENUATION, MAX_DAC_AMPLITUDE, 1.0, PULSE_DUTY);
+
+//PACKED_TABLE: the first quarter of the cycle (2^WAVE_TABLE_BITS / 4 + 1 entries), played by the quarterPlayer,
+//which reflects it into the other three quarters (see lib/wave_table and lib/dds)
+WAVE_TABLE_ATTR constexpr auto quarterValues =
+  wave_table::makeQuarterCycle<uint8_t, PACKED_TABLE ? 1 << WAVE_TABLE_BITS : 4>(WAVE_SHAPE, HARMONICS, ATTENUATION, MAX_DAC_AMPLITUDE);
+dds_quarter_player_t quarterPlayer;
+
+//MIPMAP: one band-limited cycle per octave of the frequency (about 7 KB), played by the mipmapPlayer,
+//which picks the level from its phase increment. without MIPMAP it shrinks to 8 entries
+WAVE_TABLE_ATTR constexpr auto mipmapValues =
+  wave_table::makeMipMap<MIPMAP ? 1 << WAVE_TABLE_BITS : 4>(WAVE_SHAPE, ATTENUATION, MAX_DAC_AMPLITUDE, 1.0, PULSE_DUTY);
+dds_mipmap_player_t mipmapPlayer;
+
+//the waveValues are played by the wavePlayer (see generator.h), which steps through them with a
+//fractional phase increment, so FREQUENCY does not have to divide SAMPLES_PER_SECOND (see lib/dds)
+
+//DUAL_CHANNEL: the waveValues are read by two heads, one per DAC channel, from one onTimer() call (see lib/dds)
+dds_dual_player_t dualPlayer;
+
+//a serial command line, collected by loop() one character at a time
+char commandLine[32];
+size_t commandLength = 0;
+
+//CPU cycles spent in each onTimer() call (see lib/isr_safe)
+isr_cycle_stats_t callbackCycles;
+
+#if TIMER_TRACE_ENABLED
+//when each onTimer() call arrives, collected by loop() (see lib/timer_trace)
+timer_trace_t timerTrace;
+timer_trace_report_t timerTraceReport;
+uint8_t timerTraceFrame[TIMER_TRACE_EXPORT_MAX];
+#endif
+
+//the paths through onTimer(), then the DAC write inside each, for the cycle probes (see lib/cycle_probe)
+enum {
+  PROBE_STATIC_DUAL, PROBE_STATIC_PACKED, PROBE_STATIC_MIPMAP, PROBE_STATIC_SEQUENCE, PROBE_STATIC,
+  PROBE_DYNAMIC, PROBE_DYNAMIC_WAKE, PROBE_STREAM, PROBE_STREAM_WAKE,
+  PROBE_PATHS,
+  PROBE_DAC_WRITE = PROBE_PATHS,
+  PROBES
+};
+
+#if CYCLE_PROBE_ENABLED
+static const char *const probeNames[PROBES] = {"static dual", "static packed", "static mipmap", "static sequence",
+  "static", "dynamic", "dynamic +wake", "stream", "stream +wake", "dac write"};
+cycle_probe_table_t callbackProbes;
+#endif
 
 int dynamic_value = 0;  //TODO remove eventually. just for testing DYNAMIC.
 int waveform_value = 0;
@@ -144,28 +248,6 @@ void printArray(const T (&arr)[N]) {
     }
 }
 
-/**
- * @brief Populates the given circular linked list with one complete cycle of sinusoid data
- * 
- * Since we know the SAMPLES_PER_CYCLE of the waveform, we'll put that many values into the linked list.
- * The timer will call function onTimer() at the precise rate needed to produce the desired output frequency. 
- * 
- * @param head pointer to the circular linked list to be populated with one complete cycle of sinusoid data
- * @return void
- */
-void populateWaveArray() {
-  int count = sizeof(waveValues) / sizeof(waveValues[0]);
-  for (int i = 0; i < count; i++) {
-    float angleInDegrees = ((float)i) * (360.0/((float)SAMPLES_PER_CYCLE));
-    float angleInRadians = 2.0 * PI * angleInDegrees / 360.0;
-    if (DEBUG){
-      Serial.println("i : degrees : radians " + String(i) + " : " + String(angleInDegrees) + " : " + String(angleInRadians));
-    }
-    long value = ATTENUATION * (MAX_DAC_AMPLITUDE + MAX_DAC_AMPLITUDE * sin(angleInRadians));
-    waveValues[i] = value;
-  }
-}
-
 // utility function to get count of elements in any given array
 template <typename T, size_t N>
 size_t getElementCount(T (&array)[N]) {
@@ -199,83 +281,503 @@ struct waveform {
     float phase_angle;
     //determines how quickly the amplitude of the wave decays over time
     float decay_constant;
+    //seconds to ramp up from zero to the amplitude (0.0 for no attack)
+    float attack;
+    //level (0.0 to 1.0) that the decay settles at (0.0 for the plain e^(-at) decay)
+    float sustain;
+    //determines how quickly the amplitude decays after the envelope is released
+    float release;
+    //DDS_MODE_TABLE (sine table lookup, the default) or DDS_MODE_ROTOR (recurrence, no table)
+    dds_mode_t mode;
+    //NOISE_NONE (a sine wave, the default), or NOISE_WHITE, NOISE_PINK or NOISE_BROWN (frequency and phase are ignored)
+    noise_color_t noise;
+    //MODULATION_NONE (mixed into the output, the default), or MODULATION_AM, MODULATION_FM or MODULATION_PM:
+    //this wave is not heard, it modulates waves[modulates] instead (see lib/modulation)
+    modulation_type_t modulation;
+    //the index in waves[] of the wave that this one modulates (the carrier, a sine wave)
+    int modulates;
+    //AM: 0.0 to 1.0 of the carrier's amplitude, FM: peak deviation in Hz, PM: peak deviation in radians.
+    //scaled by this wave's amplitude and envelope
+    float depth;
 };
 
 struct waveform waveform1 = { 2.0, 0.8, 1.57, 0.1 };
 struct waveform waveform2 = { 10.0, 0.2, 3.14, 0.1 };
+//pink noise at a constant level (no decay: sustain is 1.0)
+struct waveform hiss = { 0.0, 0.05, 0.0, 0.0, 0.0, 1.0, 0.0, DDS_MODE_TABLE, NOISE_PINK };
+//a 4 Hz tremolo (AM) of waves[0], at half its amplitude
+struct waveform tremolo = { 4.0, 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, DDS_MODE_TABLE, NOISE_NONE, MODULATION_AM, 0, 0.5 };
+
+waveform waves[] = {waveform1, waveform2};    //e.g. {waveform1, waveform2, hiss} to mix in noise, or {..., tremolo}
+
+//one DDS voice per wave. replaces computing sin(2πft + φ) every sample (see lib/dds)
+dds_voice_t voices[sizeof(waves) / sizeof(waves[0])];
+//one envelope per wave. replaces computing pow(M_E, -at) every sample (see lib/envelope)
+envelope_t envelopes[sizeof(waves) / sizeof(waves[0])];
+//one noise source per wave, used instead of the voice when the wave's noise is not NOISE_NONE (see lib/noise)
+noise_t noises[sizeof(waves) / sizeof(waves[0])];
+//DUAL_CHANNEL: the voices of DAC_CHANNEL_2, CHANNEL_2_PHASE ahead of the voices[]
+dds_voice_t voices2[sizeof(waves) / sizeof(waves[0])];
+//where each modulating wave's value goes, and the modulation collected for each carrier (voices2[] has its own)
+modulation_route_t routes[sizeof(waves) / sizeof(waves[0])];
+modulation_input_t modInputs[sizeof(waves) / sizeof(waves[0])];
+modulation_input_t modInputs2[sizeof(waves) / sizeof(waves[0])];
+//true for the waves that are modulated (they read modInputs[])
+bool carriers[sizeof(waves) / sizeof(waves[0])];
+
+//DYNAMIC waveforms are rendered in blocks by renderTask() and played by onTimer() (see lib/block_buffer)
+block_buffer_t sampleBuffer;
+TaskHandle_t renderTaskHandle = NULL;
+
+//UPSAMPLE_FACTOR > 1: each block is computed at the lower rate, then interpolated by renderTask() (see lib/upsample)
+upsample_t upsampler;
+int16_t coarseSamples[BLOCK_BUFFER_SAMPLES / UPSAMPLE_FACTOR];
+int16_t fineSamples[BLOCK_BUFFER_SAMPLES];
+
+//DYNAMIC: rounds the rendered waves to 8 bits, with dither and noise shaping (see lib/quantize). one per DAC channel
+quantizer_t quantizers[2];
+
+//STREAM samples are read from the STREAM_FILE by streamTask() and played by onTimer() (see lib/sample_stream)
+uint8_t streamSamples[STREAM_RING_SAMPLES];
+sample_stream_t sampleStream;
+FILE *streamFile = NULL;
+TaskHandle_t streamTaskHandle = NULL;
+
+/**
+ * @brief Returns the rate at which onTimer() is really called. 
+ * timerAlarmWrite() works in whole microseconds, so this can differ from SAMPLES_PER_SECOND.
+ */
+double actualSampleRate() {
+  return timerSampleRate(MICROSECONDS_PER_SECOND / MICROSECONDS_PER_SAMPLE);
+}
+
+/**
+ * @brief Sets up a DDS voice, an envelope and a modulation route for each of the waves[].
+ * All of the floating point math happens here, once.
+ */
+void setupVoices() {
+  double sampleRate = actualSampleRate() / UPSAMPLE_FACTOR;  //the voices run at the rate before upsampling
+  int waveCount = getElementCount(waves);
+  dds_init();
+  for (int i=0; i<waveCount; i++){
+    carriers[i] = false;
+  }
+  for (int i=0; i<waveCount; i++){
+    waveform w = waves[i];
+    // a modulator's value is bipolar (no y_offset)
+    double yOffset = w.modulation == MODULATION_NONE ? 1.0 : 0.0;
+    dds_voice_init(&voices[i], w.frequency, w.amplitude, w.phase_angle, yOffset, sampleRate);
+    dds_voice_set_mode(&voices[i], w.mode);
+    noise_init(&noises[i], w.noise, w.amplitude, yOffset, i + 1);
+    dds_voice_init(&voices2[i], w.frequency, w.amplitude, w.phase_angle + CHANNEL_2_PHASE * PI / 180.0, yOffset, sampleRate);
+    dds_voice_set_mode(&voices2[i], w.mode);
+    envelope_init(&envelopes[i], w.attack, w.decay_constant, w.sustain, w.release, sampleRate);
+    envelope_trigger(&envelopes[i]);
+
+    // only sine waves can be modulated, other routes are dropped (the modulator stays silent)
+    bool valid = w.modulation != MODULATION_NONE && w.modulates >= 0 && w.modulates < waveCount
+      && waves[w.modulates].noise == NOISE_NONE;
+    modulation_route_init(&routes[i], valid ? w.modulation : MODULATION_NONE, valid ? w.modulates : 0, w.depth, sampleRate);
+    if (valid){
+      carriers[w.modulates] = true;
+    }
+    modulation_input_clear(&modInputs[i]);
+    modulation_input_clear(&modInputs2[i]);
+  }
+}
+
+/**
+ * @brief Returns the next sample of a wave's voice, with its modulation if it is a carrier
+ * (which always reads the sine table)
+ */
+static inline int32_t voiceSample(int i, dds_voice_t *voice, modulation_input_t *input) {
+  return carriers[i] ? modulation_voice_next(voice, input) : dds_voice_next(voice);
+}
+
+/**
+ * @brief Adds a wave's value to the output, or to its carrier's modulation if it is a modulator
+ */
+static inline void mixWave(int i, int32_t value, int32_t *y, modulation_input_t *inputs) {
+  if (waves[i].modulation == MODULATION_NONE){
+    *y += value;
+  } else {
+    modulation_apply(&routes[i], inputs, value);
+  }
+}
 
-waveform waves[] = {waveform1, waveform2};
 
+/**
+ * @brief Scales a Q15 sum of the waves[] to a DAC value
+ * 
+ * @param quantizer the DAC_QUANTIZER of the channel, it also clamps to 0 to 255
+ */
+static inline uint8_t toDac(int32_t y, quantizer_t *quantizer) {
+  // 2 * DDS_Q15_ONE -> 2 * MAX_DAC_AMPLITUDE, keeping QUANTIZE_FRACTION_BITS below the DAC step
+  return quantize_next(quantizer, (y * MAX_DAC_AMPLITUDE) >> (15 - QUANTIZE_FRACTION_BITS));
+}
+
+/**
+ * @brief Computes one sample of the sum of the waves[] (DYNAMIC generation)
+ * 
+ * Integer (Q15 fixed point) math only: one table lookup (or one noise value) and one multiply per wave,
+ * plus one multiply per modulating wave.
+ * 
+ * @return the Q15 sum, 2 * DDS_Q15_ONE is full scale
+ */
+int32_t renderSum() {
+  int32_t y = 0;  //Q15 sum of the waves, 2 * DDS_Q15_ONE is full scale (y_offset is 1.0)
+  int waveCount = getElementCount(waves);
+  for (int i=0; i<waveCount; i++){
+    // y(t) = A * e^(-at) * (1 + sin(2πft + φ))
+    // the phase and e^(-at) are each updated once per sample by the voice and the envelope
+    int32_t sample = waves[i].noise != NOISE_NONE ? noise_next(&noises[i]) : voiceSample(i, &voices[i], &modInputs[i]);
+    mixWave(i, envelope_apply(&envelopes[i], sample), &y, modInputs);
+  }
+  return y;
+}
+
+/**
+ * @brief Computes one frame of the sum of the waves[] (DYNAMIC generation, DUAL_CHANNEL):
+ * DAC_CHANNEL_1 from the voices[], DAC_CHANNEL_2 from the voices2[] (CHANNEL_2_PHASE ahead).
+ * Both channels share each wave's envelope and noise.
+ */
+void renderFrame(uint8_t *channel1, uint8_t *channel2) {
+  int32_t y1 = 0;
+  int32_t y2 = 0;
+  int waveCount = getElementCount(waves);
+  for (int i=0; i<waveCount; i++){
+    int64_t level = envelope_next(&envelopes[i]);
+    int32_t s1, s2;
+    if (waves[i].noise != NOISE_NONE){
+      s1 = s2 = noise_next(&noises[i]);
+    } else {
+      s1 = voiceSample(i, &voices[i], &modInputs[i]);
+      s2 = voiceSample(i, &voices2[i], &modInputs2[i]);
+    }
+    mixWave(i, (int32_t)((s1 * level) >> 30), &y1, modInputs);
+    mixWave(i, (int32_t)((s2 * level) >> 30), &y2, modInputs2);
+  }
+  *channel1 = toDac(y1, &quantizers[0]);
+  *channel2 = toDac(y2, &quantizers[1]);
+}
+
+/**
+ * @brief Renders samples into every free block of the sampleBuffer
+ */
+void renderBlocks() {
+  uint8_t *block;
+  while ((block = block_buffer_acquire(&sampleBuffer)) != NULL){
+    // every voice advances exactly one sample per onTimer() call
+    if (DUAL_CHANNEL){
+      // interleaved frames: DAC_CHANNEL_1, DAC_CHANNEL_2, DAC_CHANNEL_1, ...
+      for (int i = 0; i < BLOCK_BUFFER_SAMPLES; i += 2){
+        renderFrame(&block[i], &block[i + 1]);
+        sampleCount++;
+      }
+    } else if (UPSAMPLE_FACTOR > 1){
+      // the waves are centered on 0 for the filter: 0 to 2 * DDS_Q15_ONE -> -DDS_Q15_ONE to DDS_Q15_ONE
+      for (int i = 0; i < BLOCK_BUFFER_SAMPLES / UPSAMPLE_FACTOR; i++){
+        int32_t y = renderSum() - DDS_Q15_ONE;
+        coarseSamples[i] = (int16_t)(y > INT16_MAX ? INT16_MAX : (y < INT16_MIN ? INT16_MIN : y));
+      }
+      upsample_process(&upsampler, coarseSamples, BLOCK_BUFFER_SAMPLES / UPSAMPLE_FACTOR, fineSamples);
+      for (int i = 0; i < BLOCK_BUFFER_SAMPLES; i++){
+        block[i] = toDac(fineSamples[i] + DDS_Q15_ONE, &quantizers[0]);
+        sampleCount++;
+      }
+    } else {
+      for (int i = 0; i < BLOCK_BUFFER_SAMPLES; i++){
+        block[i] = toDac(renderSum(), &quantizers[0]);
+        sampleCount++;
+      }
+    }
+    block_buffer_commit(&sampleBuffer);
+  }
+}
+
+/**
+ * @brief FreeRTOS task that renders the DYNAMIC waveforms, one block at a time.
+ * It sleeps until onTimer() finishes playing a block.
+ */
+void renderTask(void *arg) {
+  while (true){
+    renderBlocks();
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+/**
+ * @brief Sets up the block buffer and starts renderTask() on the other core
+ */
+void setupRenderTask() {
+  block_buffer_init(&sampleBuffer, MAX_DAC_AMPLITUDE);
+  upsample_init(&upsampler, UPSAMPLE_FACTOR, UPSAMPLE_TAPS, 0.8);  //passes up to 0.4 x the lower rate
+  quantize_init(&quantizers[0], DAC_QUANTIZER, 1);
+  quantize_init(&quantizers[1], DAC_QUANTIZER, 2);
+  renderBlocks();   //both blocks are ready before the timer starts
+  xTaskCreatePinnedToCore(renderTask, "renderTask", 4096, NULL, configMAX_PRIORITIES - 2, &renderTaskHandle, 0);
+}
+
+/**
+ * @brief Prints the underrun count and fill levels of the block buffer
+ */
+void printBufferStats() {
+  block_buffer_stats_t stats = sampleBuffer.stats;
+  Serial.println("------Block Buffer------");
+  Serial.println("Blocks played    : " + String(stats.blocks_played));
+  Serial.println("Underruns        : " + String(stats.underruns));
+  Serial.println("Fill min/mean/max: " + String(stats.min_fill) + " / " 
+    + String(block_buffer_mean_fill(&sampleBuffer)) + " / " + String(stats.max_fill) + " samples");
+}
+
+/**
+ * @brief FreeRTOS task that reads the STREAM_FILE into the sampleStream, one chunk at a time.
+ * It sleeps until onTimer() has played a chunk.
+ */
+void streamTask(void *arg) {
+  while (true){
+    sample_stream_fill(&sampleStream);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+/**
+ * @brief Mounts LittleFS, opens the STREAM_FILE and starts streamTask() on the other core
+ * 
+ * @return false if the file could not be opened
+ */
+bool setupStream() {
+  if (!LittleFS.begin()){
+    Serial.println("Could not mount LittleFS (upload the data folder with \"pio run -t uploadfs\")");
+    return false;
+  }
+  streamFile = fopen(STREAM_FILE, "rb");
+  if (streamFile == NULL){
+    Serial.println("Could not open " + String(STREAM_FILE));
+    return false;
+  }
+  sample_source_t source;
+  sample_source_file(&source, streamFile);
+  sample_stream_init(&sampleStream, streamSamples, STREAM_RING_SAMPLES, STREAM_CHUNK_SAMPLES,
+    &source, STREAM_LOOP, MAX_DAC_AMPLITUDE);
+  sample_stream_fill(&sampleStream);   //the ring is full before the timer starts
+  xTaskCreatePinnedToCore(streamTask, "streamTask", 4096, NULL, configMAX_PRIORITIES - 2, &streamTaskHandle, 0);
+  return true;
+}
+
+/**
+ * @brief Prints the underrun count and fill margin of the sample stream
+ */
+void printStreamStats() {
+  sample_stream_stats_t stats = sampleStream.stats;
+  Serial.println("------Sample Stream------");
+  Serial.println("Samples read     : " + String((uint32_t)stats.samples_read) + " (" + String(stats.loops) + " loops)");
+  Serial.println("Underruns        : " + String(stats.underruns));
+  Serial.println("Min fill         : " + String(stats.min_fill) + " of " + String(STREAM_RING_SAMPLES) + " samples");
+}
+
+/**
+ * @brief Outputs a value to the current DAC channel from onTimer().
+ * The channel starts as DAC_CHANNEL and is changed at runtime through the waveRetune.
+ */
+static inline __attribute__((always_inline)) void writeDac(uint8_t value) {
+  CYCLE_PROBE_BEGIN(writeCycles);
+  dac_channel_t channel = (dac_channel_t)waveRetune.channel;
+  if (FAST_DAC_WRITE){
+    isr_dac_write(channel, value);
+  } else {
+    dac_output_voltage(channel, value);
+  }
+  CYCLE_PROBE_END(&callbackProbes, PROBE_DAC_WRITE, writeCycles);
+}
+
+/**
+ * @brief Outputs a frame to both DAC channels from onTimer() (DUAL_CHANNEL)
+ */
+static inline __attribute__((always_inline)) void writeDacFrame(uint8_t channel1, uint8_t channel2) {
+  CYCLE_PROBE_BEGIN(writeCycles);
+  if (FAST_DAC_WRITE){
+    isr_dac_write(DAC_CHANNEL_1, channel1);
+    isr_dac_write(DAC_CHANNEL_2, channel2);
+  } else {
+    dac_output_voltage(DAC_CHANNEL_1, channel1);
+    dac_output_voltage(DAC_CHANNEL_2, channel2);
+  }
+  CYCLE_PROBE_END(&callbackProbes, PROBE_DAC_WRITE, writeCycles);
+}
 
 /** 
  * The function generates and outputs the sine wave to the DAC channel.
  * It is called periodically by the timer. 
  * This function:
- *  1) gets values of the waveform from the circular linked list
+ *  1) gets a value of the waveform from the table at the current phase
  *  2) outputs the value to the DAC channel
- *  3) advances the linked list to the next node 
+ *  3) advances the phase by the (fractional) phase increment
+ *  4) picks up new settings (table, phase increment, DAC channel) requested by loop(),
+ *     at a zero crossing of the phase, without locks (see lib/retune)
+ * 
+ * With SEQUENCE, the changes come from the sequenceSteps[] timeline instead, each one at its
+ * exact sample (see lib/sequencer).
+ * For DYNAMIC generation, the samples come from the block buffer filled by renderTask(),
+ * so the time spent here does not grow with the number (or complexity) of the waves[].
+ * For STREAM, they come from the ring buffer filled from the STREAM_FILE by streamTask().
+ * With DUAL_CHANNEL, each call writes one frame to both DAC channels, so they stay phase locked.
+ * 
+ * It runs in IRAM and uses integer math only (the FPU is not saved for interrupts).
+ * Everything it reads is in DRAM (build with -D WAVE_TABLE_IN_DRAM=1, see platformio.ini).
 */
-void onTimer() {
-
-  if (GENERATE_WAVES == STATIC){ //------STATIC GENERATION OF WAVEFORMS------
-
-    // get the waveform value from the linked list
-    waveform_value = waveValues[waveSampleIndex];
-    // output the voltage to the DAC_CHANNEL
-    dac_output_voltage(DAC_CHANNEL, waveform_value);
-    // advance the index or reset to zero
-    waveSampleIndex++;
-    if (waveSampleIndex >= SAMPLES_PER_CYCLE){
-      waveSampleIndex = 0;
-    } 
-
-  } else { //------DYNAMIC GENERATION OF WAVEFORMS------
-
-    int64_t time_since_boot = esp_timer_get_time(); //microseconds
-    double _t_ = time_since_boot/1000000.0;
-    // ESP_LOGI(TAG, "Periodic timer called, time since boot: %lld us", time_since_boot);
-
-    float y = 0;  //the final value to be sent to the ESP32 output pin (between 0 and 255)
-    int waveCount = getElementCount(waves);
-    for (int i=0; i<waveCount; i++){
-      waveform w = waves[i];
-      // y(t) = A * e^(-at) * sin(2πft + φ)
-      float exponential = pow(M_E, (-1) * w.decay_constant * _t_);
-      float angle = M_TWOPI * w.frequency * _t_ + w.phase_angle;
-      //sum all the y values as floats in order to maintain resolution during the calculations
-      y = y + ( w.amplitude * exponential * ( 127.0 + ( 127.0 * sin(angle) )));
+void IRAM_ATTR onTimer() {
+  uint32_t startCycles = isr_cycle_count();
+  TIMER_TRACE_STAMP(&timerTrace, startCycles);
+
+  if (GENERATE_WAVES == STATIC && DUAL_CHANNEL){ //------STATIC, BOTH DAC CHANNELS------
+
+    // two heads read the same table, one per channel
+    uint8_t channel1, channel2;
+    dds_dual_next(&dualPlayer, &channel1, &channel2);
+    writeDacFrame(channel1, channel2);
+    CYCLE_PROBE_END(&callbackProbes, PROBE_STATIC_DUAL, startCycles);
+
+  } else if (GENERATE_WAVES == STATIC && PACKED_TABLE){ //------STATIC, QUARTER-WAVE TABLE------
+
+    // the table index is reflected into the first quarter, and flipped around the midpoint in the second half
+    writeDac(dds_quarter_next(&quarterPlayer));
+    CYCLE_PROBE_END(&callbackProbes, PROBE_STATIC_PACKED, startCycles);
+
+  } else if (GENERATE_WAVES == STATIC && MIPMAP){ //------STATIC, ONE TABLE PER OCTAVE------
+
+    // the level (table) is picked from the phase increment, so a new frequency needs no new table
+    writeDac(dds_mipmap_next(&mipmapPlayer));
+    CYCLE_PROBE_END(&callbackProbes, PROBE_STATIC_MIPMAP, startCycles);
+
+  } else if (GENERATE_WAVES == STATIC && SEQUENCE){ //------STATIC, SEQUENCED CHANGES------
+
+    // apply the timeline's events due at this sample, then play it with their gain and gate
+    writeDac(sequencer_next(&sequencer, &wavePlayer));
+    CYCLE_PROBE_END(&callbackProbes, PROBE_STATIC_SEQUENCE, startCycles);
+
+  } else if (GENERATE_WAVES == STATIC){ //------STATIC GENERATION OF WAVEFORMS------
+
+    // get the waveform value from the table, advance the (fractional) phase and pick up new settings
+    waveform_value = retune_next(&waveRetune, &wavePlayer, INTERPOLATE);
+    if (waveRetune.period != 0){
+      // a new sample rate was picked up with its increment: the next sample comes one new period from now
+      isr_timer_alarm_write(TIMER_GROUP, TIMER_INDEX, waveRetune.period);
+      waveRetune.period = 0;
+    }
+    // output the voltage to the DAC channel
+    writeDac(waveform_value);
+    CYCLE_PROBE_END(&callbackProbes, PROBE_STATIC, startCycles);
+
+  } else if (GENERATE_WAVES == DYNAMIC){ //------DYNAMIC GENERATION OF WAVEFORMS------
+
+    // the waveform math runs in renderTask(). this only plays the next rendered sample (or frame)
+    uint8_t value, value2;
+    bool released = DUAL_CHANNEL ? block_buffer_read_frame(&sampleBuffer, &value, &value2)
+                                 : block_buffer_read(&sampleBuffer, &value);
+    if (released){
+      // a block was used up, wake renderTask() to render the next one
+      BaseType_t higherPriorityTaskWoken = pdFALSE;
+      vTaskNotifyGiveFromISR(renderTaskHandle, &higherPriorityTaskWoken);
+      if (higherPriorityTaskWoken){
+        portYIELD_FROM_ISR();
+      }
     }
-    dac_output_voltage(DAC_CHANNEL_1, ((int)y));
+    if (DUAL_CHANNEL){
+      writeDacFrame(value, value2);
+    } else {
+      writeDac(value);
+    }
+    CYCLE_PROBE_END(&callbackProbes, released ? PROBE_DYNAMIC_WAKE : PROBE_DYNAMIC, startCycles);
+
+  } else { //------STREAM THE WAVEFORM FROM A FILE------
+
+    uint8_t value;
+    bool released = sample_stream_read(&sampleStream, &value);
+    if (released){
+      // a chunk was played, wake streamTask() to read the next one
+      BaseType_t higherPriorityTaskWoken = pdFALSE;
+      vTaskNotifyGiveFromISR(streamTaskHandle, &higherPriorityTaskWoken);
+      if (higherPriorityTaskWoken){
+        portYIELD_FROM_ISR();
+      }
+    }
+    writeDac(value);
+    CYCLE_PROBE_END(&callbackProbes, released ? PROBE_STREAM_WAKE : PROBE_STREAM, startCycles);
 
-    // //------------ old way --------------
-    // //data for each waveform (frequency, amplitude, phase angle, attenuation)
-    // float wave1[] = {100.0, 0.5, 0.0, 0.5};
-    // float wave2[] = {1000.0, 0.1, 0.0, 0.5};
+  } //end else STREAM
 
-    // // formula for a sine wave with frequency (ω) amplitude (A) and phase angle (φ)
-    // //   f(t) = A sin(ωt + φ)    
-    // float waveform1 = (wave1[3] * ( ((float)127) + ( ((float)127) * (wave1[1] * (sin(M_TWOPI * wave1[0] * _t_ + wave1[2])))))); 
-    // float waveform2 = (wave2[3] * ( ((float)127) + ( ((float)127) * (wave2[1] * (sin(M_TWOPI * wave2[0] * _t_ + wave2[2])))))); 
-    // // printf("%.9f\t", now);
-    // // printf("%.3f\t", waveform1);
-    // // printf("%.3f\t", waveform2);
-    // int output = (int)(waveform1 + waveform2);
-    // // printf("%d\n", output);
-    
-    // dac_output_voltage(DAC_CHANNEL_1, output);
+  isr_cycle_stats_add(&callbackCycles, isr_cycle_count() - startCycles);
+}
 
-//    } //end for numberOfWaves
+/**
+ * @brief Prints the min/mean/max CPU cycles spent in onTimer() since the last call
+ */
+void printCallbackCycles() {
+  isr_cycle_stats_t stats = callbackCycles;
+  isr_cycle_stats_reset(&callbackCycles);
+  Serial.printf("onTimer() cycles min/mean/max: %u / %u / %u (%u calls) \n", 
+    stats.min, isr_cycle_stats_mean(&stats), stats.max, stats.count);
+}
 
-  } //end else DYNAMIC
+#if TIMER_TRACE_ENABLED
+/**
+ * @brief Starts a new trace report for the timer period (whole microseconds, like timerAlarmWrite())
+ */
+void setupTimerTrace() {
+  uint32_t cyclesPerMicrosecond = esp_clk_cpu_freq() / 1000000;
+  timer_trace_report_init(&timerTraceReport, cyclesPerMicrosecond * (uint32_t)MICROSECONDS_PER_SAMPLE,
+    cyclesPerMicrosecond, cyclesPerMicrosecond / 4); //quarter microsecond bins
 }
 
+/**
+ * @brief Prints when the onTimer() calls arrived since the last call (in microseconds),
+ * then the report as a binary frame in hex (timer_trace_import() reads it back)
+ */
+void printTimerTrace() {
+  double us = timerTraceReport.cycles_per_us;
+  const timer_trace_histogram_t *latency = &timerTraceReport.latency;
+  const timer_trace_histogram_t *jitter = &timerTraceReport.jitter;
+  Serial.printf("onTimer() latency usec min/mean/p99/max: %.2f / %.2f / %.2f / %.2f, jitter usec min/p99/max: %.2f / %.2f / %.2f (%u calls, %u dropped) \n",
+    latency->min / us, timer_trace_mean(latency) / us, timer_trace_percentile(latency, 990) / us, latency->max / us,
+    jitter->min / us, timer_trace_percentile(jitter, 990) / us, jitter->max / us,
+    latency->count, timerTraceReport.dropped);
+  size_t size = timer_trace_export(&timerTraceReport, timerTraceFrame);
+  Serial.print("TTR ");
+  for (size_t i = 0; i < size; i++){
+    Serial.printf("%02x", timerTraceFrame[i]);
+  }
+  Serial.println();
+  timer_trace_report_reset(&timerTraceReport);
+}
+#endif
+
+#if CYCLE_PROBE_ENABLED
+/**
+ * @brief Prints the cycles of each path through onTimer() since the last call, as a table
+ * (the waveform benchmarks print the same table on the host)
+ */
+void printCycleProbes() {
+  static cycle_probe_table_t snapshot;
+  char line[96];
+  cycle_probe_take(&callbackProbes, &snapshot);
+  Serial.printf("%s  (cycles, less %u for the probe) \n", CYCLE_PROBE_HEADER, snapshot.overhead);
+  for (uint32_t i = 0; i < snapshot.count; i++){
+    if (snapshot.probes[i].stats.count > 0){
+      cycle_probe_format(&snapshot, i, PROBE_PATHS, line, sizeof(line));
+      Serial.println(line);
+    }
+  }
+}
+#endif
+
 /**
  * @brief Configures the callback timer. 
  * The frequency of the callbacks is determined by the SAMPLES_PER_SECOND.
  */
 void setupCallbackTimer() { //TODO my version of function 
   // set up timer 0 to generate a callback to onTimer() every 1 microsecond
-  int timer_id = 1; //the ESP32 has several timers. 
+  int timer_id = TIMER_ID; //the ESP32 has several timers. 
   boolean count_up = true;
 
   timer = timerBegin(timer_id, TIMER_DIVIDER, count_up);
@@ -285,6 +787,108 @@ void setupCallbackTimer() { //TODO my version of function
   timerAlarmEnable(timer);
 }
 
+/**
+ * @brief Changes the STATIC waveform while it plays, from a command line (see generator.h).
+ * The table comes from the waveCache, and is rendered here (not in onTimer()) on a miss.
+ * onTimer() picks the change up at its next zero crossing.
+ */
+void applyCommand(const char *line) {
+  GeneratorSettings next = settings;
+  GeneratorSettings previous = settings;
+  bool rendered = false;
+  const char *error = parseCommand(line, next);
+  if (error != NULL){
+    Serial.println("Error: " + String(error));
+    return;
+  }
+
+  if (next.dacChannel != previous.dacChannel){
+    dac_output_enable((dac_channel_t)next.dacChannel); //ready before onTimer() switches to it
+  }
+  unsigned long start = micros();
+  error = requestSettings(next, &rendered);
+  unsigned long requested = micros();
+  if (error != NULL){
+    if (next.dacChannel != previous.dacChannel){
+      dac_output_disable((dac_channel_t)next.dacChannel);
+    }
+    Serial.println("Error: " + String(error));
+    return;
+  }
+  while (retune_pending(&waveRetune)){
+    //at most half a cycle of the previous frequency, and the fade. sleep, so the other tasks on this core run
+    delay(1);
+  }
+  unsigned long applied = micros();
+
+  //onTimer() wrote the new timer period on the sample it picked up the new increment (see lib/retune)
+  if (next.samplesPerSecond != previous.samplesPerSecond){
+    MICROSECONDS_PER_SAMPLE = MICROSECONDS_PER_SECOND / next.samplesPerSecond;
+    SECONDS_PER_SAMPLE = MICROSECONDS_PER_SAMPLE / 1000000;
+    #if TIMER_TRACE_ENABLED
+    setupTimerTrace(); //the calls are due at the new period
+    #endif
+  }
+  //onTimer() has stopped writing to the previous channel
+  if (next.dacChannel != previous.dacChannel){
+    dac_output_disable((dac_channel_t)previous.dacChannel);
+  }
+
+  Serial.printf("%s %.3lf Hz, attenuation %.2lf, %.0lf samples/s, DAC channel %u \n",
+    shapeName(settings.shape), settings.frequency, settings.attenuation,
+    actualSampleRate(), settings.dacChannel + 1);
+  Serial.printf("Table %s in %lu usec, picked up %lu usec later (%u samples, %u cycles) \n",
+    rendered ? "rendered" : "cached", requested - start, applied - requested,
+    waveRetune.last_samples, waveRetune.last_cycles);
+}
+
+/**
+ * @brief Changes the frequency of the MIPMAP waveform while it plays, from a command line.
+ * Only "f" is accepted: the level that suits the new frequency is already rendered,
+ * and onTimer() picks it at the next sample.
+ */
+void applyMipMapCommand(const char *line) {
+  GeneratorSettings next = settings;
+  const char *error = parseCommand(line, next);
+  if (error == NULL && (next.shape != settings.shape || next.attenuation != settings.attenuation
+      || next.samplesPerSecond != settings.samplesPerSecond || next.dacChannel != settings.dacChannel)){
+    error = "MIPMAP: only the frequency (f) can be changed";
+  }
+  if (error == NULL && !wave_table::validFrequency(next.frequency, actualSampleRate())){
+    error = "the frequency must be positive and at most half the sample rate";
+  }
+  if (error != NULL){
+    Serial.println("Error: " + String(error));
+    return;
+  }
+  dds_mipmap_set_frequency(&mipmapPlayer, next.frequency, actualSampleRate());
+  settings = next;
+  Serial.printf("%s %.3lf Hz, mipmap level %u \n", shapeName(settings.shape), settings.frequency,
+    dds_mipmap_level(&mipmapPlayer, mipmapPlayer.phase_inc));
+}
+
+/**
+ * @brief Prints the min/mean/max latency of the runtime changes since start-up
+ */
+void printRetuneLatency() {
+  isr_cycle_stats_t samples = waveRetune.latency_samples;
+  isr_cycle_stats_t cycles = waveRetune.latency_cycles;
+  if (samples.count == 0){
+    return;
+  }
+  Serial.printf("Retune latency min/mean/max: %u / %u / %u samples, %u / %u / %u cycles (%u changes) \n",
+    samples.min, isr_cycle_stats_mean(&samples), samples.max,
+    cycles.min, isr_cycle_stats_mean(&cycles), cycles.max, samples.count);
+}
+
+/**
+ * @brief Prints how far the SEQUENCE timeline has got
+ */
+void printSequence() {
+  Serial.printf("Sequence: %u events applied, %u repeats, at sample %u \n",
+    sequencer.fired, sequencer.repeats, sequencer.sample);
+}
+
 /**
  * @brief Prints the settings to the terminal
  * 
@@ -298,6 +902,18 @@ void printSettings(){
   Serial.println("Samples Per Cycle    : " + String(SAMPLES_PER_CYCLE) + " samples per cycle");
   Serial.printf( "Seconds Per Sample   : %.8lf seconds \n", SECONDS_PER_SAMPLE);
   Serial.printf( "Microsecs Per Sample : %.3lf usec \n", MICROSECONDS_PER_SAMPLE);
+  Serial.println("Wave Table Size      : " + String(PACKED_TABLE ? sizeof(quarterValues) : MIPMAP ? sizeof(mipmapValues) : sizeof(waveValues))
+    + " bytes" + (PACKED_TABLE ? " (a quarter of the cycle)" : MIPMAP ? " (one table per octave)" : ""));
+  Serial.println("Harmonics            : " + String(HARMONICS) + " (non-sine shapes)");
+  Serial.printf( "Actual Sample Rate   : %.3lf samples per second \n", actualSampleRate());
+  double actualFrequency = dds_frequency_actual(wavePlayer.phase_inc, actualSampleRate());
+  Serial.printf( "Actual Frequency     : %.6lf Hz (error %.6lf Hz, %.3lf ppm) \n", actualFrequency,
+    actualFrequency - FREQUENCY, 1.0e6 * (actualFrequency - FREQUENCY) / FREQUENCY);
+  Serial.printf( "Frequency Resolution : %.9lf Hz \n", dds_frequency_resolution(actualSampleRate()));
+  if (GENERATE_WAVES == DYNAMIC && UPSAMPLE_FACTOR > 1){
+    Serial.printf( "Upsampling           : x%d from %.3lf samples per second, %d taps per phase \n",
+      UPSAMPLE_FACTOR, actualSampleRate() / UPSAMPLE_FACTOR, UPSAMPLE_TAPS);
+  }
 
   int apb_freq = esp_clk_apb_freq();
   Serial.printf( "APB Timer Period     : %.3lf usec\n", apb_freq);
@@ -311,26 +927,6 @@ void printSettings(){
   Serial.println();
 }
 
-void checkConfig(){
-  if (FREQUENCY < 0.0){
-    String msg = "ERROR: checkConfig() FREQUENCY value must be positive. Found FREQUENCY=" + String(FREQUENCY);
-    Serial.println(msg);
-    throw msg;
-  }
-
-  if (SAMPLES_PER_SECOND < 0.0){
-    String msg = "ERROR: checkConfig() SAMPLES_PER_SECOND value must be positive. Found SAMPLES_PER_SECOND=" + String(FREQUENCY);
-    Serial.println(msg);
-    throw msg;
-  }
-
-  if (ATTENUATION > 1.0 || ATTENUATION < 0.0){
-    String msg = "ERROR: checkConfig() ATTENUATION value must be between zero and one. Found ATTENUATION=" + String(ATTENUATION);
-    Serial.println(msg);
-    throw msg;
-  }
-}
-
 void setup() {
   try {
 
@@ -340,13 +936,52 @@ void setup() {
     MICROSECONDS_PER_SAMPLE = MICROSECONDS_PER_SECOND / SAMPLES_PER_SECOND;
     SECONDS_PER_SAMPLE = MICROSECONDS_PER_SAMPLE / 1000000;
 
+    GeneratorSettings initial = {WAVE_SHAPE, FREQUENCY, ATTENUATION, SAMPLES_PER_SECOND, DAC_CHANNEL};
+    generatorBegin(initial, waveValues.values);
+    dds_quarter_init(&quarterPlayer, quarterValues.values, WAVE_TABLE_BITS,
+      wave_table::quarterMiddle<uint8_t>(ATTENUATION, MAX_DAC_AMPLITUDE), FREQUENCY, actualSampleRate());
+    dds_mipmap_init(&mipmapPlayer, mipmapValues.values, MIPMAP ? WAVE_TABLE_BITS : 2, FREQUENCY, actualSampleRate());
+    dds_dual_init(&dualPlayer, waveValues.values, WAVE_TABLE_BITS, FREQUENCY, CHANNEL_2_FREQUENCY,
+      CHANNEL_2_PHASE * PI / 180.0, actualSampleRate());
+    isr_cycle_stats_reset(&callbackCycles);
+    #if TIMER_TRACE_ENABLED
+    timer_trace_init(&timerTrace);
+    setupTimerTrace();
+    #endif
+    #if CYCLE_PROBE_ENABLED
+    cycle_probe_init(&callbackProbes, probeNames, PROBES);
+    #endif
+
     printSettings();
 
-    checkConfig();
+    if (DEBUG){
+      printArray(waveValues.values);
+    }
+
+    if (SEQUENCE){
+      const char *error = sequenceBegin();
+      if (error != NULL){
+        Serial.println("Error in the sequenceSteps[]: " + String(error));
+        return;
+      }
+    }
+
+    if (GENERATE_WAVES == DYNAMIC){
+      setupVoices();
+      setupRenderTask();
+    }
 
-    populateWaveArray();
+    if (GENERATE_WAVES == STREAM && !setupStream()){
+      return;
+    }
 
-    dac_output_enable(DAC_CHANNEL); //do this before setupCallbackTimer() so the output channel is ready
+    //do this before setupCallbackTimer() so the output channels are ready
+    if (DUAL_CHANNEL){
+      dac_output_enable(DAC_CHANNEL_1);
+      dac_output_enable(DAC_CHANNEL_2);
+    } else {
+      dac_output_enable(DAC_CHANNEL);
+    }
 
     setupCallbackTimer(); 
 
@@ -357,14 +992,56 @@ void setup() {
 }
 
 /**
- * @brief Does nothing, since all the work is handled by the timer and onTimer()
+ * @brief Applies the commands sent over the serial port (STATIC) and prints statistics.
+ * The waveform itself is handled by the timer and onTimer()
  */
 void loop()
 {
+  //runtime changes retune the single channel player (not the dualPlayer or the quarterPlayer),
+  //unless the sequencer is changing it
+  while (GENERATE_WAVES == STATIC && !DUAL_CHANNEL && !PACKED_TABLE && !SEQUENCE && Serial.available() > 0){
+    char c = Serial.read();
+    if (c == '\n' || c == '\r'){
+      if (commandLength > 0){
+        commandLine[commandLength] = '\0';
+        commandLength = 0;
+        if (MIPMAP){
+          applyMipMapCommand(commandLine);
+        } else {
+          applyCommand(commandLine);
+        }
+      }
+    } else if (commandLength < sizeof(commandLine) - 1){
+      commandLine[commandLength++] = c;
+    }
+  }
+
+  #if TIMER_TRACE_ENABLED
+  //every pass, so the ring (TIMER_TRACE_RING calls) does not fill up
+  timer_trace_collect(&timerTrace, &timerTraceReport);
+  #endif
+
   unsigned long currentMillis = millis();
   if(currentMillis - previousMillis > interval)
   {
    	previousMillis = currentMillis;
+    printCallbackCycles();
+    #if TIMER_TRACE_ENABLED
+    printTimerTrace();
+    #endif
+    #if CYCLE_PROBE_ENABLED
+    printCycleProbes();
+    #endif
+    printRetuneLatency();
+    if (SEQUENCE){
+      printSequence();
+    }
+    if (GENERATE_WAVES == DYNAMIC){
+      printBufferStats();
+    }
+    if (GENERATE_WAVES == STREAM){
+      printStreamStats();
+    }
   }
 }
 
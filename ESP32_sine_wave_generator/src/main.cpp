@@ -33,20 +33,26 @@
 #include "driver/timer.h"
 // #include "clk.h"
 #include "math.h"
+#include "wave_table.h"
+#include "dds.h"
+#include "isr_safe.h"
 
 //Configurable items: specify the output frequency, sample rate, attenuation and DAC Channel
 #define FREQUENCY           2000    // the desired frequency (Hz) of the output waveform
 #define SAMPLES_PER_SECOND  180000  // (180000 max) ADC samples per second. Per Nyquist, set this at least 2 x FREQUENCY
 #define ATTENUATION         1.0     // output waveform voltage attenuation (must be 1.0 or less)
 #define DAC_CHANNEL         DAC_CHANNEL_1 // the waveform output pin. (e.g., DAC_CHANNEL_1 or DAC_CHANNEL_2)
+#define INTERPOLATE         false   // interpolate linearly between table entries (smoother, slightly slower)
+#define FAST_DAC_WRITE      true    // true: IRAM safe register write. false: dac_output_voltage() (in flash, slower)
 
 //These items should probably be left as-is
 #define DAC_BIT_DEPTH       8       // ESP32: 8 bits (fixed within ESP32 hardware)
 #define DEBUG               false
+#define WAVE_TABLE_BITS     10      // the wave table holds 2^10 = 1024 samples of one cycle, for any FREQUENCY
  
 //Do NOT change the following 
 #define VERTICAL_OFFSET     1.0     // must be 1.0, in order to avoid negative output voltages
-#define SAMPLES_PER_CYCLE   SAMPLES_PER_SECOND/FREQUENCY 
+#define SAMPLES_PER_CYCLE   ((double)SAMPLES_PER_SECOND/FREQUENCY)   // need not be a whole number
 #define MAX_DAC_VALUE       255     // (255) the maximum ESP32 DAC value, peak-to-peak (8 bit DAC fixed in hardware)
 #define MAX_DAC_AMPLITUDE   127     // (127) amplitude is half of peak-to-peak
 #define TIMER_DIVIDER       80      // (80) timer frequency divider. timer runs at 80MHz by default. 
@@ -55,10 +61,21 @@ double MICROSECONDS_PER_SAMPLE = 0.0;  //set automatically at runtime.
 double SECONDS_PER_SAMPLE = 0.0;       //set automatically at runtime.
 const double MICROSECONDS_PER_SECOND = 1000000.0; //the timer has a resolution of 1 microsecond (nice!) 
 
-//the array that will hold all of the digital waveform values
-int waveValues[SAMPLES_PER_CYCLE];
-//holds the current index to the waveValues array 
-int currentWaveSample = 0;
+//the configuration is checked by the compiler (this used to be done at runtime by checkConfig())
+static_assert(wave_table::validFrequency(FREQUENCY, SAMPLES_PER_SECOND), "FREQUENCY must be positive and at most SAMPLES_PER_SECOND/2");
+static_assert(wave_table::validAttenuation(ATTENUATION), "ATTENUATION must be between 0.0 and 1.0");
+
+//one cycle of the waveform as 8-bit DAC values, computed by the compiler (see lib/wave_table).
+//it stays in flash unless built with -D WAVE_TABLE_IN_DRAM=1 (see platformio.ini)
+WAVE_TABLE_ATTR constexpr auto waveValues = 
+  wave_table::makeSineCycle<1 << WAVE_TABLE_BITS>(ATTENUATION, MAX_DAC_AMPLITUDE, VERTICAL_OFFSET);
+
+//steps through the waveValues with a fractional phase increment, so FREQUENCY
+//does not have to divide SAMPLES_PER_SECOND (see lib/dds)
+dds_table_player_t wavePlayer;
+
+//CPU cycles spent in each onTimer() call (see lib/isr_safe)
+isr_cycle_stats_t callbackCycles;
 
 unsigned long previousMillis = 0UL;
 unsigned long interval = 120000UL; //120 seconds
@@ -102,51 +119,47 @@ void printArray(const T (&arr)[N]) {
 }
 
 /**
- * @brief Populates the global array with one complete cycle of sinusoid data
- * 
- * Since we know the SAMPLES_PER_CYCLE of the waveform, we'll put that many values into the array.
- * The timer will call function onTimer() at the precise rate needed to produce the desired 
- * output frequency. 
- * 
- * @param 
- * @return void
+ * @brief Returns the rate at which onTimer() is really called. 
+ * timerAlarmWrite() works in whole microseconds, so this can differ from SAMPLES_PER_SECOND.
  */
-void populateWaveArray() {
-  int count = sizeof(waveValues) / sizeof(waveValues[0]);
-  for (int i = 0; i < count; i++) {
-    float angleInDegrees = ((float)i) * (360.0/((float)SAMPLES_PER_CYCLE));
-    float angleInRadians = DEG_TO_RAD * angleInDegrees;
-    if (DEBUG){
-      Serial.println("i : degrees : radians " + String(i) + " : " + String(angleInDegrees) + " : " + String(angleInRadians));
-    }
-    //note: a vertical offset is needed to avoid negative output voltages 
-    long value = MAX_DAC_AMPLITUDE * ATTENUATION * (VERTICAL_OFFSET + sin(angleInRadians));
-    waveValues[i] = value;
-  }
-  if (DEBUG){
-    printArray(waveValues);
-  }
+double actualSampleRate() {
+  return MICROSECONDS_PER_SECOND / (uint64_t)MICROSECONDS_PER_SAMPLE;
 }
 
 /** 
  * The function generates and outputs the sine wave to the DAC channel.
  * It is called periodically by the timer. 
  * This function:
- *  1) gets a value of the waveform from an array (one sample step's value)
+ *  1) gets a value of the waveform from the table at the current phase
  *  2) outputs the value to the DAC channel
- *  3) advances the array index or resets it to zero (the sample's step number) 
+ *  3) advances the phase by the (fractional) phase increment
+ * 
+ * It runs in IRAM and uses integer math only (the FPU is not saved for interrupts).
+ * Everything it reads is in DRAM (build with -D WAVE_TABLE_IN_DRAM=1, see platformio.ini).
 */
-void onTimer() {
+void IRAM_ATTR onTimer() {
+  uint32_t startCycles = isr_cycle_count();
 
-  // get the waveform value from the array
-  int waveform_value = waveValues[currentWaveSample];
+  // get the waveform value from the table and advance the phase
+  uint8_t waveform_value = INTERPOLATE ? dds_table_next_interp(&wavePlayer) : dds_table_next(&wavePlayer);
   // output the voltage to the DAC_CHANNEL
-  dac_output_voltage(DAC_CHANNEL, waveform_value);
-  // advance the array index or reset to zero
-  currentWaveSample++;
-  if (currentWaveSample >= SAMPLES_PER_CYCLE){
-    currentWaveSample = 0;
-  } 
+  if (FAST_DAC_WRITE){
+    isr_dac_write(DAC_CHANNEL, waveform_value);
+  } else {
+    dac_output_voltage(DAC_CHANNEL, waveform_value);
+  }
+
+  isr_cycle_stats_add(&callbackCycles, isr_cycle_count() - startCycles);
+}
+
+/**
+ * @brief Prints the min/mean/max CPU cycles spent in onTimer() since the last call
+ */
+void printCallbackCycles() {
+  isr_cycle_stats_t stats = callbackCycles;
+  isr_cycle_stats_reset(&callbackCycles);
+  Serial.printf("onTimer() cycles min/mean/max: %u / %u / %u (%u calls) \n", 
+    stats.min, isr_cycle_stats_mean(&stats), stats.max, stats.count);
 }
 
 /**
@@ -174,9 +187,15 @@ void printSettings(){
   Serial.println("=======================================================");  
   Serial.printf("Frequency            : %d Hz \n", FREQUENCY);
   Serial.printf("Sample Rate          : %d samples per second \n", SAMPLES_PER_SECOND);
-  Serial.printf("Samples Per Cycle    : %d samples per cycle \n", SAMPLES_PER_CYCLE);
+  Serial.printf("Samples Per Cycle    : %.3lf samples per cycle \n", SAMPLES_PER_CYCLE);
   // Serial.printf("Seconds Per Sample   : %.9lf seconds \n", SECONDS_PER_SAMPLE);
   Serial.printf("Microsecs Per Sample : %.3lf usec \n", MICROSECONDS_PER_SAMPLE);
+  Serial.printf("Wave Table Size      : %d bytes \n", (int)sizeof(waveValues));
+  Serial.printf("Actual Sample Rate   : %.3lf samples per second \n", actualSampleRate());
+  double actualFrequency = dds_frequency_actual(wavePlayer.phase_inc, actualSampleRate());
+  Serial.printf("Actual Frequency     : %.6lf Hz (error %.6lf Hz, %.3lf ppm) \n", actualFrequency,
+    actualFrequency - FREQUENCY, 1.0e6 * (actualFrequency - FREQUENCY) / FREQUENCY);
+  Serial.printf("Frequency Resolution : %.9lf Hz \n", dds_frequency_resolution(actualSampleRate()));
 
   // commented out to avoid compile failure in ESP-IDF version 5.1 (clk.h was made private) 
   // int apb_freq = esp_clk_apb_freq();
@@ -191,26 +210,6 @@ void printSettings(){
   Serial.println();
 }
 
-void checkConfig(){
-  if (FREQUENCY < 0.0){
-    String msg = "ERROR: checkConfig() FREQUENCY value must be positive. Found FREQUENCY=" + String(FREQUENCY);
-    Serial.println(msg);
-    throw msg;
-  }
-
-  if (SAMPLES_PER_SECOND < 0.0){
-    String msg = "ERROR: checkConfig() SAMPLES_PER_SECOND value must be positive. Found SAMPLES_PER_SECOND=" + String(FREQUENCY);
-    Serial.println(msg);
-    throw msg;
-  }
-
-  if (ATTENUATION > 1.0 || ATTENUATION < 0.0){
-    String msg = "ERROR: checkConfig() ATTENUATION value must be between zero and one. Found ATTENUATION=" + String(ATTENUATION);
-    Serial.println(msg);
-    throw msg;
-  }
-}
-
 void setup() {
   try {
 
@@ -220,11 +219,14 @@ void setup() {
     MICROSECONDS_PER_SAMPLE = MICROSECONDS_PER_SECOND / SAMPLES_PER_SECOND;
     SECONDS_PER_SAMPLE = MICROSECONDS_PER_SAMPLE / 1000000;
 
-    printSettings();
+    dds_table_init(&wavePlayer, waveValues.values, WAVE_TABLE_BITS, FREQUENCY, actualSampleRate());
+    isr_cycle_stats_reset(&callbackCycles);
 
-    checkConfig();
+    printSettings();
 
-    populateWaveArray();
+    if (DEBUG){
+      printArray(waveValues.values);
+    }
 
     dac_output_enable(DAC_CHANNEL); //do this before setupCallbackTimer() so the output channel is ready
 
@@ -254,4 +256,5 @@ void setup() {
 void loop(){
   //do nothing, since the timer and its callbacks to onTimer() handle ALL of the work 
   delay(60000);
+  printCallbackCycles();
 }
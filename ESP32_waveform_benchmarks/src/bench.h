@@ -0,0 +1,92 @@
+/**
+ * Helpers shared by the benchmarks. Each bench_*.c file exercises one of the
+ * libraries in ../lib and prints its results to the console.
+ *
+ * The same sources build for the ESP32 (esp32dev env) and for the host
+ * (native env), so the numbers can be compared directly.
+ *
+ * @file bench.h
+ * @author Philip Giacalone
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define BENCH_PLATFORM      "esp32"
+#define BENCH_SAMPLES       100000      // keep each run short enough for the task watchdog
+
+static inline int64_t bench_now_us(void) {
+    return esp_timer_get_time();
+}
+
+// let the idle task run between benchmarks (keeps the task watchdog happy)
+static inline void bench_yield(void) {
+    vTaskDelay(10 / portTICK_PERIOD_MS);
+}
+#else
+#include <time.h>
+
+#define BENCH_PLATFORM      "native"
+#define BENCH_SAMPLES       10000000
+
+static inline int64_t bench_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline void bench_yield(void) {
+}
+#endif
+
+// results are written here so the compiler cannot optimize the work away
+extern volatile int32_t bench_sink;
+
+// converts a sample count and elapsed time into samples per second
+static inline double bench_rate(int64_t samples, int64_t elapsed_us) {
+    return elapsed_us > 0 ? samples * 1000000.0 / elapsed_us : 0.0;
+}
+
+// in place radix 2 FFT of size (a power of 2) complex values (see bench_noise.c)
+void bench_fft(float *re, float *im, uint32_t size);
+
+void bench_dds(void);
+void bench_envelope(void);
+void bench_block_buffer(void);
+void bench_wave_table(void);
+void bench_fractional(void);
+void bench_isr(void);
+void bench_shapes(void);
+void bench_rotor(void);
+void bench_wave_cache(void);
+void bench_sample_stream(void);
+void bench_sweep(void);
+void bench_noise(void);
+void bench_upsample(void);
+void bench_quantize(void);
+void bench_modulation(void);
+void bench_quarter(void);
+void bench_hot_swap(void);
+void bench_sequencer(void);
+void bench_mipmap(void);
+void bench_fast_trig(void);
+void bench_time_base(void);
+void bench_timer_trace(void);
+void bench_cycle_probe(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BENCH_H
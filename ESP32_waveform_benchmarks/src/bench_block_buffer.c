@@ -0,0 +1,80 @@
+/**
+ * Block buffer: what the timer callback pays per sample when it only copies
+ * from the block buffer, against rendering an 8 voice mix inline.
+ *
+ * @file bench_block_buffer.c
+ * @author Philip Giacalone
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "block_buffer.h"
+#include "dds.h"
+#include "envelope.h"
+
+#define BENCH_SAMPLE_RATE   100000.0
+#define BENCH_VOICES        8
+
+static dds_voice_t voices[BENCH_VOICES];
+static envelope_t envelopes[BENCH_VOICES];
+static block_buffer_t buffer;
+
+static uint8_t render_sample(void) {
+    int32_t y = 0;
+    for (int v = 0; v < BENCH_VOICES; v++) {
+        y += envelope_apply(&envelopes[v], dds_voice_next(&voices[v]));
+    }
+    return (uint8_t)((127 * y) >> 18);     // 8 voices, scaled down by 8
+}
+
+void bench_block_buffer(void) {
+    dds_init();
+    for (int v = 0; v < BENCH_VOICES; v++) {
+        dds_voice_init(&voices[v], 1000.0 + 100.0 * v, 1.0, 0.0, 1.0, BENCH_SAMPLE_RATE);
+        envelope_init(&envelopes[v], 0.0, 0.02, 0.0, 0.0, BENCH_SAMPLE_RATE);
+        envelope_trigger(&envelopes[v]);
+    }
+
+    printf("\n--- Block buffer (%d samples per block), %d voice mix ---\n",
+           BLOCK_BUFFER_SAMPLES, BENCH_VOICES);
+
+    // everything inside the callback, one sample at a time
+    int64_t start = bench_now_us();
+    for (int64_t n = 0; n < BENCH_SAMPLES; n++) {
+        bench_sink = render_sample();
+    }
+    int64_t inline_us = bench_now_us() - start;
+    bench_yield();
+
+    // render task fills blocks, callback only copies (interleaved on one core here)
+    block_buffer_init(&buffer, 127);
+    int64_t render_us = 0;
+    int64_t read_us = 0;
+    for (int64_t n = 0; n < BENCH_SAMPLES; n += BLOCK_BUFFER_SAMPLES) {
+        start = bench_now_us();
+        uint8_t *block;
+        while ((block = block_buffer_acquire(&buffer)) != NULL) {
+            for (int i = 0; i < BLOCK_BUFFER_SAMPLES; i++) {
+                block[i] = render_sample();
+            }
+            block_buffer_commit(&buffer);
+        }
+        int64_t rendered = bench_now_us();
+        uint8_t sample;
+        for (int i = 0; i < BLOCK_BUFFER_SAMPLES; i++) {
+            block_buffer_read(&buffer, &sample);
+            bench_sink = sample;
+        }
+        read_us += bench_now_us() - rendered;
+        render_us += rendered - start;
+    }
+    bench_yield();
+
+    printf("inline render (callback)   : %12.0f samples/s\n", bench_rate(BENCH_SAMPLES, inline_us));
+    printf("block render (task)        : %12.0f samples/s\n", bench_rate(BENCH_SAMPLES, render_us));
+    printf("block read (callback)      : %12.0f samples/s\n", bench_rate(BENCH_SAMPLES, read_us));
+    printf("underruns: %u, fill min/mean/max: %u/%u/%u samples\n",
+           (unsigned)buffer.stats.underruns, (unsigned)buffer.stats.min_fill,
+           (unsigned)block_buffer_mean_fill(&buffer), (unsigned)buffer.stats.max_fill);
+}
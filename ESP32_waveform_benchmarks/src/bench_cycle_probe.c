@@ -0,0 +1,171 @@
+/**
+ * Per-path cycle cost (lib/cycle_probe): the cost table the firmware prints
+ * with -D CYCLE_PROBE_ENABLED=1, for the same paths on this machine.
+ *
+ * A callback takes one path per call, in turn, each probed up to and
+ * including its DAC write (probed on its own as well), like onTimer() and
+ * periodic_timer_callback():
+ *
+ *   static table    onTimer() STATIC: dds_table_next()
+ *   dynamic         onTimer() DYNAMIC: a sample rendered ahead (block_buffer_read())
+ *   dynamic +wake   the same, when it uses up a block (the firmware wakes renderTask())
+ *   version 0       periodic_timer_callback() VERSION 0: two fast_trig sines in float
+ *   version 1       periodic_timer_callback() VERSION 1: two Q15 DDS voices and envelopes
+ *   dac write       isr_dac_write() on the ESP32, a store here
+ *
+ * Then version 1 runs without probes, to compare its row with the plain cost.
+ *
+ * @file bench_cycle_probe.c
+ * @author Philip Giacalone
+ */
+
+// the probes are always on here
+#define CYCLE_PROBE_ENABLED 1
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "block_buffer.h"
+#include "cycle_probe.h"
+#include "dds.h"
+#include "envelope.h"
+#include "fast_trig.h"
+#include "isr_safe.h"
+#include "time_base.h"
+
+#define BENCH_PROBE_RATE    100000.0
+#define BENCH_PROBE_CALLS   400000
+#define BENCH_PROBE_WAVES   2
+
+enum {
+    PROBE_STATIC = 0,
+    PROBE_DYNAMIC,
+    PROBE_DYNAMIC_WAKE,
+    PROBE_VERSION_0,
+    PROBE_VERSION_1,
+    PROBE_PATHS,
+    PROBE_DAC_WRITE = PROBE_PATHS,
+    PROBES
+};
+
+static const char *const probe_names[PROBES] = {"static table", "dynamic", "dynamic +wake", "version 0",
+                                                "version 1", "dac write"};
+
+static cycle_probe_table_t probes;
+static cycle_probe_table_t snapshot;
+static dds_table_player_t player;
+static block_buffer_t buffer;
+static dds_voice_t voices[BENCH_PROBE_WAVES];
+static envelope_t envelopes[BENCH_PROBE_WAVES];
+static time_base_t time_base;
+static uint64_t wave_increment[BENCH_PROBE_WAVES];
+static uint8_t table[1 << 10];
+static volatile uint8_t dac;
+
+ISR_INLINE void write_dac(uint8_t value) {
+    CYCLE_PROBE_BEGIN(write);
+#ifdef ESP_PLATFORM
+    isr_dac_write(DAC_CHANNEL_1, value);
+#else
+    dac = value;
+#endif
+    CYCLE_PROBE_END(&probes, PROBE_DAC_WRITE, write);
+}
+
+// VERSION 1 of periodic_timer_callback(), before the DAC write
+ISR_INLINE uint8_t version_1(void) {
+    int32_t y = 0;
+    for (int i = 0; i < BENCH_PROBE_WAVES; i++) {
+        y += envelope_apply(&envelopes[i], dds_voice_next(&voices[i]));
+    }
+    int32_t output = (127 * y) >> 15;
+    return (uint8_t)(output > 255 ? 255 : output);
+}
+
+// VERSION 0, before the DAC write
+ISR_INLINE uint8_t version_0(void) {
+    float sin1 = fast_trig_sin(FAST_TRIG_POLY, time_base_phase(&time_base, wave_increment[0])) / (float)FAST_TRIG_ONE;
+    float sin2 = fast_trig_sin(FAST_TRIG_POLY, time_base_phase(&time_base, wave_increment[1])) / (float)FAST_TRIG_ONE;
+    time_base_tick(&time_base);
+    float waveform1 = 0.5f * (127.0f + 127.0f * (0.5f * sin1));
+    float waveform2 = 0.5f * (127.0f + 127.0f * (0.1f * sin2));
+    return (uint8_t)(int)(waveform1 + waveform2);
+}
+
+// one callback, taking the given path
+static void callback(int path) {
+    uint32_t start_cycles = isr_cycle_count();
+    if (path == PROBE_STATIC) {
+        write_dac(dds_table_next(&player));
+        CYCLE_PROBE_END(&probes, PROBE_STATIC, start_cycles);
+    } else if (path == PROBE_DYNAMIC) {
+        uint8_t value;
+        bool released = block_buffer_read(&buffer, &value);
+        write_dac(value);
+        CYCLE_PROBE_END(&probes, released ? PROBE_DYNAMIC_WAKE : PROBE_DYNAMIC, start_cycles);
+    } else if (path == PROBE_VERSION_0) {
+        write_dac(version_0());
+        CYCLE_PROBE_END(&probes, PROBE_VERSION_0, start_cycles);
+    } else {
+        write_dac(version_1());
+        CYCLE_PROBE_END(&probes, PROBE_VERSION_1, start_cycles);
+    }
+}
+
+// renders the free blocks, as renderTask() would
+static void render(void) {
+    uint8_t *block;
+    while ((block = block_buffer_acquire(&buffer)) != NULL) {
+        for (int i = 0; i < BLOCK_BUFFER_SAMPLES; i++) {
+            block[i] = version_1();
+        }
+        block_buffer_commit(&buffer);
+    }
+}
+
+static void setup(void) {
+    for (int i = 0; i < (1 << 10); i++) {
+        table[i] = (uint8_t)(128 + 127 * sin(2 * M_PI * i / (1 << 10)));
+    }
+    dds_table_init(&player, table, 10, 1000.0, BENCH_PROBE_RATE);
+    dds_init();
+    for (int i = 0; i < BENCH_PROBE_WAVES; i++) {
+        dds_voice_init(&voices[i], i == 0 ? 1000.0 : 10.0, i == 0 ? 0.8 : 0.2, 0.0, 1.0, BENCH_PROBE_RATE);
+        envelope_init(&envelopes[i], 0.0, 0.02, 0.0, 0.0, BENCH_PROBE_RATE);
+        envelope_trigger(&envelopes[i]);
+    }
+    block_buffer_init(&buffer, 127);
+    fast_trig_init();
+    time_base_init(&time_base, BENCH_PROBE_RATE);
+    wave_increment[0] = time_base_increment(&time_base, 100.0);
+    wave_increment[1] = time_base_increment(&time_base, 1000.0);
+}
+
+void bench_cycle_probe(void) {
+    printf("\n--- Per-path callback cost (%d calls, the paths in turn) ---\n", BENCH_PROBE_CALLS);
+    setup();
+    cycle_probe_init(&probes, probe_names, PROBES);
+
+    for (int n = 0; n < BENCH_PROBE_CALLS; n++) {
+        render();
+        callback(n % 4 == 0 ? PROBE_STATIC : n % 4 == 1 ? PROBE_DYNAMIC : n % 4 == 2 ? PROBE_VERSION_0 : PROBE_VERSION_1);
+    }
+    bench_yield();
+
+    cycle_probe_take(&probes, &snapshot);
+    char line[96];
+    printf("%s  (cycles, less %u for the probe)\n", CYCLE_PROBE_HEADER, (unsigned)snapshot.overhead);
+    for (uint32_t i = 0; i < snapshot.count; i++) {
+        cycle_probe_format(&snapshot, i, PROBE_PATHS, line, sizeof(line));
+        printf("%s\n", line);
+    }
+
+    // the same path without probes: its cost includes the DAC write, but not the nested probe
+    uint32_t start = isr_cycle_count();
+    for (int n = 0; n < BENCH_PROBE_CALLS / 4; n++) {
+        dac = version_1();
+    }
+    double plain = (double)(uint32_t)(isr_cycle_count() - start) / (BENCH_PROBE_CALLS / 4);
+    printf("version 1 without probes: %.1f cycles/call (a tight loop, so less than the mean above)\n", plain);
+}
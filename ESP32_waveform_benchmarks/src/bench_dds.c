@@ -0,0 +1,72 @@
+/**
+ * DDS throughput: samples/sec for 1..8 voices, compared against the
+ * per-sample sin() of the time based code in ESP32_dynamic_waveforms.
+ *
+ * @file bench_dds.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "dds.h"
+
+#ifndef M_TWOPI
+#define M_TWOPI (2.0 * M_PI)
+#endif
+
+#define BENCH_SAMPLE_RATE   100000.0
+#define BENCH_MAX_VOICES    8
+
+// the old way: sin(2πft + φ) with t derived from the sample count
+static int64_t run_libm(int voiceCount, int64_t samples) {
+    int64_t start = bench_now_us();
+    for (int64_t n = 0; n < samples; n++) {
+        double _t_ = n / BENCH_SAMPLE_RATE;
+        float y = 0;
+        for (int v = 0; v < voiceCount; v++) {
+            float angle = M_TWOPI * (1000.0 + 100.0 * v) * _t_;
+            y = y + (127 * 0.1 * (1.0 + sin(angle)));
+        }
+        bench_sink = (int32_t)y;
+    }
+    return bench_now_us() - start;
+}
+
+static int64_t run_dds(int voiceCount, int64_t samples) {
+    dds_voice_t voices[BENCH_MAX_VOICES];
+    for (int v = 0; v < voiceCount; v++) {
+        dds_voice_init(&voices[v], 1000.0 + 100.0 * v, 0.1, 0.0, 1.0, BENCH_SAMPLE_RATE);
+    }
+
+    int64_t start = bench_now_us();
+    for (int64_t n = 0; n < samples; n++) {
+        int32_t y = 0;
+        for (int v = 0; v < voiceCount; v++) {
+            y += dds_voice_next(&voices[v]);
+        }
+        bench_sink = (127 * y) >> 15;
+    }
+    return bench_now_us() - start;
+}
+
+void bench_dds(void) {
+    dds_init();
+
+    printf("\n--- DDS (phase accumulator + %d entry table) vs libm sin() ---\n", DDS_TABLE_SIZE);
+    printf("voices   libm samples/s   DDS samples/s   DDS voice-samples/s   speedup\n");
+
+    for (int voiceCount = 1; voiceCount <= BENCH_MAX_VOICES; voiceCount *= 2) {
+        int64_t libm_us = run_libm(voiceCount, BENCH_SAMPLES);
+        bench_yield();
+        int64_t dds_us = run_dds(voiceCount, BENCH_SAMPLES);
+        bench_yield();
+
+        double libm_rate = bench_rate(BENCH_SAMPLES, libm_us);
+        double dds_rate = bench_rate(BENCH_SAMPLES, dds_us);
+        printf("%6d   %14.0f   %13.0f   %19.0f   %6.1fx\n",
+               voiceCount, libm_rate, dds_rate, dds_rate * voiceCount,
+               libm_rate > 0 ? dds_rate / libm_rate : 0.0);
+    }
+}
@@ -0,0 +1,73 @@
+/**
+ * Envelope cost and accuracy: one multiply per sample (lib/envelope) against
+ * pow(M_E, -a * t) per sample, plus the drift from the exact e^(-at).
+ *
+ * @file bench_envelope.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "envelope.h"
+
+#define BENCH_SAMPLE_RATE   100000.0
+#define BENCH_DECAY         0.02        // same as ESP32_dynamic_waveforms
+
+void bench_envelope(void) {
+    printf("\n--- Envelope (Q30 multiply per sample) vs pow() per sample ---\n");
+
+    int64_t start = bench_now_us();
+    for (int64_t n = 0; n < BENCH_SAMPLES; n++) {
+        double _t_ = n / BENCH_SAMPLE_RATE;
+        float exponential = pow(M_E, (-1) * BENCH_DECAY * _t_);
+        bench_sink = (int32_t)(exponential * 32767);
+    }
+    int64_t pow_us = bench_now_us() - start;
+    bench_yield();
+
+    envelope_t env;
+    envelope_init(&env, 0.0, BENCH_DECAY, 0.0, 0.0, BENCH_SAMPLE_RATE);
+    envelope_trigger(&env);
+    start = bench_now_us();
+    for (int64_t n = 0; n < BENCH_SAMPLES; n++) {
+        bench_sink = envelope_apply(&env, 32767);
+    }
+    int64_t env_us = bench_now_us() - start;
+    bench_yield();
+
+    double max_error = 0.0;
+    // accuracy, checked in a separate pass so it does not count towards the timing
+    envelope_init(&env, 0.0, BENCH_DECAY, 0.0, 0.0, BENCH_SAMPLE_RATE);
+    envelope_trigger(&env);
+    for (int64_t n = 1; n <= BENCH_SAMPLES; n++) {
+        envelope_next(&env);
+        double exact = exp(-BENCH_DECAY * n / BENCH_SAMPLE_RATE);
+        double error = fabs(envelope_level(&env) - exact);
+        if (error > max_error) {
+            max_error = error;
+        }
+    }
+
+    printf("pow()     : %12.0f samples/s\n", bench_rate(BENCH_SAMPLES, pow_us));
+    printf("envelope  : %12.0f samples/s\n", bench_rate(BENCH_SAMPLES, env_us));
+    printf("max |error| vs exp() over %lld samples (%.1f s): %.3g\n",
+           (long long)BENCH_SAMPLES, BENCH_SAMPLES / BENCH_SAMPLE_RATE, max_error);
+
+    // an ADSR shape: 10 ms attack, decay to 50%, release after 100 ms
+    envelope_init(&env, 0.010, 50.0, 0.5, 20.0, BENCH_SAMPLE_RATE);
+    envelope_trigger(&env);
+    printf("ADSR (10 ms attack, sustain 0.5, release at 100 ms):\n");
+    for (int ms = 0; ms <= 200; ms++) {
+        if (ms == 100) {
+            envelope_release(&env);
+        }
+        if (ms % 20 == 0 || ms == 10) {
+            printf("  %3d ms  %.4f\n", ms, envelope_level(&env));
+        }
+        for (int n = 0; n < BENCH_SAMPLE_RATE / 1000; n++) {
+            envelope_next(&env);
+        }
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * Fast sine tiers (lib/fast_trig) against libm sin() and sinf() and the
+ * FastTrig library's isin(), which the projects used before:
+ *
+ *   max error   the largest difference from sin() (in double precision) over
+ *               BENCH_TRIG_POINTS phases spread over the whole cycle, checked
+ *               against the max error published in fast_trig_tiers[]
+ *   cycles      per call, in a loop like the timer callback's (one phase
+ *               step and one call per sample)
+ *
+ * Each one takes its own kind of angle: the tiers a 32-bit phase, libm
+ * radians and isin() degrees, converted from the phase in the loop.
+ *
+ * FastTrig needs Arduino.h, so it cannot build here (an espidf and a native
+ * env). fasttrig_isin() below is its isin() algorithm (FastTrig 0.1.x by Rob
+ * Tillaart, MIT license): a 91 entry table of whole degrees, scaled to
+ * 65535, with linear interpolation in 1/256 degree steps.
+ *
+ * @file bench_fast_trig.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "fast_trig.h"
+#include "isr_safe.h"
+
+#define BENCH_TRIG_POINTS   (1 << 22)
+#define BENCH_TRIG_STEP     0x9E3779B9U     // 2^32 / the golden ratio: every step lands somewhere new
+#define BENCH_TRIG_RADIANS  (2.0 * M_PI / 4294967296.0)
+#define BENCH_TRIG_DEGREES  (360.0 / 4294967296.0)
+
+static uint16_t fasttrig_table[91];
+
+static void fasttrig_init(void) {
+    for (int i = 0; i <= 90; i++) {
+        fasttrig_table[i] = (uint16_t)lround(65535.0 * sin(i * M_PI / 180.0));
+    }
+}
+
+static float fasttrig_isin(float f) {
+    int pos = 1;
+    if (f < 0) {
+        f = -f;
+        pos = !pos;
+    }
+    long x = (long)f;
+    uint8_t r = (uint8_t)((f - x) * 256);
+    if (x >= 360) {
+        x %= 360;
+    }
+    int y = (int)x;
+    if (y >= 180) {
+        y -= 180;
+        pos = !pos;
+    }
+    if (y >= 90) {
+        y = 180 - y;
+        if (r != 0) {
+            r = 255 - r;
+            y--;
+        }
+    }
+    uint16_t v = fasttrig_table[y];
+    if (r > 0) {
+        v += ((fasttrig_table[y + 1] - v) / 8 * r) / 32;
+    }
+    return pos ? v * 0.0000152590219f : v * -0.0000152590219f;
+}
+
+// the tiers, then the references
+enum {
+    BENCH_TRIG_CORDIC_COS = FAST_TRIG_TIERS,
+    BENCH_TRIG_SIN,
+    BENCH_TRIG_SINF,
+    BENCH_TRIG_ISIN
+};
+
+// sin(phase) (the cosine for BENCH_TRIG_CORDIC_COS), 1.0 = full scale. inlined, so a constant which picks one at compile time
+ISR_INLINE double bench_trig(int which, uint32_t phase) {
+    int32_t cos;
+    switch (which) {
+        case FAST_TRIG_LUT: return fast_trig_sin_lut(phase) / (double)FAST_TRIG_ONE;
+        case FAST_TRIG_LUT_INTERP: return fast_trig_sin_lut_interp(phase) / (double)FAST_TRIG_ONE;
+        case FAST_TRIG_POLY: return fast_trig_sin_poly(phase) / (double)FAST_TRIG_ONE;
+        case FAST_TRIG_CORDIC: return fast_trig_sin_cordic(phase) / (double)FAST_TRIG_ONE;
+        case BENCH_TRIG_CORDIC_COS:
+            fast_trig_sin_cos_cordic(phase, &cos);
+            return cos / (double)FAST_TRIG_ONE;
+        case BENCH_TRIG_SIN: return sin(phase * BENCH_TRIG_RADIANS);
+        case BENCH_TRIG_SINF: return sinf((float)(phase * BENCH_TRIG_RADIANS));
+        default: return fasttrig_isin((float)(phase * BENCH_TRIG_DEGREES));
+    }
+}
+
+// the same in Q15, the way a timer callback would use it
+ISR_INLINE int32_t bench_trig_q15(int which, uint32_t phase) {
+    int32_t cos;
+    switch (which) {
+        case FAST_TRIG_LUT: return fast_trig_sin_lut(phase);
+        case FAST_TRIG_LUT_INTERP: return fast_trig_sin_lut_interp(phase);
+        case FAST_TRIG_POLY: return fast_trig_sin_poly(phase);
+        case FAST_TRIG_CORDIC: return fast_trig_sin_cordic(phase);
+        case BENCH_TRIG_CORDIC_COS: return fast_trig_sin_cos_cordic(phase, &cos) + cos;
+        case BENCH_TRIG_SIN: return (int32_t)(FAST_TRIG_ONE * sin(phase * BENCH_TRIG_RADIANS));
+        case BENCH_TRIG_SINF: return (int32_t)(FAST_TRIG_ONE * sinf((float)(phase * BENCH_TRIG_RADIANS)));
+        default: return (int32_t)(FAST_TRIG_ONE * fasttrig_isin((float)(phase * BENCH_TRIG_DEGREES)));
+    }
+}
+
+static double max_error(int which) {
+    double worst = 0.0;
+    uint32_t phase = 0;
+    for (uint32_t n = 0; n < BENCH_TRIG_POINTS; n++) {
+        double angle = phase * BENCH_TRIG_RADIANS;
+        double exact = which == BENCH_TRIG_CORDIC_COS ? cos(angle) : sin(angle);
+        double error = fabs(bench_trig(which, phase) - exact);
+        worst = error > worst ? error : worst;
+        phase += BENCH_TRIG_STEP;
+    }
+    return worst;
+}
+
+// the mean cycles of one phase step and one call. inlined, so each call site times its own loop
+ISR_INLINE double cycles_per_call(int which) {
+    uint32_t phase = 0;
+    uint32_t start = isr_cycle_count();
+    for (uint32_t n = 0; n < BENCH_SAMPLES; n++) {
+        bench_sink = bench_trig_q15(which, phase);
+        phase += 0x01234567U;
+    }
+    return (double)(uint32_t)(isr_cycle_count() - start) / BENCH_SAMPLES;
+}
+
+static void print_row(const char *name, double error, double published, double cycles, uint32_t bytes) {
+    printf("%-12s max error %.2e", name, error);
+    if (published > 0.0) {
+        printf(" (published %.1e, %s)", published, error <= published ? "ok" : "ABOVE");
+    } else {
+        printf("                     ");
+    }
+    printf("  %7.1f cycles/call  %5u bytes\n", cycles, (unsigned)bytes);
+}
+
+void bench_fast_trig(void) {
+    printf("\n--- Fast sine tiers (Q15, %d phases) against libm and FastTrig ---\n", BENCH_TRIG_POINTS);
+    fast_trig_init();
+    fasttrig_init();
+
+    double cycles[FAST_TRIG_TIERS];
+    cycles[FAST_TRIG_LUT] = cycles_per_call(FAST_TRIG_LUT);
+    cycles[FAST_TRIG_LUT_INTERP] = cycles_per_call(FAST_TRIG_LUT_INTERP);
+    cycles[FAST_TRIG_POLY] = cycles_per_call(FAST_TRIG_POLY);
+    cycles[FAST_TRIG_CORDIC] = cycles_per_call(FAST_TRIG_CORDIC);
+    for (int tier = 0; tier < FAST_TRIG_TIERS; tier++) {
+        print_row(fast_trig_tiers[tier].name, max_error(tier), fast_trig_tiers[tier].max_error, cycles[tier],
+                  fast_trig_tiers[tier].bytes);
+        bench_yield();
+    }
+    // the cosine of CORDIC comes with the sine
+    print_row("cordic +cos", max_error(BENCH_TRIG_CORDIC_COS), fast_trig_tiers[FAST_TRIG_CORDIC].max_error,
+              cycles_per_call(BENCH_TRIG_CORDIC_COS), fast_trig_tiers[FAST_TRIG_CORDIC].bytes);
+    bench_yield();
+
+    // the references, in the units they take
+    print_row("libm sin", 0.0, 0.0, cycles_per_call(BENCH_TRIG_SIN), 0);
+    print_row("libm sinf", max_error(BENCH_TRIG_SINF), 0.0, cycles_per_call(BENCH_TRIG_SINF), 0);
+    bench_yield();
+    print_row("isin", max_error(BENCH_TRIG_ISIN), 0.0, cycles_per_call(BENCH_TRIG_ISIN), sizeof(fasttrig_table));
+}
@@ -0,0 +1,67 @@
+/**
+ * Fractional-frequency table playback: frequency error of the integer
+ * SAMPLES_PER_SECOND / FREQUENCY table against a fixed 1024 entry table
+ * played with a 32-bit phase increment, plus the cost and accuracy of
+ * linear interpolation.
+ *
+ * @file bench_fractional.cpp
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "dds.h"
+#include "wave_table.h"
+
+#define WAVE_TABLE_BITS     10
+
+static constexpr auto cycle = wave_table::makeSineCycle<1 << WAVE_TABLE_BITS>(1.0);
+
+// RMS error (in DAC steps) of the played samples against the exact sine
+static double rms_error(bool interpolate, double frequency, double sampleRate, int64_t *elapsed_us) {
+    dds_table_player_t player;
+    dds_table_init(&player, cycle.values, WAVE_TABLE_BITS, frequency, sampleRate);
+
+    int64_t start = bench_now_us();
+    for (int64_t n = 0; n < BENCH_SAMPLES; n++) {
+        bench_sink = interpolate ? dds_table_next_interp(&player) : dds_table_next(&player);
+    }
+    *elapsed_us = bench_now_us() - start;
+
+    dds_table_init(&player, cycle.values, WAVE_TABLE_BITS, frequency, sampleRate);
+    double sum = 0.0;
+    const int count = 100000;
+    for (int n = 0; n < count; n++) {
+        double exact = 127.0 * (1.0 + sin(2.0 * M_PI * player.phase / 4294967296.0));
+        int value = interpolate ? dds_table_next_interp(&player) : dds_table_next(&player);
+        sum += (value - exact) * (value - exact);
+    }
+    return sqrt(sum / count);
+}
+
+extern "C" void bench_fractional(void) {
+    printf("\n--- Fractional frequency playback (%d entry table) ---\n", 1 << WAVE_TABLE_BITS);
+    printf("  requested   samples/s   integer table: samples  freq error   DDS freq error\n");
+
+    const double cases[][2] = { {7000.0, 150000.0}, {200.0, 150000.0}, {1234.5, 180000.0}, {1.0, 180000.0} };
+    for (const auto &c : cases) {
+        double frequency = c[0];
+        double sampleRate = c[1];
+        long samplesPerCycle = (long)(sampleRate / frequency);
+        double integerFrequency = sampleRate / samplesPerCycle;
+        printf("%11.1f   %9.0f   %14ld  %10.4f%%   %12.3g Hz\n", frequency, sampleRate, samplesPerCycle,
+               100.0 * (integerFrequency - frequency) / frequency, dds_frequency_error(frequency, sampleRate));
+    }
+    printf("frequency resolution at 180000 samples/s: %.3g Hz\n", dds_frequency_resolution(180000.0));
+
+    int64_t plain_us = 0;
+    int64_t interp_us = 0;
+    double plain_rms = rms_error(false, 7000.0, 150000.0, &plain_us);
+    bench_yield();
+    double interp_rms = rms_error(true, 7000.0, 150000.0, &interp_us);
+    bench_yield();
+    printf("nearest entry : %12.0f samples/s, RMS error %.3f DAC steps\n", bench_rate(BENCH_SAMPLES, plain_us), plain_rms);
+    printf("interpolated  : %12.0f samples/s, RMS error %.3f DAC steps\n", bench_rate(BENCH_SAMPLES, interp_us), interp_rms);
+}
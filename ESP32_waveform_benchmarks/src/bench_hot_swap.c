@@ -0,0 +1,127 @@
+/**
+ * Table hot swap (lib/hot_swap): a stress test of the triple buffer, and the
+ * cost of hot_swap_take() in the reader.
+ *
+ * A writer (a thread on the host, a task on the other core on the ESP32)
+ * fills the back slot with its sequence number in every word and publishes
+ * it, as fast as it can, for BENCH_SWAP_MS. Meanwhile the reader (standing in
+ * for the timer ISR) takes the latest table and checks all of it, over and
+ * over. A torn read is a table with more than one sequence number in it (the
+ * writer wrote a slot the reader had), an out of order one is a table older
+ * than the one before. Both must be 0.
+ *
+ * @file bench_hot_swap.c
+ * @author Philip Giacalone
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "hot_swap.h"
+#include "isr_safe.h"
+
+#define BENCH_SWAP_WORDS    256         // 1 KB, the size of a function generator table
+#define BENCH_SWAP_MS       1000
+
+#ifndef ESP_PLATFORM
+#include <pthread.h>
+
+static pthread_t writer_thread;
+#endif
+
+static uint32_t slots[HOT_SWAP_SLOTS][BENCH_SWAP_WORDS];
+static hot_swap_t swap;
+static volatile int writer_running;
+static volatile int writer_done;
+
+static void *writer_main(void *arg) {
+    (void)arg;
+    uint32_t sequence = 0;
+    while (writer_running) {
+        sequence++;
+        uint32_t *table = (uint32_t *)hot_swap_back(&swap);
+        for (int i = 0; i < BENCH_SWAP_WORDS; i++) {
+            table[i] = sequence;
+        }
+        hot_swap_publish(&swap);
+    }
+    writer_done = 1;
+    return NULL;
+}
+
+#ifdef ESP_PLATFORM
+static void writer_task(void *arg) {
+    writer_main(arg);
+    vTaskDelete(NULL);
+}
+
+static void start_writer(void) {
+    writer_running = 1;
+    writer_done = 0;
+    xTaskCreatePinnedToCore(writer_task, "writer", 2048, NULL, 1, NULL, 1 - xPortGetCoreID());
+}
+
+static void stop_writer(void) {
+    writer_running = 0;
+    while (!writer_done) {
+        vTaskDelay(1);
+    }
+}
+#else
+static void start_writer(void) {
+    writer_running = 1;
+    writer_done = 0;
+    pthread_create(&writer_thread, NULL, writer_main, NULL);
+}
+
+static void stop_writer(void) {
+    writer_running = 0;
+    pthread_join(writer_thread, NULL);
+}
+#endif
+
+void bench_hot_swap(void) {
+    printf("\n--- Table hot swap (%d byte tables, %d ms) ---\n", (int)sizeof(slots[0]), BENCH_SWAP_MS);
+
+    for (int slot = 0; slot < HOT_SWAP_SLOTS; slot++) {
+        for (int i = 0; i < BENCH_SWAP_WORDS; i++) {
+            slots[slot][i] = 0;
+        }
+    }
+    hot_swap_init(&swap, slots[0], slots[1], slots[2]);
+
+    isr_cycle_stats_t take_cycles;
+    isr_cycle_stats_reset(&take_cycles);
+    uint32_t reads = 0;
+    uint32_t torn = 0;
+    uint32_t out_of_order = 0;
+    uint32_t last = 0;
+
+    start_writer();
+    int64_t start = bench_now_us();
+    while (bench_now_us() - start < BENCH_SWAP_MS * 1000) {
+        uint32_t begin = isr_cycle_count();
+        hot_swap_take(&swap);
+        isr_cycle_stats_add(&take_cycles, isr_cycle_count() - begin);
+
+        const uint32_t *table = (const uint32_t *)hot_swap_front(&swap);
+        uint32_t sequence = table[0];
+        for (int i = 1; i < BENCH_SWAP_WORDS; i++) {
+            if (table[i] != sequence) {
+                torn++;
+                break;
+            }
+        }
+        out_of_order += sequence < last ? 1 : 0;
+        last = sequence;
+        reads++;
+    }
+    stop_writer();
+
+    printf("published %u tables, taken %u (%u superseded), %u compare-and-set retries\n",
+           (unsigned)swap.published, (unsigned)swap.taken, (unsigned)hot_swap_superseded(&swap),
+           (unsigned)swap.retries);
+    printf("%u reads: %u torn, %u out of order\n", (unsigned)reads, (unsigned)torn, (unsigned)out_of_order);
+    printf("hot_swap_take() cycles min/mean/max: %u / %u / %u\n", (unsigned)take_cycles.min,
+           (unsigned)isr_cycle_stats_mean(&take_cycles), (unsigned)take_cycles.max);
+}
@@ -0,0 +1,168 @@
+/**
+ * Cost of one timer callback, in CPU cycles, before and after the ISR path
+ * went integer only:
+ *
+ *   float   - the old callback body: _t_ as a double, sin() and pow() per wave
+ *   q15     - DDS voices and envelopes (lib/dds, lib/envelope), integer only
+ *   buffer  - reading a pre-rendered sample (lib/block_buffer)
+ *   table   - playing a wave table (dds_table_next())
+ *   retune  - the same, picking up a new frequency every 1000 calls (lib/retune)
+ *   dual    - one frame for both DAC channels, two heads 90 degrees apart (dds_dual_next())
+ *
+ * Cycles come from isr_cycle_count() (ccount on the ESP32, the TSC on x86
+ * hosts), measured around each call the same way the firmware does it.
+ *
+ * @file bench_isr.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "block_buffer.h"
+#include "dds.h"
+#include "envelope.h"
+#include "isr_safe.h"
+#include "retune.h"
+
+#define BENCH_SAMPLE_RATE   100000.0
+#define BENCH_WAVES         2
+#define BENCH_CALLS         10000
+
+static const float bench_frequency[BENCH_WAVES] = {1000.0f, 10.0f};
+static const float bench_amplitude[BENCH_WAVES] = {0.8f, 0.2f};
+static const float bench_phase[BENCH_WAVES] = {1.57f, 3.14f};
+static const float bench_decay[BENCH_WAVES] = {0.02f, 0.1f};
+
+static dds_voice_t bench_voices[BENCH_WAVES];
+static envelope_t bench_envelopes[BENCH_WAVES];
+static block_buffer_t bench_buffer;
+static uint8_t bench_table[1 << 10];
+
+// the callback body before: y(t) = A * e^(-at) * (127 + 127 * sin(2πft + φ))
+static uint8_t isr_float(int64_t n) {
+    double _t_ = n / BENCH_SAMPLE_RATE;
+    float y = 0;
+    for (int i = 0; i < BENCH_WAVES; i++) {
+        float exponential = pow(M_E, (-1) * bench_decay[i] * _t_);
+        float angle = 2 * M_PI * bench_frequency[i] * _t_ + bench_phase[i];
+        y = y + (bench_amplitude[i] * exponential * (127.0 + (127.0 * sin(angle))));
+    }
+    return (uint8_t)y;
+}
+
+// the callback body after: the same waves in Q15
+static uint8_t isr_q15(void) {
+    int32_t y = 0;
+    for (int i = 0; i < BENCH_WAVES; i++) {
+        y += envelope_apply(&bench_envelopes[i], dds_voice_next(&bench_voices[i]));
+    }
+    int32_t output = (127 * y) >> 15;
+    return (uint8_t)(output > 255 ? 255 : output);
+}
+
+static void print_cycles(const char *name, const isr_cycle_stats_t *stats) {
+    printf("%-8s: min %6u  mean %6u  max %8u cycles/call\n", name,
+           (unsigned)stats->min, (unsigned)isr_cycle_stats_mean(stats), (unsigned)stats->max);
+}
+
+void bench_isr(void) {
+    printf("\n--- Timer callback cost (cycles per call, %d waves) ---\n", BENCH_WAVES);
+
+    isr_cycle_stats_t stats;
+    isr_cycle_stats_reset(&stats);
+    for (int64_t n = 0; n < BENCH_CALLS; n++) {
+        uint32_t start = isr_cycle_count();
+        bench_sink = isr_float(n);
+        isr_cycle_stats_add(&stats, isr_cycle_count() - start);
+    }
+    print_cycles("float", &stats);
+    bench_yield();
+
+    dds_init();
+    for (int i = 0; i < BENCH_WAVES; i++) {
+        dds_voice_init(&bench_voices[i], bench_frequency[i], bench_amplitude[i], bench_phase[i],
+                       1.0, BENCH_SAMPLE_RATE);
+        envelope_init(&bench_envelopes[i], 0.0, bench_decay[i], 0.0, 0.0, BENCH_SAMPLE_RATE);
+        envelope_trigger(&bench_envelopes[i]);
+    }
+    isr_cycle_stats_reset(&stats);
+    for (int64_t n = 0; n < BENCH_CALLS; n++) {
+        uint32_t start = isr_cycle_count();
+        bench_sink = isr_q15();
+        isr_cycle_stats_add(&stats, isr_cycle_count() - start);
+    }
+    print_cycles("q15", &stats);
+    bench_yield();
+
+    // the render side is refilled outside the measurement, as render_task() would
+    block_buffer_init(&bench_buffer, 127);
+    isr_cycle_stats_reset(&stats);
+    for (int64_t n = 0; n < BENCH_CALLS; n++) {
+        uint8_t *block;
+        while ((block = block_buffer_acquire(&bench_buffer)) != NULL) {
+            for (int i = 0; i < BLOCK_BUFFER_SAMPLES; i++) {
+                block[i] = isr_q15();
+            }
+            block_buffer_commit(&bench_buffer);
+        }
+        uint32_t start = isr_cycle_count();
+        uint8_t value;
+        block_buffer_read(&bench_buffer, &value);
+        bench_sink = value;
+        isr_cycle_stats_add(&stats, isr_cycle_count() - start);
+    }
+    print_cycles("buffer", &stats);
+    printf("underruns: %u\n", (unsigned)bench_buffer.stats.underruns);
+    bench_yield();
+
+    for (int i = 0; i < (1 << 10); i++) {
+        bench_table[i] = (uint8_t)(128 + 127 * sin(2 * M_PI * i / (1 << 10)));
+    }
+    dds_table_player_t player;
+    dds_table_init(&player, bench_table, 10, 1000.0, BENCH_SAMPLE_RATE);
+    isr_cycle_stats_reset(&stats);
+    for (int64_t n = 0; n < BENCH_CALLS; n++) {
+        uint32_t start = isr_cycle_count();
+        bench_sink = dds_table_next(&player);
+        isr_cycle_stats_add(&stats, isr_cycle_count() - start);
+    }
+    print_cycles("table", &stats);
+    bench_yield();
+
+    // the requests are made outside the measurement, as the control task would
+    retune_t retune;
+    retune_init(&retune, RETUNE_AT_ZERO_CROSSING, 0);
+    isr_cycle_stats_reset(&stats);
+    for (int64_t n = 0; n < BENCH_CALLS; n++) {
+        if (n % 1000 == 0) {
+            retune_params_t params = {bench_table, dds_phase_increment(1000.0 + n / 10, BENCH_SAMPLE_RATE), 0, 0};
+            retune_request(&retune, &params);
+        }
+        uint32_t start = isr_cycle_count();
+        bench_sink = retune_next(&retune, &player, false);
+        isr_cycle_stats_add(&stats, isr_cycle_count() - start);
+    }
+    print_cycles("retune", &stats);
+    printf("retunes: %u, latency min/mean/max %u / %u / %u samples\n", (unsigned)retune.applied,
+           (unsigned)retune.latency_samples.min, (unsigned)isr_cycle_stats_mean(&retune.latency_samples),
+           (unsigned)retune.latency_samples.max);
+    bench_yield();
+
+    // both heads advance in the same call, so the I/Q offset must not move
+    dds_dual_player_t dual;
+    dds_dual_init(&dual, bench_table, 10, 1000.0, 1000.0, M_PI / 2, BENCH_SAMPLE_RATE);
+    uint32_t offset = dual.phase[1] - dual.phase[0];
+    isr_cycle_stats_reset(&stats);
+    for (int64_t n = 0; n < BENCH_CALLS; n++) {
+        uint8_t value1, value2;
+        uint32_t start = isr_cycle_count();
+        dds_dual_next(&dual, &value1, &value2);
+        isr_cycle_stats_add(&stats, isr_cycle_count() - start);
+        bench_sink += value1 + value2;
+    }
+    print_cycles("dual", &stats);
+    printf("phase offset after %d frames: %s\n", BENCH_CALLS,
+           dual.phase[1] - dual.phase[0] == offset ? "locked" : "DRIFTED");
+}
@@ -0,0 +1,128 @@
+/**
+ * Mipmapped wave tables (wave_table::makeMipMap(), dds_mipmap_player_t):
+ * aliasing and memory against the single table of ESP32_function_generator,
+ * which is band limited for its FREQUENCY and then played at higher ones:
+ *
+ *   table  - one cycle of 1024 entries, 374 harmonics (band limited for 200 Hz)
+ *   mipmap - one level per octave of the phase increment (7104 bytes)
+ *
+ * Each frequency is a whole, odd number of FFT bins, so one FFT of
+ * BENCH_MIP_FFT samples holds exactly that many cycles (no window). The
+ * harmonics land on multiples of the bin, anything that folded back from
+ * above Nyquist lands between them. The alias figure is the power between
+ * the harmonics relative to the power on them. The 8-bit DAC rounding and
+ * reading the nearest table entry land there too, so it does not go much
+ * below -40 dB even without aliasing.
+ *
+ * @file bench_mipmap.cpp
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "dds.h"
+#include "isr_safe.h"
+#include "wave_table.h"
+
+// the ESP32_function_generator settings
+#define FREQUENCY           200
+#define SAMPLES_PER_SECOND  150000
+#define ATTENUATION         0.5
+#define MAX_DAC_AMPLITUDE   127
+#define TABLE_BITS          10
+#define BENCH_MIP_FFT       4096
+
+WAVE_TABLE_ATTR constexpr auto sawtoothValues = wave_table::makeWaveCycle<1 << TABLE_BITS>(
+    wave_table::Shape::Sawtooth, wave_table::maxHarmonic(FREQUENCY, SAMPLES_PER_SECOND), ATTENUATION, MAX_DAC_AMPLITUDE);
+WAVE_TABLE_ATTR constexpr auto squareValues = wave_table::makeWaveCycle<1 << TABLE_BITS>(
+    wave_table::Shape::Square, wave_table::maxHarmonic(FREQUENCY, SAMPLES_PER_SECOND), ATTENUATION, MAX_DAC_AMPLITUDE);
+WAVE_TABLE_ATTR constexpr auto sawtoothMipMap =
+    wave_table::makeMipMap<1 << TABLE_BITS>(wave_table::Shape::Sawtooth, ATTENUATION, MAX_DAC_AMPLITUDE);
+WAVE_TABLE_ATTR constexpr auto squareMipMap =
+    wave_table::makeMipMap<1 << TABLE_BITS>(wave_table::Shape::Square, ATTENUATION, MAX_DAC_AMPLITUDE);
+
+// odd, so an alias never lands on a harmonic (183 Hz to 30 kHz)
+static const int bins[] = {5, 27, 137, 411, 819};
+
+static float fft_re[BENCH_MIP_FFT];
+static float fft_im[BENCH_MIP_FFT];
+
+// the power between the harmonics of bin, relative to the power on them, in dB
+static double alias_db(int bin) {
+    bench_fft(fft_re, fft_im, BENCH_MIP_FFT);
+    double harmonics = 0.0;
+    double aliases = 0.0;
+    for (int k = 1; k < BENCH_MIP_FFT / 2; k++) {
+        double power = (double)fft_re[k] * fft_re[k] + (double)fft_im[k] * fft_im[k];
+        if (k % bin == 0) {
+            harmonics += power;
+        } else {
+            aliases += power;
+        }
+    }
+    return 10.0 * log10(aliases / harmonics);
+}
+
+static void bench_shape(const char *name, const uint8_t *table, const uint8_t *mipmap) {
+    for (size_t b = 0; b < sizeof(bins) / sizeof(bins[0]); b++) {
+        double frequency = (double)bins[b] * SAMPLES_PER_SECOND / BENCH_MIP_FFT;
+        dds_table_player_t tablePlayer;
+        dds_mipmap_player_t mipmapPlayer;
+        dds_table_init(&tablePlayer, table, TABLE_BITS, frequency, SAMPLES_PER_SECOND);
+        dds_mipmap_init(&mipmapPlayer, mipmap, TABLE_BITS, frequency, SAMPLES_PER_SECOND);
+
+        for (int i = 0; i < BENCH_MIP_FFT; i++) {
+            fft_re[i] = dds_table_next(&tablePlayer);
+            fft_im[i] = 0.0f;
+        }
+        double tableAlias = alias_db(bins[b]);
+        for (int i = 0; i < BENCH_MIP_FFT; i++) {
+            fft_re[i] = dds_mipmap_next(&mipmapPlayer);
+            fft_im[i] = 0.0f;
+        }
+        double mipmapAlias = alias_db(bins[b]);
+
+        uint32_t level = dds_mipmap_level(&mipmapPlayer, mipmapPlayer.phase_inc);
+        printf("%-8s %8.1f Hz: alias table %6.1f dB, mipmap %6.1f dB (level %u, %d harmonics)\n", name,
+               frequency, tableAlias, mipmapAlias, (unsigned)level,
+               wave_table::mipMapHarmonics<1 << TABLE_BITS>(level));
+    }
+}
+
+extern "C" void bench_mipmap(void) {
+    printf("\n--- Mipmapped tables (%d samples/s, the table is band limited for %d Hz) ---\n",
+           SAMPLES_PER_SECOND, FREQUENCY);
+    printf("memory: table %d bytes, mipmap %d bytes (%d levels)\n", (int)sizeof(squareValues),
+           (int)sizeof(squareMipMap), (int)wave_table::mipMapLevels<1 << TABLE_BITS>());
+
+    bench_shape("sawtooth", sawtoothValues.values, sawtoothMipMap.values);
+    bench_yield();
+    bench_shape("square", squareValues.values, squareMipMap.values);
+    bench_yield();
+
+    // cycles per call, at a frequency that changes level every 1000 calls
+    dds_table_player_t tablePlayer;
+    dds_mipmap_player_t mipmapPlayer;
+    dds_table_init(&tablePlayer, squareValues.values, TABLE_BITS, FREQUENCY, SAMPLES_PER_SECOND);
+    dds_mipmap_init(&mipmapPlayer, squareMipMap.values, TABLE_BITS, FREQUENCY, SAMPLES_PER_SECOND);
+    isr_cycle_stats_t tableCycles;
+    isr_cycle_stats_t mipmapCycles;
+    isr_cycle_stats_reset(&tableCycles);
+    isr_cycle_stats_reset(&mipmapCycles);
+    for (int i = 0; i < 10000; i++) {
+        if (i % 1000 == 0) {
+            dds_mipmap_set_frequency(&mipmapPlayer, FREQUENCY << (i / 1000 % 8), SAMPLES_PER_SECOND);
+        }
+        uint32_t begin = isr_cycle_count();
+        bench_sink += dds_table_next(&tablePlayer);
+        isr_cycle_stats_add(&tableCycles, isr_cycle_count() - begin);
+        begin = isr_cycle_count();
+        bench_sink += dds_mipmap_next(&mipmapPlayer);
+        isr_cycle_stats_add(&mipmapCycles, isr_cycle_count() - begin);
+    }
+    printf("cycles min/mean: table %u / %u, mipmap %u / %u\n", (unsigned)tableCycles.min,
+           (unsigned)isr_cycle_stats_mean(&tableCycles), (unsigned)mipmapCycles.min,
+           (unsigned)isr_cycle_stats_mean(&mipmapCycles));
+}
@@ -0,0 +1,88 @@
+/**
+ * Modulation between DDS voices (lib/modulation): the cost of a modulator and
+ * carrier pair per sample for AM, FM and PM, next to a plain voice, and how
+ * many of them one core could compute at BENCH_SAMPLE_RATE (all of its time,
+ * nothing else running).
+ *
+ * Each voice has an envelope, as in the generators. The FM row also checks
+ * the carrier's peak frequency deviation against the route's depth.
+ *
+ * @file bench_modulation.c
+ * @author Philip Giacalone
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "dds.h"
+#include "envelope.h"
+#include "modulation.h"
+
+#define BENCH_SAMPLE_RATE   150000.0
+#define BENCH_CARRIER       1000.0      // Hz
+#define BENCH_MODULATOR     50.0        // Hz
+
+// unit is what one sample computes: a voice or a pair
+static void print_fit(const char *name, int64_t samples, int64_t elapsed, const char *unit) {
+    double rate = bench_rate(samples, elapsed);
+    printf("%-6s: %8.2f Msamples/s, %6.1f ns/sample, %5.0f %ss fit at %.0f samples/s\n", name,
+           rate / 1e6, 1e9 / rate, rate / BENCH_SAMPLE_RATE, unit, BENCH_SAMPLE_RATE);
+}
+
+static void bench_plain(void) {
+    dds_voice_t voice;
+    envelope_t envelope;
+    dds_voice_init(&voice, BENCH_CARRIER, 0.5, 0.0, 1.0, BENCH_SAMPLE_RATE);
+    envelope_init(&envelope, 0.0, 0.0, 1.0, 0.0, BENCH_SAMPLE_RATE);
+    envelope_trigger(&envelope);
+
+    int64_t start = bench_now_us();
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        bench_sink += envelope_apply(&envelope, dds_voice_next(&voice));
+    }
+    print_fit("plain", BENCH_SAMPLES, bench_now_us() - start, "voice");
+}
+
+static void bench_pair(const char *name, modulation_type_t type, double depth) {
+    // voice 0 is the carrier, voice 1 the modulator
+    dds_voice_t voices[2];
+    envelope_t envelopes[2];
+    modulation_route_t route;
+    modulation_input_t inputs[2];
+    dds_voice_init(&voices[0], BENCH_CARRIER, 0.5, 0.0, 1.0, BENCH_SAMPLE_RATE);
+    dds_voice_init(&voices[1], BENCH_MODULATOR, 1.0, 0.0, 0.0, BENCH_SAMPLE_RATE);
+    for (int i = 0; i < 2; i++) {
+        envelope_init(&envelopes[i], 0.0, 0.0, 1.0, 0.0, BENCH_SAMPLE_RATE);
+        envelope_trigger(&envelopes[i]);
+        modulation_input_clear(&inputs[i]);
+    }
+    modulation_route_init(&route, type, 0, depth, BENCH_SAMPLE_RATE);
+
+    int32_t max_fm = 0;
+    int64_t start = bench_now_us();
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        // the modulator is computed first, so it acts on the same sample
+        modulation_apply(&route, inputs, envelope_apply(&envelopes[1], dds_voice_next(&voices[1])));
+        max_fm = inputs[0].fm > max_fm ? inputs[0].fm : max_fm;
+        bench_sink += envelope_apply(&envelopes[0], modulation_voice_next(&voices[0], &inputs[0]));
+    }
+    print_fit(name, BENCH_SAMPLES, bench_now_us() - start, "pair");
+
+    if (type == MODULATION_FM) {
+        printf("        peak deviation %.2f Hz (depth %.2f Hz)\n",
+               dds_frequency_actual((uint32_t)max_fm, BENCH_SAMPLE_RATE), depth);
+    }
+}
+
+void bench_modulation(void) {
+    printf("\n--- Modulation (%.0f Hz carrier, %.0f Hz modulator, with envelopes) ---\n",
+           BENCH_CARRIER, BENCH_MODULATOR);
+    dds_init();
+    bench_plain();
+    bench_yield();
+    bench_pair("AM", MODULATION_AM, 0.5);
+    bench_yield();
+    bench_pair("FM", MODULATION_FM, 200.0);
+    bench_yield();
+    bench_pair("PM", MODULATION_PM, 1.0);
+}
@@ -0,0 +1,133 @@
+/**
+ * Noise generators (lib/noise): samples per second, the cycles per sample
+ * (min/max, the cost must be bounded to run in the timer ISR), and the
+ * spectral slope in dB per octave (white 0, pink -3, brown -6).
+ *
+ * The slope is a least squares fit of the mean power per FFT bin in each
+ * octave, from BENCH_FFT_SIZE point spectra averaged over BENCH_FFT_FRAMES
+ * frames (Hann window).
+ *
+ * @file bench_noise.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "isr_safe.h"
+#include "noise.h"
+
+#define BENCH_FFT_BITS      10
+#define BENCH_FFT_SIZE      (1 << BENCH_FFT_BITS)
+#define BENCH_FFT_FRAMES    64
+#define BENCH_LOW_OCTAVE    3       // the fit covers bins 2^3 to 2^(BENCH_FFT_BITS - 1)
+
+static float fft_re[BENCH_FFT_SIZE];
+static float fft_im[BENCH_FFT_SIZE];
+static float power[BENCH_FFT_SIZE / 2];
+
+// in place radix 2 FFT, size a power of 2 (also used by bench_quantize.c)
+void bench_fft(float *re, float *im, uint32_t size) {
+    for (uint32_t i = 1, j = 0; i < size; i++) {
+        uint32_t bit = size >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+    for (uint32_t length = 2; length <= size; length <<= 1) {
+        double angle = -2.0 * M_PI / length;
+        float w_re = (float)cos(angle);
+        float w_im = (float)sin(angle);
+        for (uint32_t start = 0; start < size; start += length) {
+            float u_re = 1.0f;
+            float u_im = 0.0f;
+            for (uint32_t k = 0; k < length / 2; k++) {
+                uint32_t a = start + k;
+                uint32_t b = a + length / 2;
+                float t_re = re[b] * u_re - im[b] * u_im;
+                float t_im = re[b] * u_im + im[b] * u_re;
+                re[b] = re[a] - t_re;
+                im[b] = im[a] - t_im;
+                re[a] += t_re;
+                im[a] += t_im;
+                float next = u_re * w_re - u_im * w_im;
+                u_im = u_re * w_im + u_im * w_re;
+                u_re = next;
+            }
+        }
+    }
+}
+
+// dB per octave of the averaged spectrum of a noise source
+static double spectral_slope(noise_t *noise) {
+    for (int i = 0; i < BENCH_FFT_SIZE / 2; i++) {
+        power[i] = 0.0f;
+    }
+    for (int frame = 0; frame < BENCH_FFT_FRAMES; frame++) {
+        for (int i = 0; i < BENCH_FFT_SIZE; i++) {
+            float window = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * i / BENCH_FFT_SIZE);
+            fft_re[i] = window * (noise_next(noise) - noise->amplitude * noise->y_offset / 32768.0f);
+            fft_im[i] = 0.0f;
+        }
+        bench_fft(fft_re, fft_im, BENCH_FFT_SIZE);
+        for (int i = 0; i < BENCH_FFT_SIZE / 2; i++) {
+            power[i] += fft_re[i] * fft_re[i] + fft_im[i] * fft_im[i];
+        }
+    }
+
+    // least squares fit of dB against octave
+    double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+    int points = 0;
+    for (int octave = BENCH_LOW_OCTAVE; octave < BENCH_FFT_BITS - 1; octave++) {
+        double band = 0.0;
+        for (int i = 1 << octave; i < 2 << octave; i++) {
+            band += power[i];
+        }
+        double db = 10.0 * log10(band / (1 << octave));
+        sum_x += octave;
+        sum_y += db;
+        sum_xx += (double)octave * octave;
+        sum_xy += octave * db;
+        points++;
+    }
+    return (points * sum_xy - sum_x * sum_y) / (points * sum_xx - sum_x * sum_x);
+}
+
+static void bench_color(const char *name, noise_color_t color) {
+    noise_t noise;
+    noise_init(&noise, color, 1.0, 1.0, 1);
+
+    int64_t start = bench_now_us();
+    for (int i = 0; i < BENCH_SAMPLES; i++) {
+        bench_sink += noise_next(&noise);
+    }
+    int64_t elapsed = bench_now_us() - start;
+
+    isr_cycle_stats_t stats;
+    isr_cycle_stats_reset(&stats);
+    for (int i = 0; i < 10000; i++) {
+        uint32_t begin = isr_cycle_count();
+        bench_sink += noise_next(&noise);
+        isr_cycle_stats_add(&stats, isr_cycle_count() - begin);
+    }
+    bench_yield();
+
+    printf("%-6s: %8.2f Msamples/s, cycles min/mean %u / %u, slope %6.2f dB/octave\n", name,
+           bench_rate(BENCH_SAMPLES, elapsed) / 1e6, (unsigned)stats.min,
+           (unsigned)isr_cycle_stats_mean(&stats), spectral_slope(&noise));
+}
+
+void bench_noise(void) {
+    printf("\n--- Noise generators (%d point spectra, %d frames) ---\n", BENCH_FFT_SIZE, BENCH_FFT_FRAMES);
+    bench_color("white", NOISE_WHITE);
+    bench_yield();
+    bench_color("pink", NOISE_PINK);
+    bench_yield();
+    bench_color("brown", NOISE_BROWN);
+}
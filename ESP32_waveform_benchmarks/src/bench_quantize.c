@@ -0,0 +1,105 @@
+/**
+ * 8-bit DAC quantizers (lib/quantize): the cycles per sample, and what they
+ * buy in spurious-free dynamic range (SFDR) and signal to noise ratio (SNR),
+ * for a sine at half scale (ATTENUATION 0.5) and at 2% of full scale (the
+ * tail of a decaying wave).
+ *
+ * The sine has a whole number of cycles in each BENCH_FFT_SIZE point frame
+ * (no window needed), and the power spectra of BENCH_FFT_FRAMES frames are
+ * averaged. SFDR is the sine over the largest other bin, SNR the sine over
+ * all the other bins (DC excluded). Both are given in band (below
+ * sample_rate / 8, where noise shaping leaves less noise) and over the whole
+ * band (up to sample_rate / 2, where noise shaping adds noise).
+ *
+ * @file bench_quantize.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "isr_safe.h"
+#include "quantize.h"
+
+#define BENCH_FFT_SIZE      4096
+#define BENCH_FFT_FRAMES    16
+#define BENCH_SINE_BIN      83      // prime, so the error does not repeat within a frame
+#define BENCH_BAND_BINS     (BENCH_FFT_SIZE / 8)
+
+static float fft_re[BENCH_FFT_SIZE];
+static float fft_im[BENCH_FFT_SIZE];
+static float power[BENCH_FFT_SIZE / 2];
+
+// the sine as a DAC value times 2^QUANTIZE_FRACTION_BITS
+static int32_t sine_value(uint32_t n, double amplitude) {
+    double dac = 127.5 + amplitude * 127.5 * sin(2 * M_PI * BENCH_SINE_BIN * (double)n / BENCH_FFT_SIZE);
+    return (int32_t)lround(dac * (1 << QUANTIZE_FRACTION_BITS));
+}
+
+// SFDR and SNR in dB, over bins 1 to bins - 1
+static void spurs(uint32_t bins, double *sfdr, double *snr) {
+    double noise = 0.0;
+    double largest = 0.0;
+    for (uint32_t i = 1; i < bins; i++) {
+        if (i != BENCH_SINE_BIN) {
+            noise += power[i];
+            largest = power[i] > largest ? power[i] : largest;
+        }
+    }
+    *sfdr = 10.0 * log10(power[BENCH_SINE_BIN] / largest);
+    *snr = 10.0 * log10(power[BENCH_SINE_BIN] / noise);
+}
+
+static void bench_mode(const char *name, quantize_mode_t mode, double amplitude) {
+    quantizer_t quantizer;
+    quantize_init(&quantizer, mode, 1);
+
+    isr_cycle_stats_t stats;
+    isr_cycle_stats_reset(&stats);
+    for (uint32_t n = 0; n < 10000; n++) {
+        int32_t value = sine_value(n, amplitude);
+        uint32_t begin = isr_cycle_count();
+        bench_sink += quantize_next(&quantizer, value);
+        isr_cycle_stats_add(&stats, isr_cycle_count() - begin);
+    }
+
+    for (int i = 0; i < BENCH_FFT_SIZE / 2; i++) {
+        power[i] = 0.0f;
+    }
+    for (int frame = 0; frame < BENCH_FFT_FRAMES; frame++) {
+        for (uint32_t n = 0; n < BENCH_FFT_SIZE; n++) {
+            fft_re[n] = quantize_next(&quantizer, sine_value(n, amplitude));
+            fft_im[n] = 0.0f;
+        }
+        bench_fft(fft_re, fft_im, BENCH_FFT_SIZE);
+        for (int i = 0; i < BENCH_FFT_SIZE / 2; i++) {
+            power[i] += fft_re[i] * fft_re[i] + fft_im[i] * fft_im[i];
+        }
+    }
+    bench_yield();
+
+    double band_sfdr, band_snr, full_sfdr, full_snr;
+    spurs(BENCH_BAND_BINS, &band_sfdr, &band_snr);
+    spurs(BENCH_FFT_SIZE / 2, &full_sfdr, &full_snr);
+    printf("%-9s: cycles min/mean %3u / %3u, in band SFDR %5.1f SNR %5.1f dB, full band SFDR %5.1f SNR %5.1f dB\n",
+           name, (unsigned)stats.min, (unsigned)isr_cycle_stats_mean(&stats),
+           band_sfdr, band_snr, full_sfdr, full_snr);
+}
+
+static void bench_amplitude(double amplitude) {
+    printf("amplitude %.2f (%.1f DAC steps):\n", amplitude, amplitude * 127.5);
+    bench_mode("truncate", QUANTIZE_TRUNCATE, amplitude);
+    bench_mode("round", QUANTIZE_ROUND, amplitude);
+    bench_mode("tpdf", QUANTIZE_TPDF, amplitude);
+    bench_mode("shaped 1", QUANTIZE_SHAPED_1, amplitude);
+    bench_mode("shaped 2", QUANTIZE_SHAPED_2, amplitude);
+}
+
+void bench_quantize(void) {
+    printf("\n--- 8-bit DAC quantizers (%d point spectra, %d frames, band = sample rate / 8) ---\n",
+           BENCH_FFT_SIZE, BENCH_FFT_FRAMES);
+    bench_amplitude(0.5);
+    bench_yield();
+    bench_amplitude(0.02);
+}
@@ -0,0 +1,119 @@
+/**
+ * Quarter-wave tables (wave_table::makeQuarterCycle(), dds_quarter_player_t):
+ * memory, cycles per timer callback and accuracy against the other table
+ * layouts, at the ESP32_function_generator settings:
+ *
+ *   int[]      - the original layout: one int per sample of one cycle
+ *                (SAMPLES_PER_SECOND / FREQUENCY entries), stepped by an index
+ *   full       - one cycle of 1024 uint8_t, played with a fractional phase (dds_table_next())
+ *   quarter 8  - the first quarter of that cycle, 257 uint8_t (dds_quarter_next())
+ *   quarter 16 - the same as uint16_t, 8 more bits rounded off when played (dds_quarter_next16())
+ *
+ * The error is the largest difference from the exact sine (in DAC steps)
+ * over one second of samples.
+ *
+ * @file bench_quarter.cpp
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "dds.h"
+#include "isr_safe.h"
+#include "wave_table.h"
+
+// the ESP32_function_generator settings
+#define FREQUENCY           200
+#define SAMPLES_PER_SECOND  150000
+#define ATTENUATION         0.5
+#define MAX_DAC_AMPLITUDE   127
+#define SAMPLES_PER_CYCLE   (SAMPLES_PER_SECOND / FREQUENCY)
+#define TABLE_BITS          10
+
+WAVE_TABLE_ATTR constexpr auto fullValues =
+    wave_table::makeWaveCycle<1 << TABLE_BITS>(wave_table::Shape::Sine, 1, ATTENUATION, MAX_DAC_AMPLITUDE);
+WAVE_TABLE_ATTR constexpr auto quarterValues =
+    wave_table::makeQuarterCycle<uint8_t, 1 << TABLE_BITS>(wave_table::Shape::Sine, 1, ATTENUATION, MAX_DAC_AMPLITUDE);
+WAVE_TABLE_ATTR constexpr auto quarterValues16 =
+    wave_table::makeQuarterCycle<uint16_t, 1 << TABLE_BITS>(wave_table::Shape::Sine, 1, ATTENUATION, MAX_DAC_AMPLITUDE);
+
+static int intValues[SAMPLES_PER_CYCLE];
+
+typedef enum { LAYOUT_INT, LAYOUT_FULL, LAYOUT_QUARTER, LAYOUT_QUARTER16 } layout_t;
+
+// the state of every layout's player
+typedef struct {
+    int index;
+    dds_table_player_t full;
+    dds_quarter_player_t quarter;
+    dds_quarter_player_t quarter16;
+} players_t;
+
+static void init_players(players_t *players) {
+    players->index = 0;
+    dds_table_init(&players->full, fullValues.values, TABLE_BITS, FREQUENCY, SAMPLES_PER_SECOND);
+    dds_quarter_init(&players->quarter, quarterValues.values, TABLE_BITS,
+                     wave_table::quarterMiddle<uint8_t>(ATTENUATION, MAX_DAC_AMPLITUDE), FREQUENCY, SAMPLES_PER_SECOND);
+    dds_quarter_init(&players->quarter16, quarterValues16.values, TABLE_BITS,
+                     wave_table::quarterMiddle<uint16_t>(ATTENUATION, MAX_DAC_AMPLITUDE), FREQUENCY, SAMPLES_PER_SECOND);
+}
+
+// what the timer callback does for each layout
+static inline uint8_t next_value(players_t *players, layout_t layout) {
+    switch (layout) {
+        case LAYOUT_INT: {
+            int value = intValues[players->index];
+            players->index = players->index + 1 < SAMPLES_PER_CYCLE ? players->index + 1 : 0;
+            return (uint8_t)value;
+        }
+        case LAYOUT_FULL:
+            return dds_table_next(&players->full);
+        case LAYOUT_QUARTER:
+            return dds_quarter_next(&players->quarter);
+        default:
+            return dds_quarter_next16(&players->quarter16);
+    }
+}
+
+static void bench_layout(const char *name, layout_t layout, size_t bytes) {
+    players_t players;
+    init_players(&players);
+
+    isr_cycle_stats_t stats;
+    isr_cycle_stats_reset(&stats);
+    for (int i = 0; i < 10000; i++) {
+        uint32_t begin = isr_cycle_count();
+        bench_sink += next_value(&players, layout);
+        isr_cycle_stats_add(&stats, isr_cycle_count() - begin);
+    }
+
+    init_players(&players);
+    double max_error = 0.0;
+    for (int i = 0; i < SAMPLES_PER_SECOND; i++) {
+        double exact = MAX_DAC_AMPLITUDE * ATTENUATION * (1.0 + sin(2.0 * M_PI * FREQUENCY * i / SAMPLES_PER_SECOND));
+        double error = fabs(next_value(&players, layout) - exact);
+        max_error = error > max_error ? error : max_error;
+    }
+
+    printf("%-10s: %5d bytes (%4.1fx smaller than int[]), cycles min/mean %3u / %3u, max error %.2f DAC steps\n",
+           name, (int)bytes, (double)sizeof(intValues) / bytes, (unsigned)stats.min,
+           (unsigned)isr_cycle_stats_mean(&stats), max_error);
+}
+
+extern "C" void bench_quarter(void) {
+    printf("\n--- Quarter-wave tables (%d Hz at %d samples/s, attenuation %.1f) ---\n",
+           FREQUENCY, SAMPLES_PER_SECOND, ATTENUATION);
+    for (int i = 0; i < SAMPLES_PER_CYCLE; i++) {
+        intValues[i] = (int)(MAX_DAC_AMPLITUDE * ATTENUATION * (1.0 + sin(2.0 * M_PI * i / SAMPLES_PER_CYCLE)));
+    }
+
+    bench_layout("int[]", LAYOUT_INT, sizeof(intValues));
+    bench_yield();
+    bench_layout("full", LAYOUT_FULL, sizeof(fullValues));
+    bench_yield();
+    bench_layout("quarter 8", LAYOUT_QUARTER, sizeof(quarterValues));
+    bench_yield();
+    bench_layout("quarter 16", LAYOUT_QUARTER16, sizeof(quarterValues16));
+}
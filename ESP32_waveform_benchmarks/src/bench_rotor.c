@@ -0,0 +1,116 @@
+/**
+ * Coupled-form (rotor) oscillator: throughput of a DDS voice in
+ * DDS_MODE_ROTOR against DDS_MODE_TABLE and libm sinf(), and the phase and
+ * amplitude error of each after a long run.
+ *
+ * The reference is the exact sine of the DDS phase accumulator (n * phase_inc
+ * modulo 2^32), so every path is checked at the same frequency. The libm path
+ * computes the angle the way the old callbacks did (float, from the time).
+ *
+ * @file bench_rotor.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "dds.h"
+
+#define BENCH_SAMPLE_RATE   100000.0
+#define BENCH_FREQUENCY     1000.0
+#define BENCH_WINDOW        100000      // samples checked at the end of the long run
+
+#ifdef ESP_PLATFORM
+#define BENCH_LONG_RUN      1000000LL       // 10 s at 100000 samples/s
+#else
+#define BENCH_LONG_RUN      360000000LL     // 1 hour at 100000 samples/s
+#endif
+
+// sin() of the exact DDS phase after n samples
+static double exact_sine(uint32_t phase_inc, int64_t n) {
+    uint32_t phase = (uint32_t)((uint64_t)phase_inc * (uint64_t)n);
+    return sin(2.0 * M_PI * phase / 4294967296.0);
+}
+
+// throughput of dds_voice_next() in a mode
+static double voice_rate(dds_mode_t mode) {
+    dds_voice_t voice;
+    dds_voice_init(&voice, BENCH_FREQUENCY, 1.0, 0.0, 0.0, BENCH_SAMPLE_RATE);
+    dds_voice_set_mode(&voice, mode);
+    int64_t start = bench_now_us();
+    for (int64_t n = 0; n < BENCH_SAMPLES; n++) {
+        bench_sink = dds_voice_next(&voice);
+    }
+    return bench_rate(BENCH_SAMPLES, bench_now_us() - start);
+}
+
+void bench_rotor(void) {
+    printf("\n--- Rotor (coupled-form) vs table vs libm oscillators ---\n");
+
+    double table_rate = voice_rate(DDS_MODE_TABLE);
+    bench_yield();
+    double rotor_rate = voice_rate(DDS_MODE_ROTOR);
+    bench_yield();
+
+    int64_t start = bench_now_us();
+    for (int64_t n = 0; n < BENCH_SAMPLES; n++) {
+        double _t_ = n / BENCH_SAMPLE_RATE;
+        float angle = 2.0 * M_PI * BENCH_FREQUENCY * _t_;
+        bench_sink = (int32_t)(sinf(angle) * DDS_Q15_ONE);
+    }
+    double libm_rate = bench_rate(BENCH_SAMPLES, bench_now_us() - start);
+    bench_yield();
+
+    printf("table     : %12.0f samples/s\n", table_rate);
+    printf("rotor     : %12.0f samples/s\n", rotor_rate);
+    printf("libm sinf : %12.0f samples/s\n", libm_rate);
+
+    // long run: run each path to the end, then check a window of samples
+    dds_voice_t table;
+    dds_voice_t rotor;
+    dds_voice_init(&table, BENCH_FREQUENCY, 1.0, 0.0, 0.0, BENCH_SAMPLE_RATE);
+    dds_voice_init(&rotor, BENCH_FREQUENCY, 1.0, 0.0, 0.0, BENCH_SAMPLE_RATE);
+    dds_voice_set_mode(&rotor, DDS_MODE_ROTOR);
+    uint32_t phase_inc = rotor.phase_inc;
+    double frequency = dds_frequency_actual(phase_inc, BENCH_SAMPLE_RATE);
+
+    int64_t first = BENCH_LONG_RUN - BENCH_WINDOW;
+    for (int64_t n = 0; n < first; n++) {
+        dds_voice_next(&rotor);
+        if ((n & 0xFFFFF) == 0) {
+            bench_yield();
+        }
+    }
+    table.phase += (uint32_t)((uint64_t)phase_inc * (uint64_t)first);
+
+    double table_error = 0.0;
+    double rotor_error = 0.0;
+    double libm_error = 0.0;
+    double rotor_radius_error = 0.0;
+    for (int64_t n = first; n < BENCH_LONG_RUN; n++) {
+        double exact = exact_sine(phase_inc, n);
+        double radius = hypot(rotor.rotor_cos, rotor.rotor_sin) / DDS_ROTOR_ONE;
+        double t = dds_voice_next(&table) / (double)DDS_Q15_ONE;
+        double r = dds_voice_next(&rotor) / (double)DDS_Q15_ONE;
+        double _t_ = n / BENCH_SAMPLE_RATE;
+        float angle = 2.0 * M_PI * frequency * _t_;
+        double l = sinf(angle);
+
+        table_error = fmax(table_error, fabs(t - exact));
+        rotor_error = fmax(rotor_error, fabs(r - exact));
+        libm_error = fmax(libm_error, fabs(l - exact));
+        rotor_radius_error = fmax(rotor_radius_error, fabs(radius - 1.0));
+    }
+
+    // the rotor's phase error, from the angle of its (cos, sin) pair
+    double rotor_angle = atan2(rotor.rotor_sin, rotor.rotor_cos);
+    double exact_angle = 2.0 * M_PI * (uint32_t)((uint64_t)phase_inc * (uint64_t)BENCH_LONG_RUN) / 4294967296.0;
+    double phase_error = remainder(rotor_angle - exact_angle, 2.0 * M_PI);
+
+    printf("after %lld samples (%.0f s), max |error| over the last %d samples:\n",
+           (long long)BENCH_LONG_RUN, BENCH_LONG_RUN / BENCH_SAMPLE_RATE, BENCH_WINDOW);
+    printf("table     : %.3g\n", table_error);
+    printf("rotor     : %.3g (phase %.3g rad, radius %.3g)\n", rotor_error, phase_error, rotor_radius_error);
+    printf("libm sinf : %.3g (float angle from the time)\n", libm_error);
+}
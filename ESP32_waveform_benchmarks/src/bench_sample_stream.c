@@ -0,0 +1,192 @@
+/**
+ * Sample streaming: the sustained throughput of the chunked reader and ring
+ * buffer (lib/sample_stream), and the underruns while a consumer drains it in
+ * real time.
+ *
+ *   throughput - fill and drain as fast as possible, from memory, and on the
+ *                host from a file with fread() and from the same file mmap'd
+ *   real time  - a consumer (esp_timer on the ESP32, a thread on the host)
+ *                drains BENCH_STREAM_RATE samples per second in 1 ms bursts,
+ *                while this task refills the ring every BENCH_FILL_PERIOD_MS
+ *
+ * @file bench_sample_stream.c
+ * @author Philip Giacalone
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "sample_stream.h"
+
+#define BENCH_STREAM_RATE       150000      // samples per second, the function generator's default
+#define BENCH_RING_SAMPLES      8192        // 55 ms at BENCH_STREAM_RATE
+#define BENCH_CHUNK_SAMPLES     1024
+#define BENCH_FILL_PERIOD_MS    10
+#define BENCH_REAL_TIME_MS      2000
+
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+
+#define BENCH_SOURCE_SAMPLES    (64 * 1024)
+
+static esp_timer_handle_t consumer_timer;
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define BENCH_SOURCE_SAMPLES    (16 * 1024 * 1024)
+
+static pthread_t consumer_thread;
+static volatile int consumer_running;
+#endif
+
+static uint8_t ring[BENCH_RING_SAMPLES];
+static sample_stream_t stream;
+
+// one burst of the real time consumer: 1 ms of samples
+static void consume_1ms(void *arg) {
+    (void)arg;
+    uint8_t sample;
+    for (int i = 0; i < BENCH_STREAM_RATE / 1000; i++) {
+        sample_stream_read(&stream, &sample);
+        bench_sink += sample;
+    }
+}
+
+#ifdef ESP_PLATFORM
+static void start_consumer(void) {
+    const esp_timer_create_args_t args = {
+        .callback = consume_1ms,
+        .name = "consumer",
+    };
+    esp_timer_create(&args, &consumer_timer);
+    esp_timer_start_periodic(consumer_timer, 1000);
+}
+
+static void stop_consumer(void) {
+    esp_timer_stop(consumer_timer);
+    esp_timer_delete(consumer_timer);
+}
+
+static void sleep_ms(int ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+#else
+static void *consumer_main(void *arg) {
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (consumer_running) {
+        next.tv_nsec += 1000000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        consume_1ms(arg);
+    }
+    return NULL;
+}
+
+static void start_consumer(void) {
+    consumer_running = 1;
+    pthread_create(&consumer_thread, NULL, consumer_main, NULL);
+}
+
+static void stop_consumer(void) {
+    consumer_running = 0;
+    pthread_join(consumer_thread, NULL);
+}
+
+static void sleep_ms(int ms) {
+    usleep(ms * 1000);
+}
+#endif
+
+// plays the whole source (once) as fast as possible, returns samples per second
+static double throughput(const sample_source_t *source) {
+    sample_stream_init(&stream, ring, BENCH_RING_SAMPLES, BENCH_CHUNK_SAMPLES, source, false, 128);
+    int64_t samples = 0;
+    int64_t start = bench_now_us();
+    while (!sample_stream_finished(&stream)) {
+        sample_stream_fill(&stream);
+        uint8_t sample;
+        uint32_t fill = sample_stream_fill_level(&stream);
+        for (uint32_t i = 0; i < fill; i++) {
+            sample_stream_read(&stream, &sample);
+            bench_sink += sample;
+        }
+        samples += fill;
+    }
+    return bench_rate(samples, bench_now_us() - start);
+}
+
+static void print_throughput(const char *name, double rate) {
+    printf("%-22s: %8.2f Msamples/s (%.0fx %d samples/s)\n", name, rate / 1e6, rate / BENCH_STREAM_RATE,
+           BENCH_STREAM_RATE);
+}
+
+static void real_time(const char *name, const sample_source_t *source) {
+    sample_stream_init(&stream, ring, BENCH_RING_SAMPLES, BENCH_CHUNK_SAMPLES, source, true, 128);
+    sample_stream_fill(&stream);
+    start_consumer();
+    for (int ms = 0; ms < BENCH_REAL_TIME_MS; ms += BENCH_FILL_PERIOD_MS) {
+        sleep_ms(BENCH_FILL_PERIOD_MS);
+        sample_stream_fill(&stream);
+    }
+    stop_consumer();
+    printf("%-22s: %u underruns, %llu samples read, min fill %u of %d samples\n", name,
+           (unsigned)stream.stats.underruns, (unsigned long long)stream.stats.samples_read,
+           (unsigned)stream.stats.min_fill, BENCH_RING_SAMPLES);
+}
+
+void bench_sample_stream(void) {
+    printf("\n--- Sample stream (%d sample ring, %d sample chunks, %d KB source) ---\n",
+           BENCH_RING_SAMPLES, BENCH_CHUNK_SAMPLES, BENCH_SOURCE_SAMPLES / 1024);
+
+    uint8_t *recording = malloc(BENCH_SOURCE_SAMPLES);
+    if (recording == NULL) {
+        printf("not enough memory for the source\n");
+        return;
+    }
+    uint32_t seed = 1;
+    for (int i = 0; i < BENCH_SOURCE_SAMPLES; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        recording[i] = (uint8_t)(seed >> 24);
+    }
+
+    sample_source_t source;
+    sample_memory_t memory;
+    sample_source_memory(&source, &memory, recording, BENCH_SOURCE_SAMPLES);
+    print_throughput("memory", throughput(&source));
+    bench_yield();
+
+#ifndef ESP_PLATFORM
+    // the same recording in a file, read with fread() and with mmap()
+    FILE *file = tmpfile();
+    if (file != NULL && fwrite(recording, 1, BENCH_SOURCE_SAMPLES, file) == BENCH_SOURCE_SAMPLES) {
+        fflush(file);
+        rewind(file);
+        sample_source_file(&source, file);
+        print_throughput("file (fread)", throughput(&source));
+
+        void *mapped = mmap(NULL, BENCH_SOURCE_SAMPLES, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        if (mapped != MAP_FAILED) {
+            sample_source_memory(&source, &memory, (const uint8_t *)mapped, BENCH_SOURCE_SAMPLES);
+            print_throughput("file (mmap)", throughput(&source));
+            sample_source_memory(&source, &memory, (const uint8_t *)mapped, BENCH_SOURCE_SAMPLES);
+            real_time("real time (mmap)", &source);
+            munmap(mapped, BENCH_SOURCE_SAMPLES);
+        }
+    }
+    if (file != NULL) {
+        fclose(file);
+    }
+#else
+    sample_source_memory(&source, &memory, recording, BENCH_SOURCE_SAMPLES);
+    real_time("real time (memory)", &source);
+#endif
+    free(recording);
+}
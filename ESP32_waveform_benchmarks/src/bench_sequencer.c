@@ -0,0 +1,193 @@
+/**
+ * Event sequencer (lib/sequencer): the cost per timer callback of
+ * sequencer_next() against plain table playback, and a bit-exact check
+ * against a reference that does the obvious thing.
+ *
+ * The timeline has two events every BENCH_SEQ_SPACING samples (frequency
+ * steps, table switches, amplitude steps and ramps, gates and bursts),
+ * given out of order, and repeats. The reference scans every event at every
+ * sample, in the order given, so it is O(events) per sample, but simple.
+ * Every sample of both must match, over several passes of the timeline.
+ *
+ * @file bench_sequencer.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "dds.h"
+#include "isr_safe.h"
+#include "sequencer.h"
+
+#define BENCH_SEQ_RATE      150000.0
+#define BENCH_SEQ_BITS      10
+#define BENCH_SEQ_EVENTS    64
+#define BENCH_SEQ_SPACING   97          // samples between pairs of events
+#define BENCH_SEQ_PASSES    4
+#define BENCH_SEQ_MIDDLE    64
+
+static uint8_t seq_sine[1 << BENCH_SEQ_BITS];
+static uint8_t seq_ramp[1 << BENCH_SEQ_BITS];
+static const uint8_t *const seq_tables[] = {seq_sine, seq_ramp};
+
+static sequencer_event_t seq_given[BENCH_SEQ_EVENTS];
+static sequencer_event_t seq_events[BENCH_SEQ_EVENTS];
+
+// the reference: the same state as the sequencer, without the sorted timeline
+typedef struct {
+    uint32_t sample;
+    int32_t gain;
+    int32_t gain_target;
+    int32_t gain_step;
+    uint32_t ramp_left;
+    int gate;
+    uint32_t burst_left;
+} reference_t;
+
+static uint8_t reference_next(reference_t *ref, dds_table_player_t *player) {
+    // every event at this sample, in the order given. a repeat starts over at sample 0 (never a repeat)
+    for (int pass = 0; pass < 2; pass++) {
+        int repeated = 0;
+        for (int i = 0; i < BENCH_SEQ_EVENTS && !repeated; i++) {
+            const sequencer_event_t *event = &seq_given[i];
+            if (event->at != ref->sample) {
+                continue;
+            }
+            switch (event->type) {
+                case SEQUENCER_FREQUENCY: player->phase_inc = event->value; break;
+                case SEQUENCER_TABLE: player->table = seq_tables[event->value]; break;
+                case SEQUENCER_AMPLITUDE:
+                    ref->gain_target = (int32_t)event->value << SEQUENCER_RAMP_BITS;
+                    ref->ramp_left = event->length;
+                    if (event->length == 0) {
+                        ref->gain = ref->gain_target;
+                    } else {
+                        ref->gain_step = (ref->gain_target - ref->gain) / (int32_t)event->length;
+                    }
+                    break;
+                case SEQUENCER_GATE: ref->gate = event->value != 0; ref->burst_left = 0; break;
+                case SEQUENCER_BURST: player->phase = 0; ref->gate = event->value != 0; ref->burst_left = event->value; break;
+                default: repeated = 1; break;
+            }
+        }
+        if (!repeated) {
+            break;
+        }
+        ref->sample = 0;
+    }
+
+    uint32_t before = player->phase;
+    int32_t value = dds_table_next(player);
+    int32_t gain = ref->gain >> SEQUENCER_RAMP_BITS;
+    int gate = ref->gate;
+    if (ref->burst_left != 0 && player->phase < before && --ref->burst_left == 0) {
+        ref->gate = 0;
+    }
+    if (ref->ramp_left != 0) {
+        ref->ramp_left--;
+        ref->gain = ref->ramp_left == 0 ? ref->gain_target : ref->gain + ref->gain_step;
+    }
+    ref->sample++;
+    return gate ? (uint8_t)(BENCH_SEQ_MIDDLE + (((value - BENCH_SEQ_MIDDLE) * gain) >> 16)) : BENCH_SEQ_MIDDLE;
+}
+
+// a timeline with every kind of event, given out of order
+static void make_timeline(void) {
+    uint32_t seed = 12345;
+    for (int i = 0; i < BENCH_SEQ_EVENTS - 1; i++) {
+        seed = seed * 1664525U + 1013904223U;
+        sequencer_event_t *event = &seq_given[i];
+        // two events at each sample, applied in the order given
+        event->at = (uint32_t)(i / 2 * BENCH_SEQ_SPACING);
+        event->length = 0;
+        event->type = (seed >> 8) % SEQUENCER_REPEAT;
+        switch (event->type) {
+            case SEQUENCER_FREQUENCY: event->value = dds_phase_increment(100.0 + (seed >> 20), BENCH_SEQ_RATE); break;
+            case SEQUENCER_TABLE: event->value = (seed >> 16) & 1; break;
+            case SEQUENCER_AMPLITUDE:
+                event->value = (seed >> 15) % (SEQUENCER_UNITY_GAIN + 1);
+                event->length = (seed >> 4) % (3 * BENCH_SEQ_SPACING);
+                break;
+            case SEQUENCER_GATE: event->value = (seed >> 12) & 1; break;
+            default: event->value = 1 + (seed >> 24) % 4; break;
+        }
+    }
+    seq_given[BENCH_SEQ_EVENTS - 1].at = BENCH_SEQ_EVENTS / 2 * BENCH_SEQ_SPACING;
+    seq_given[BENCH_SEQ_EVENTS - 1].type = SEQUENCER_REPEAT;
+    seq_given[BENCH_SEQ_EVENTS - 1].value = 0;
+    seq_given[BENCH_SEQ_EVENTS - 1].length = 0;
+
+    // reverse the timeline, so the sequencer has to sort it
+    for (int i = 0; i < BENCH_SEQ_EVENTS / 2; i++) {
+        sequencer_event_t event = seq_given[i];
+        seq_given[i] = seq_given[BENCH_SEQ_EVENTS - 1 - i];
+        seq_given[BENCH_SEQ_EVENTS - 1 - i] = event;
+    }
+}
+
+void bench_sequencer(void) {
+    printf("\n--- Event sequencer (%d events, two every %d samples) ---\n", BENCH_SEQ_EVENTS, BENCH_SEQ_SPACING);
+
+    for (int i = 0; i < (1 << BENCH_SEQ_BITS); i++) {
+        seq_sine[i] = (uint8_t)lround(BENCH_SEQ_MIDDLE + 63.0 * sin(2.0 * M_PI * i / (1 << BENCH_SEQ_BITS)));
+        seq_ramp[i] = (uint8_t)(BENCH_SEQ_MIDDLE - 63 + (126 * i >> BENCH_SEQ_BITS));
+    }
+    make_timeline();
+    memcpy(seq_events, seq_given, sizeof(seq_events));
+
+    sequencer_t seq;
+    dds_table_player_t player;
+    dds_table_player_t reference_player;
+    reference_t ref = {0, SEQUENCER_UNITY_GAIN << SEQUENCER_RAMP_BITS, 0, 0, 0, 1, 0};
+    if (!sequencer_init(&seq, seq_events, BENCH_SEQ_EVENTS, seq_tables, 2, BENCH_SEQ_MIDDLE)) {
+        printf("sequencer_init() failed\n");
+        return;
+    }
+    dds_table_init(&player, seq_sine, BENCH_SEQ_BITS, 1000.0, BENCH_SEQ_RATE);
+    reference_player = player;
+
+    uint32_t samples = BENCH_SEQ_PASSES * BENCH_SEQ_EVENTS / 2 * BENCH_SEQ_SPACING;
+    uint32_t mismatches = 0;
+    uint32_t first = 0;
+    for (uint32_t n = 0; n < samples; n++) {
+        uint8_t expected = reference_next(&ref, &reference_player);
+        if (sequencer_next(&seq, &player) != expected && mismatches++ == 0) {
+            first = n;
+        }
+    }
+    printf("%u samples: %u events applied, %u repeats, %u mismatches against the reference",
+           (unsigned)samples, (unsigned)seq.fired, (unsigned)seq.repeats, (unsigned)mismatches);
+    if (mismatches > 0) {
+        printf(" (first at sample %u)", (unsigned)first);
+    }
+    printf("\n");
+    bench_yield();
+
+    // cycles per call, with and without the sequencer
+    isr_cycle_stats_t table_cycles;
+    isr_cycle_stats_t seq_cycles;
+    isr_cycle_stats_reset(&table_cycles);
+    isr_cycle_stats_reset(&seq_cycles);
+    for (uint32_t n = 0; n < samples; n++) {
+        uint32_t start = isr_cycle_count();
+        bench_sink = dds_table_next(&reference_player);
+        isr_cycle_stats_add(&table_cycles, isr_cycle_count() - start);
+        start = isr_cycle_count();
+        bench_sink = sequencer_next(&seq, &player);
+        isr_cycle_stats_add(&seq_cycles, isr_cycle_count() - start);
+    }
+    printf("table    : min %4u  mean %4u  max %6u cycles/call\n", (unsigned)table_cycles.min,
+           (unsigned)isr_cycle_stats_mean(&table_cycles), (unsigned)table_cycles.max);
+    printf("sequencer: min %4u  mean %4u  max %6u cycles/call\n", (unsigned)seq_cycles.min,
+           (unsigned)isr_cycle_stats_mean(&seq_cycles), (unsigned)seq_cycles.max);
+
+    int64_t start = bench_now_us();
+    for (uint32_t n = 0; n < BENCH_SAMPLES; n++) {
+        bench_sink = sequencer_next(&seq, &player);
+    }
+    int64_t elapsed = bench_now_us() - start;
+    printf("sequencer: %.2f Msamples/s\n", bench_rate(BENCH_SAMPLES, elapsed) / 1e6);
+}
@@ -0,0 +1,104 @@
+/**
+ * Band-limited square wave: cost of the per-sample Fourier sum that
+ * ESP32_dacWrite_sine_wave used (6 sin() calls per sample) against one read
+ * of a makeWaveCycle() table, plus how much of each output's energy is
+ * aliasing, compared with a naive (hard edged) square wave.
+ *
+ * @file bench_shapes.cpp
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "dds.h"
+#include "wave_table.h"
+
+#define WAVE_TABLE_BITS     10
+#define SHAPE_FREQUENCY     1230.0      // a multiple of 10 Hz, so every harmonic falls on a DFT bin
+#define SHAPE_SAMPLE_RATE   150000.0
+#define SHAPE_SAMPLES       15000       // 0.1 s, 10 Hz bins
+
+static constexpr int harmonics = wave_table::maxHarmonic(SHAPE_FREQUENCY, SHAPE_SAMPLE_RATE);
+
+static constexpr auto square = wave_table::makeWaveCycle<1 << WAVE_TABLE_BITS>(
+    wave_table::Shape::Square, harmonics, 1.0);
+
+static float samples[SHAPE_SAMPLES];
+
+// the fraction of the (AC) energy that is not at a harmonic of SHAPE_FREQUENCY, in dB
+static double alias_db(void) {
+    double mean = 0.0;
+    for (int n = 0; n < SHAPE_SAMPLES; n++) {
+        mean += samples[n];
+    }
+    mean /= SHAPE_SAMPLES;
+    double total = 0.0;
+    for (int n = 0; n < SHAPE_SAMPLES; n++) {
+        total += (samples[n] - mean) * (samples[n] - mean);
+    }
+    total /= SHAPE_SAMPLES;
+
+    double harmonic_power = 0.0;
+    for (int k = 1; k <= harmonics; k++) {
+        // Goertzel at the kth harmonic
+        double w = 2.0 * M_PI * k * SHAPE_FREQUENCY / SHAPE_SAMPLE_RATE;
+        double coeff = 2.0 * cos(w);
+        double s1 = 0.0, s2 = 0.0;
+        for (int n = 0; n < SHAPE_SAMPLES; n++) {
+            double s0 = samples[n] + coeff * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+        double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+        harmonic_power += 2.0 * power / ((double)SHAPE_SAMPLES * SHAPE_SAMPLES);
+    }
+    double alias = total - harmonic_power;
+    return 10.0 * log10((alias > 0.0 ? alias : 1e-30) / total);
+}
+
+extern "C" void bench_shapes(void) {
+    printf("\n--- Band-limited square wave (%d harmonics): table vs Fourier sum ---\n", harmonics);
+
+    // the ESP32_dacWrite_sine_wave loop body
+    int64_t start = bench_now_us();
+    for (int64_t n = 0; n < BENCH_SAMPLES / 10; n++) {
+        float angle = 2.0f * (float)M_PI * (float)(n % 360) / 360.0f;
+        bench_sink = int(128 + 80 * (sin(angle) + sin(3 * angle) / 3 + sin(5 * angle) / 5 + sin(7 * angle) / 7 +
+                                     sin(9 * angle) / 9 + sin(11 * angle) / 11));
+    }
+    int64_t sum_us = bench_now_us() - start;
+    bench_yield();
+
+    dds_table_player_t player;
+    dds_table_init(&player, square.values, WAVE_TABLE_BITS, SHAPE_FREQUENCY, SHAPE_SAMPLE_RATE);
+    start = bench_now_us();
+    for (int64_t n = 0; n < BENCH_SAMPLES; n++) {
+        bench_sink = dds_table_next(&player);
+    }
+    int64_t table_us = bench_now_us() - start;
+    bench_yield();
+
+    printf("Fourier sum (6 sin) : %12.0f samples/s\n", bench_rate(BENCH_SAMPLES / 10, sum_us));
+    printf("table read          : %12.0f samples/s\n", bench_rate(BENCH_SAMPLES, table_us));
+
+    // naive square: the sign of the phase, with its infinite harmonics folded back
+    uint32_t phase = 0;
+    uint32_t phase_inc = dds_phase_increment(SHAPE_FREQUENCY, SHAPE_SAMPLE_RATE);
+    for (int n = 0; n < SHAPE_SAMPLES; n++) {
+        samples[n] = (phase < 0x80000000UL) ? 254.0f : 0.0f;
+        phase += phase_inc;
+    }
+    double naive_db = alias_db();
+    bench_yield();
+
+    dds_table_init(&player, square.values, WAVE_TABLE_BITS, SHAPE_FREQUENCY, SHAPE_SAMPLE_RATE);
+    for (int n = 0; n < SHAPE_SAMPLES; n++) {
+        samples[n] = dds_table_next_interp(&player);
+    }
+    double table_db = alias_db();
+
+    printf("aliased energy at %.0f Hz, %.0f samples/s: naive %.1f dB, band-limited table %.1f dB\n",
+           SHAPE_FREQUENCY, SHAPE_SAMPLE_RATE, naive_db, table_db);
+}
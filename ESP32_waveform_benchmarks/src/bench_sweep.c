@@ -0,0 +1,93 @@
+/**
+ * Swept-sine frequency response (lib/sweep) against a simulated RC low-pass
+ * filter: how fast a sweep runs (samples per second through the chirp, the
+ * model and the Goertzel filters) and how close the measured magnitude and
+ * phase are to the filter's exact response.
+ *
+ * The model stands in for the DAC -> RC -> ADC path of ESP32_bandwidth_test:
+ * 8-bit DAC values in, 12-bit ADC counts out (16 counts per DAC step).
+ *
+ * @file bench_sweep.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "sweep.h"
+
+#define BENCH_SWEEP_RATE        20000.0f    // samples per second (ESP32_bandwidth_test's default)
+#define BENCH_SWEEP_BINS        48
+#define BENCH_RC_CUTOFF         1000.0f     // Hz
+#define BENCH_ADC_COUNTS        16.0f       // ADC counts per DAC step
+
+static sweep_bin_t bench_bins[BENCH_SWEEP_BINS];
+
+static void run_sweep(const char *name, const sweep_config_t *config, bool quantize) {
+    sweep_t sweep;
+    sweep_rc_t rc;
+    sweep_init(&sweep, config, bench_bins);
+    sweep_rc_init(&rc, BENCH_RC_CUTOFF, config->sample_rate, 128.0f * BENCH_ADC_COUNTS);
+
+    int64_t samples = 0;
+    int64_t start = bench_now_us();
+    bool running = true;
+    while (running) {
+        float response = sweep_rc_next(&rc, sweep_next(&sweep) * BENCH_ADC_COUNTS);
+        running = sweep_capture(&sweep, quantize ? floorf(response + 0.5f) : response);
+        samples++;
+    }
+    int64_t elapsed = bench_now_us() - start;
+
+    float magnitude_error = 0.0f;
+    float phase_error = 0.0f;
+    for (int i = 0; i < BENCH_SWEEP_BINS; i++) {
+        float magnitude;
+        float phase;
+        sweep_rc_response(&rc, bench_bins[i].frequency, config->sample_rate, &magnitude, &phase);
+        float db = 20.0f * log10f(bench_bins[i].magnitude / (magnitude * BENCH_ADC_COUNTS));
+        magnitude_error = fabsf(db) > magnitude_error ? fabsf(db) : magnitude_error;
+        float degrees = fabsf(bench_bins[i].phase - phase);
+        phase_error = degrees > phase_error ? degrees : phase_error;
+    }
+    printf("%-18s: %7.2f Msamples/s (%.1fx real time), max error %.3f dB, %.2f degrees\n",
+           name, bench_rate(samples, elapsed) / 1e6, bench_rate(samples, elapsed) / config->sample_rate,
+           magnitude_error, phase_error);
+}
+
+void bench_sweep(void) {
+    sweep_config_t config = {
+        .spacing = SWEEP_LOG,
+        .start_frequency = 20.0f,
+        .stop_frequency = 9000.0f,
+        .bins = BENCH_SWEEP_BINS,
+        .sample_rate = BENCH_SWEEP_RATE,
+        .min_cycles = 8,
+        .min_samples = 256,
+        .amplitude = 100,
+        .settle_samples = 2000,
+    };
+    printf("\n--- Swept sine, RC low-pass at %.0f Hz (%d bins up to %.0f Hz, %.0f samples/s) ---\n",
+           BENCH_RC_CUTOFF, BENCH_SWEEP_BINS, config.stop_frequency, config.sample_rate);
+
+    config.spacing = SWEEP_LINEAR;
+    config.start_frequency = 100.0f;
+    run_sweep("linear", &config, false);
+    bench_yield();
+    config.spacing = SWEEP_LOG;
+    config.start_frequency = 20.0f;
+    run_sweep("log", &config, false);
+    bench_yield();
+    run_sweep("log, 12-bit ADC", &config, true);
+
+    // the -3 dB point, from the last sweep
+    float reference = bench_bins[0].magnitude;
+    for (int i = 1; i < BENCH_SWEEP_BINS; i++) {
+        if (bench_bins[i].magnitude < reference * 0.70711f) {
+            printf("-3 dB between %.0f and %.0f Hz (RC cutoff %.0f Hz)\n",
+                   bench_bins[i - 1].frequency, bench_bins[i].frequency, BENCH_RC_CUTOFF);
+            break;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+/**
+ * Sample-count time base (lib/time_base): a soak test in virtual time.
+ *
+ * Days of uptime are simulated by jumping the sample count ahead (every
+ * BENCH_SOAK_HOURS, up to BENCH_SOAK_DAYS), then playing BENCH_SOAK_TICKS
+ * callbacks, each up to BENCH_SOAK_LATE_US late on the clock. At every
+ * callback the phase of each method is compared with the exact phase
+ * (sample * frequency / sample rate, in integers):
+ *
+ *   clock (float)   2πft in float, with t from the microsecond clock
+ *   clock (double)  the same in double (VERSION 0 of ESP32_dynamic_waveforms
+ *                   and ESP32_hi_resolution_timer before the time base)
+ *   dds 32-bit      a 32-bit phase accumulator (sample * 32-bit increment)
+ *   time base       time_base_phase()
+ *
+ * The clock methods play a late callback at a later phase. The others only
+ * count callbacks, so lateness cannot move them.
+ *
+ * @file bench_time_base.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "dds.h"
+#include "time_base.h"
+
+#define BENCH_SOAK_DAYS     30
+#define BENCH_SOAK_HOURS    6
+#define BENCH_SOAK_TICKS    1000
+#define BENCH_SOAK_LATE_US  50
+#define BENCH_SOAK_TWOPI    (2.0 * M_PI)
+#define BENCH_SOAK_CYCLE    4294967296.0    // 2^32, one cycle of a 32-bit phase
+
+enum {
+    SOAK_CLOCK_FLOAT = 0,
+    SOAK_CLOCK_DOUBLE,
+    SOAK_DDS,
+    SOAK_TIME_BASE,
+    SOAK_METHODS
+};
+
+static const char *const soak_names[SOAK_METHODS] = {"clock (float)", "clock (double)", "dds 32-bit", "time base"};
+
+// the sample rates and frequencies of the dynamic generators
+static const struct {
+    uint32_t sample_rate;
+    uint32_t frequency;
+} soak_cases[] = {
+    {100000, 100},      // ESP32_dynamic_waveforms
+    {100000, 1000},
+    {10000, 1000},      // ESP32_hi_resolution_timer
+    {150000, 7001},     // an increment that is far from a whole number of steps
+};
+
+// the difference of two phases in degrees, wrapped to -180 to 180
+static double phase_error(double cycles, double exact) {
+    double error = cycles - exact;
+    return fabs(360.0 * (error - floor(error + 0.5)));
+}
+
+static void soak(uint32_t sample_rate, uint32_t frequency) {
+    time_base_t tb;
+    time_base_init(&tb, sample_rate);
+    uint64_t increment = time_base_increment(&tb, frequency);
+    uint32_t dds_increment = dds_phase_increment(frequency, sample_rate);
+
+    double worst[SOAK_METHODS] = {0.0};
+    double last[SOAK_METHODS] = {0.0};
+    uint32_t seed = 12345;
+    for (uint32_t hours = 0; hours <= BENCH_SOAK_DAYS * 24; hours += BENCH_SOAK_HOURS) {
+        // skip ahead in virtual time
+        tb.sample = (uint64_t)hours * 3600 * sample_rate;
+        for (int i = 0; i < BENCH_SOAK_TICKS; i++) {
+            uint64_t n = tb.sample;
+            double exact = (double)(n % sample_rate * frequency % sample_rate) / sample_rate;
+
+            // the clock reads a late callback's time, in whole microseconds
+            seed = seed * 1664525U + 1013904223U;
+            int64_t time_us = (int64_t)(n * 1000000 / sample_rate) + (seed >> 8) % (BENCH_SOAK_LATE_US + 1);
+            double t = time_us / 1000000.0;
+            float radians = (float)BENCH_SOAK_TWOPI * (float)frequency * (float)t;
+
+            // sin() sees the angle modulo 2π
+            double cycles[SOAK_METHODS];
+            cycles[SOAK_CLOCK_FLOAT] = fmod(radians, BENCH_SOAK_TWOPI) / BENCH_SOAK_TWOPI;
+            cycles[SOAK_CLOCK_DOUBLE] = fmod(BENCH_SOAK_TWOPI * frequency * t, BENCH_SOAK_TWOPI) / BENCH_SOAK_TWOPI;
+            cycles[SOAK_DDS] = (uint32_t)(n * dds_increment) / BENCH_SOAK_CYCLE;
+            cycles[SOAK_TIME_BASE] = time_base_phase(&tb, increment) / BENCH_SOAK_CYCLE;
+            time_base_tick(&tb);
+
+            for (int m = 0; m < SOAK_METHODS; m++) {
+                double error = phase_error(cycles[m], exact);
+                worst[m] = error > worst[m] ? error : worst[m];
+                last[m] = error;
+            }
+        }
+    }
+
+    printf("%u Hz at %u samples/s (%.1f days, %.0f callbacks/day):\n", (unsigned)frequency,
+           (unsigned)sample_rate, time_base_seconds(&tb) / 86400.0, 86400.0 * sample_rate);
+    for (int m = 0; m < SOAK_METHODS; m++) {
+        printf("  %-15s max phase error %10.6f deg, at the end %10.6f deg\n", soak_names[m], worst[m], last[m]);
+    }
+}
+
+void bench_time_base(void) {
+    printf("\n--- Sample-count time base: %d day soak in virtual time (%d callbacks every %d hours, up to %d us late) ---\n",
+           BENCH_SOAK_DAYS, BENCH_SOAK_TICKS, BENCH_SOAK_HOURS, BENCH_SOAK_LATE_US);
+    for (size_t i = 0; i < sizeof(soak_cases) / sizeof(soak_cases[0]); i++) {
+        soak(soak_cases[i].sample_rate, soak_cases[i].frequency);
+        bench_yield();
+    }
+}
@@ -0,0 +1,127 @@
+/**
+ * Timer callback tracing (lib/timer_trace): the cost of a stamp in the ISR,
+ * and a check of the histograms against calls with known latencies.
+ *
+ * The calls are simulated: one every BENCH_TRACE_PERIOD cycles (10 us at
+ * 240 MHz), each late by 0 to 0.5 us, except for one in a hundred that is
+ * late by 10 to 20 us (a glitch). The task collects every
+ * BENCH_TRACE_COLLECT calls, then stops collecting for a while, so the ring
+ * fills up and drops stamps. The exact min, max and p99 of the latencies
+ * played must match the report (the p99 to within a bin), and the report
+ * must come back unchanged from its binary frame.
+ *
+ * @file bench_timer_trace.c
+ * @author Philip Giacalone
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "isr_safe.h"
+#include "timer_trace.h"
+
+#define BENCH_TRACE_MHZ         240
+#define BENCH_TRACE_PERIOD      (10 * BENCH_TRACE_MHZ)
+#define BENCH_TRACE_BIN         (BENCH_TRACE_MHZ / 4)   // 0.25 us
+#define BENCH_TRACE_CALLS       100000
+#define BENCH_TRACE_COLLECT     64
+
+static timer_trace_t trace;
+static timer_trace_report_t report;
+static timer_trace_report_t imported;
+static int32_t latencies[BENCH_TRACE_CALLS];
+static uint8_t frame[TIMER_TRACE_EXPORT_MAX];
+
+static int compare_int32(const void *a, const void *b) {
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_histogram(const char *name, const timer_trace_histogram_t *histogram) {
+    double us = BENCH_TRACE_MHZ;
+    printf("%-8s min %6.2f  mean %6.2f  p99 %6.2f  max %6.2f us (%u calls)\n", name, histogram->min / us,
+           timer_trace_mean(histogram) / us, timer_trace_percentile(histogram, 990) / us, histogram->max / us,
+           (unsigned)histogram->count);
+}
+
+void bench_timer_trace(void) {
+    printf("\n--- Timer callback trace (%d simulated calls every %d us, ring of %d stamps) ---\n",
+           BENCH_TRACE_CALLS, BENCH_TRACE_PERIOD / BENCH_TRACE_MHZ, TIMER_TRACE_RING);
+
+    timer_trace_init(&trace);
+    timer_trace_report_init(&report, BENCH_TRACE_PERIOD, BENCH_TRACE_MHZ, BENCH_TRACE_BIN);
+
+    // starts near the top of the cycle counter, so it wraps. The first call is on time, which sets
+    // when the others are due
+    uint32_t due = 0xFFF00000U;
+    uint32_t seed = 12345;
+    uint32_t collected = 0;
+    uint32_t kept = 0;
+    for (int n = 0; n < BENCH_TRACE_CALLS; n++) {
+        seed = seed * 1664525U + 1013904223U;
+        int32_t late = n == 0 ? 0 : (int32_t)((seed >> 8) % (BENCH_TRACE_MHZ / 2 + 1));
+        if (n > 0 && (seed >> 24) % 100 == 0) {
+            late = 10 * BENCH_TRACE_MHZ + (int32_t)((seed >> 4) % (10 * BENCH_TRACE_MHZ + 1));
+        }
+        uint32_t dropped = trace.dropped;
+        timer_trace_stamp(&trace, due + (uint32_t)late);
+        due += BENCH_TRACE_PERIOD;
+        // what the report should hold: the latencies of the stamps that were not dropped
+        if (trace.dropped == dropped) {
+            latencies[kept++] = late;
+        }
+
+        // the task falls behind for a while in the middle
+        int behind = n >= BENCH_TRACE_CALLS / 2 && n < BENCH_TRACE_CALLS / 2 + 2 * TIMER_TRACE_RING;
+        if (!behind && n % BENCH_TRACE_COLLECT == BENCH_TRACE_COLLECT - 1) {
+            collected += timer_trace_collect(&trace, &report);
+        }
+    }
+    collected += timer_trace_collect(&trace, &report);
+    bench_yield();
+
+    qsort(latencies, kept, sizeof(latencies[0]), compare_int32);
+    int32_t p99 = latencies[(kept * 99 + 99) / 100 - 1];
+    int32_t max = latencies[kept - 1];
+
+    print_histogram("latency", &report.latency);
+    print_histogram("jitter", &report.jitter);
+    int32_t reported_p99 = timer_trace_percentile(&report.latency, 990);
+    printf("expected: min 0.00  p99 %6.2f  max %6.2f us, %u collected, %u dropped: %s\n", p99 / (double)BENCH_TRACE_MHZ,
+           max / (double)BENCH_TRACE_MHZ, (unsigned)kept, (unsigned)(BENCH_TRACE_CALLS - kept),
+           report.latency.min == 0 && report.latency.max == max && collected == kept &&
+           report.dropped == BENCH_TRACE_CALLS - kept && reported_p99 >= p99 && reported_p99 - p99 <= BENCH_TRACE_BIN
+               ? "ok" : "MISMATCH");
+
+    size_t size = timer_trace_export(&report, frame);
+    int same = timer_trace_import(&imported, frame, size) &&
+               memcmp(&imported.latency, &report.latency, sizeof(report.latency)) == 0 &&
+               memcmp(&imported.jitter, &report.jitter, sizeof(report.jitter)) == 0 &&
+               imported.dropped == report.dropped && imported.period == report.period;
+    printf("binary frame: %u bytes (at most %d), round trip %s\n", (unsigned)size, TIMER_TRACE_EXPORT_MAX,
+           same ? "ok" : "MISMATCH");
+    bench_yield();
+
+    // the cost of a stamp, in the ISR, and of collecting it, in the task
+    timer_trace_init(&trace);
+    timer_trace_report_init(&report, BENCH_TRACE_PERIOD, BENCH_TRACE_MHZ, BENCH_TRACE_BIN);
+    isr_cycle_stats_t stamp_cycles;
+    isr_cycle_stats_reset(&stamp_cycles);
+    uint32_t collect_cycles = 0;
+    for (uint32_t n = 0; n < BENCH_SAMPLES; n++) {
+        uint32_t start = isr_cycle_count();
+        timer_trace_stamp(&trace, start);
+        isr_cycle_stats_add(&stamp_cycles, isr_cycle_count() - start);
+        if (n % BENCH_TRACE_COLLECT == BENCH_TRACE_COLLECT - 1) {
+            start = isr_cycle_count();
+            timer_trace_collect(&trace, &report);
+            collect_cycles += isr_cycle_count() - start;
+        }
+    }
+    printf("stamp: min %u  mean %u  max %u cycles, collect: %u cycles per stamp\n", (unsigned)stamp_cycles.min,
+           (unsigned)isr_cycle_stats_mean(&stamp_cycles), (unsigned)stamp_cycles.max,
+           (unsigned)(collect_cycles / BENCH_SAMPLES));
+}
@@ -0,0 +1,149 @@
+/**
+ * Polyphase upsampling (lib/upsample): the cost per output sample and the
+ * image rejection for different filter lengths, against the two cheap ways
+ * of raising the rate:
+ *
+ *   hold    - repeat each input sample L times (zero order hold)
+ *   linear  - interpolate linearly between input samples
+ *   N taps  - the polyphase FIR, N coefficients per phase
+ *
+ * The input is a Q15 sine at 0.2 x the input rate. Image rejection is the
+ * fundamental over the largest image (around multiples of the input rate), in
+ * dB, from Goertzel filters over BENCH_IMAGE_SAMPLES output samples. The
+ * cycles are per output sample, measured around blocks of BENCH_BLOCK inputs
+ * the way a render task would call upsample_process().
+ *
+ * @file bench_upsample.c
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "isr_safe.h"
+#include "upsample.h"
+
+#define BENCH_FACTOR        4
+#define BENCH_BLOCK         64                          // input samples per block
+#define BENCH_IMAGE_SAMPLES 4096                        // output samples analyzed
+#define BENCH_CUTOFF        0.8
+
+typedef enum { BENCH_HOLD, BENCH_LINEAR, BENCH_POLYPHASE } bench_method_t;
+
+static int16_t input[BENCH_IMAGE_SAMPLES];
+static int16_t output[BENCH_IMAGE_SAMPLES * 2];
+
+// the Goertzel bin of the sine in the output, about 0.2 x the input rate
+static uint32_t sine_bin(uint32_t factor) {
+    return BENCH_IMAGE_SAMPLES / (5 * factor);
+}
+
+// the input sine: whole cycles in BENCH_IMAGE_SAMPLES / factor inputs
+static int16_t sine_input(uint32_t n, uint32_t factor) {
+    return (int16_t)lround(0.9 * 32767 * sin(2 * M_PI * sine_bin(factor) * factor * (double)n / BENCH_IMAGE_SAMPLES));
+}
+
+static void run(bench_method_t method, upsample_t *upsample, const int16_t *in, uint32_t count, int16_t *out,
+                int16_t *previous) {
+    uint32_t factor = upsample->factor;
+    if (method == BENCH_POLYPHASE) {
+        upsample_process(upsample, in, count, out);
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t j = 0; j < factor; j++) {
+            *out++ = method == BENCH_HOLD ? in[i] : (int16_t)(*previous + (in[i] - *previous) * (int32_t)j / (int32_t)factor);
+        }
+        *previous = in[i];
+    }
+}
+
+// power of an output bin (Goertzel)
+static double bin_power(const int16_t *samples, uint32_t count, double bin) {
+    double coeff = 2.0 * cos(2 * M_PI * bin / count);
+    double s1 = 0.0, s2 = 0.0;
+    for (uint32_t i = 0; i < count; i++) {
+        double s = samples[i] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s;
+    }
+    return s1 * s1 + s2 * s2 - coeff * s1 * s2;
+}
+
+static double image_rejection(bench_method_t method, upsample_t *upsample) {
+    uint32_t factor = upsample->factor;
+    uint32_t inputs = BENCH_IMAGE_SAMPLES / factor;
+    int16_t previous = 0;
+    upsample_reset(upsample);
+    // one pass to fill the filter, one to analyze (the sine has whole cycles in the window)
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint32_t n = 0; n < inputs; n++) {
+            input[n] = sine_input(n, factor);
+        }
+        run(method, upsample, input, inputs, output, &previous);
+    }
+
+    uint32_t bin = sine_bin(factor);
+    double fundamental = bin_power(output, BENCH_IMAGE_SAMPLES, bin);
+    double image = 0.0;
+    uint32_t input_rate_bin = BENCH_IMAGE_SAMPLES / factor;
+    for (uint32_t m = 1; m < factor; m++) {
+        double below = bin_power(output, BENCH_IMAGE_SAMPLES, m * input_rate_bin - bin);
+        double above = bin_power(output, BENCH_IMAGE_SAMPLES, m * input_rate_bin + bin);
+        image = below > image ? below : image;
+        image = above > image ? above : image;
+    }
+    return 10.0 * log10(fundamental / (image > 0.0 ? image : 1e-30));
+}
+
+static void bench_method(const char *name, bench_method_t method, uint32_t factor, uint32_t taps) {
+    upsample_t upsample;
+    upsample_init(&upsample, factor, taps, BENCH_CUTOFF);
+    int16_t previous = 0;
+    for (uint32_t n = 0; n < BENCH_BLOCK; n++) {
+        input[n] = sine_input(n, factor);
+    }
+
+    int64_t outputs = 0;
+    int64_t start = bench_now_us();
+    while (outputs < BENCH_SAMPLES) {
+        run(method, &upsample, input, BENCH_BLOCK, output, &previous);
+        bench_sink += output[0];
+        outputs += BENCH_BLOCK * factor;
+    }
+    int64_t elapsed = bench_now_us() - start;
+
+    isr_cycle_stats_t stats;
+    isr_cycle_stats_reset(&stats);
+    for (int i = 0; i < 1000; i++) {
+        uint32_t begin = isr_cycle_count();
+        run(method, &upsample, input, BENCH_BLOCK, output, &previous);
+        isr_cycle_stats_add(&stats, isr_cycle_count() - begin);
+        bench_sink += output[0];
+    }
+    bench_yield();
+
+    printf("%-8s L=%u: %8.2f Msamples/s, %6.1f cycles/sample, images %6.1f dB down, %4u bytes of coefficients\n",
+           name, (unsigned)factor, bench_rate(outputs, elapsed) / 1e6,
+           (double)stats.min / (BENCH_BLOCK * factor), image_rejection(method, &upsample),
+           method == BENCH_POLYPHASE ? (unsigned)(factor * taps * sizeof(int16_t)) : 0u);
+}
+
+void bench_upsample(void) {
+    printf("\n--- Upsampling (sine at 0.2 x the input rate, cutoff %.1f) ---\n", BENCH_CUTOFF);
+    bench_method("hold", BENCH_HOLD, BENCH_FACTOR, 1);
+    bench_yield();
+    bench_method("linear", BENCH_LINEAR, BENCH_FACTOR, 1);
+    bench_yield();
+    const uint32_t taps[] = {4, 8, 12, 16};
+    for (uint32_t i = 0; i < sizeof(taps) / sizeof(taps[0]); i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "%u taps", (unsigned)taps[i]);
+        bench_method(name, BENCH_POLYPHASE, BENCH_FACTOR, taps[i]);
+        bench_yield();
+    }
+    bench_method("8 taps", BENCH_POLYPHASE, 2, 8);
+    bench_yield();
+    bench_method("8 taps", BENCH_POLYPHASE, 8, 8);
+}
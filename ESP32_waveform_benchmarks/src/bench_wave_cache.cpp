@@ -0,0 +1,105 @@
+/**
+ * Wave table cache: the cost of switching to a preset whose table is cached
+ * (a hash lookup) against rendering it (a miss), plus the hit rate of a
+ * working set that is larger than the cache.
+ *
+ * @file bench_wave_cache.cpp
+ * @author Philip Giacalone
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+#include "dds.h"
+#include "wave_cache.h"
+
+#define WAVE_TABLE_BITS     10
+#define CACHE_TABLES        8
+#define SAMPLE_RATE         150000.0f
+
+using wave_table::Shape;
+
+static wave_cache::Cache<1 << WAVE_TABLE_BITS, CACHE_TABLES> cache;
+
+static const wave_cache::Key presets[] = {
+    {Shape::Sine, 200.0f, 0.5f, SAMPLE_RATE},
+    {Shape::Square, 200.0f, 0.5f, SAMPLE_RATE},
+    {Shape::Triangle, 200.0f, 0.5f, SAMPLE_RATE},
+    {Shape::Sawtooth, 200.0f, 0.5f, SAMPLE_RATE},
+    {Shape::Square, 1000.0f, 0.5f, SAMPLE_RATE},
+    {Shape::Sawtooth, 5000.0f, 0.8f, SAMPLE_RATE},
+    {Shape::Pulse, 440.0f, 0.5f, SAMPLE_RATE},
+    {Shape::Triangle, 7000.0f, 1.0f, SAMPLE_RATE},
+    {Shape::Square, 7000.0f, 1.0f, SAMPLE_RATE},
+    {Shape::Sawtooth, 100.0f, 0.3f, SAMPLE_RATE},
+};
+
+#define PRESET_COUNT    (sizeof(presets) / sizeof(presets[0]))
+
+// switches the player to a preset, the way the function generator does
+static void select_preset(dds_table_player_t *player, const wave_cache::Key &key) {
+    const uint8_t *table = cache.get(key);
+    cache.setPlaying(table);
+    dds_table_select(player, table, key.frequency, key.sampleRate);
+}
+
+extern "C" void bench_wave_cache(void) {
+    printf("\n--- Wave table cache (%d tables of %d entries) ---\n", CACHE_TABLES, 1 << WAVE_TABLE_BITS);
+
+    dds_table_player_t player;
+    cache.get(presets[0]);
+    dds_table_init(&player, cache.find(presets[0]), WAVE_TABLE_BITS, presets[0].frequency, SAMPLE_RATE);
+
+    // misses: render each table of a working set that fits the cache
+    int64_t start = bench_now_us();
+    for (int i = 1; i < CACHE_TABLES; i++) {
+        select_preset(&player, presets[i]);
+    }
+    int64_t miss_us = bench_now_us() - start;
+    bench_yield();
+
+    // hits: switch among the same presets
+    const int switches = 10000;
+    start = bench_now_us();
+    for (int i = 0; i < switches; i++) {
+        select_preset(&player, presets[i % CACHE_TABLES]);
+        bench_sink = dds_table_next(&player);
+    }
+    int64_t hit_us = bench_now_us() - start;
+    bench_yield();
+
+    printf("switch, table rendered (miss) : %10.1f us\n", (double)miss_us / (CACHE_TABLES - 1));
+    printf("switch, table cached (hit)    : %10.3f us\n", (double)hit_us / switches);
+
+    // a working set larger than the cache, mostly revisiting recent presets
+    cache.clear();
+    uint32_t seed = 1;
+    for (int i = 0; i < 2000; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        // 3 of 4 switches go to the first 6 presets
+        uint32_t pick = (seed >> 16) % 4 == 0 ? (seed >> 8) % PRESET_COUNT : (seed >> 8) % 6;
+        select_preset(&player, presets[pick]);
+        if (i % 100 == 0) {
+            bench_yield();
+        }
+    }
+    const wave_cache::Stats &stats = cache.stats();
+    printf("%d presets, %d tables: %u hits, %u misses, %u evictions (hit rate %.1f%%)\n",
+           (int)PRESET_COUNT, CACHE_TABLES, (unsigned)stats.hits, (unsigned)stats.misses,
+           (unsigned)stats.evictions, 100.0 * stats.hits / (stats.hits + stats.misses));
+
+    // every cached table matches a fresh render
+    int mismatches = 0;
+    for (const auto &key : presets) {
+        const uint8_t *table = cache.find(key);
+        if (table == nullptr) {
+            continue;
+        }
+        auto fresh = wave_table::makeWaveCycle<1 << WAVE_TABLE_BITS>(
+            key.shape, wave_table::maxHarmonic(key.frequency, key.sampleRate), key.amplitude);
+        for (int i = 0; i < (1 << WAVE_TABLE_BITS); i++) {
+            mismatches += table[i] != fresh[i];
+        }
+    }
+    printf("cached entries differing from a fresh render: %d\n", mismatches);
+}
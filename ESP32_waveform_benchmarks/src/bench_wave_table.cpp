@@ -0,0 +1,57 @@
+/**
+ * Compile-time wave table: compares the constexpr table against the runtime
+ * populateWaveArray() (int array filled with sin() at boot).
+ *
+ * @file bench_wave_table.cpp
+ * @author Philip Giacalone
+ */
+
+#include <math.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "wave_table.h"
+
+// the ESP32_function_generator settings
+#define FREQUENCY           200
+#define SAMPLES_PER_SECOND  150000
+#define ATTENUATION         0.5
+#define MAX_DAC_AMPLITUDE   127
+#define SAMPLES_PER_CYCLE   (SAMPLES_PER_SECOND / FREQUENCY)
+
+static_assert(wave_table::validAttenuation(ATTENUATION), "ATTENUATION must be between 0.0 and 1.0");
+
+WAVE_TABLE_ATTR constexpr auto waveValues =
+    wave_table::makeSineTable<FREQUENCY, SAMPLES_PER_SECOND>(ATTENUATION, MAX_DAC_AMPLITUDE);
+
+static int runtimeValues[SAMPLES_PER_CYCLE];
+
+// the runtime version this replaces
+static void populateWaveArray() {
+    for (int i = 0; i < SAMPLES_PER_CYCLE; i++) {
+        float angleInRadians = 2.0 * M_PI * i / SAMPLES_PER_CYCLE;
+        long value = ATTENUATION * (MAX_DAC_AMPLITUDE + MAX_DAC_AMPLITUDE * sin(angleInRadians));
+        runtimeValues[i] = value;
+    }
+}
+
+extern "C" void bench_wave_table(void) {
+    printf("\n--- Wave table: constexpr uint8_t vs runtime int (%d Hz at %d samples/s) ---\n",
+           FREQUENCY, SAMPLES_PER_SECOND);
+
+    int64_t start = bench_now_us();
+    populateWaveArray();
+    int64_t populate_us = bench_now_us() - start;
+
+    int mismatches = 0;
+    for (int i = 0; i < SAMPLES_PER_CYCLE; i++) {
+        if (abs(runtimeValues[i] - waveValues[i]) > 1) {
+            mismatches++;
+        }
+    }
+
+    printf("runtime populateWaveArray() : %lld us at startup, %d bytes\n",
+           (long long)populate_us, (int)sizeof(runtimeValues));
+    printf("constexpr makeSineTable()   : 0 us at startup, %d bytes\n", (int)sizeof(waveValues));
+    printf("entries differing by more than 1 LSB: %d of %d\n", mismatches, SAMPLES_PER_CYCLE);
+}
@@ -0,0 +1,84 @@
+/**
+ * Benchmarks for the shared waveform libraries in ../lib
+ *
+ * Runs every benchmark once and prints the results. Builds for the ESP32
+ * (esp32dev env, results on the serial monitor) and for the host
+ * (native env, results on stdout).
+ *
+ * @file main.c
+ * @author Philip Giacalone
+ */
+
+#include <stdio.h>
+
+#include "bench.h"
+
+volatile int32_t bench_sink = 0;
+
+static void run_benchmarks(void) {
+    printf("\n=======================================================\n");
+    printf("Waveform benchmarks (%s)\n", BENCH_PLATFORM);
+    printf("=======================================================\n");
+
+    bench_dds();
+    bench_yield();
+    bench_envelope();
+    bench_yield();
+    bench_block_buffer();
+    bench_yield();
+    bench_wave_table();
+    bench_yield();
+    bench_fractional();
+    bench_yield();
+    bench_isr();
+    bench_yield();
+    bench_shapes();
+    bench_yield();
+    bench_rotor();
+    bench_yield();
+    bench_wave_cache();
+    bench_yield();
+    bench_sample_stream();
+    bench_yield();
+    bench_sweep();
+    bench_yield();
+    bench_noise();
+    bench_yield();
+    bench_upsample();
+    bench_yield();
+    bench_quantize();
+    bench_yield();
+    bench_modulation();
+    bench_yield();
+    bench_quarter();
+    bench_yield();
+    bench_hot_swap();
+    bench_yield();
+    bench_sequencer();
+    bench_yield();
+    bench_mipmap();
+    bench_yield();
+    bench_fast_trig();
+    bench_yield();
+    bench_time_base();
+    bench_yield();
+    bench_timer_trace();
+    bench_yield();
+    bench_cycle_probe();
+    bench_yield();
+
+    printf("=======================================================\n");
+}
+
+#ifdef ESP_PLATFORM
+void app_main(void)
+{
+    run_benchmarks();
+}
+#else
+int main(void)
+{
+    run_benchmarks();
+    return 0;
+}
+#endif
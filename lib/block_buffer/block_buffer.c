@@ -0,0 +1,56 @@
+/**
+ * Double-buffered (ping-pong) sample blocks. See block_buffer.h
+ *
+ * @file block_buffer.c
+ * @author Philip Giacalone
+ */
+
+#include "block_buffer.h"
+
+#include <string.h>
+
+void block_buffer_init(block_buffer_t *buffer, uint8_t initial_sample) {
+    memset(buffer, 0, sizeof(*buffer));
+    buffer->last_sample = initial_sample;
+    buffer->last_frame[0] = buffer->last_frame[1] = initial_sample;
+    buffer->stats.min_fill = UINT32_MAX;
+}
+
+uint8_t *block_buffer_acquire(block_buffer_t *buffer) {
+    uint32_t block = buffer->write_block;
+    if (__atomic_load_n(&buffer->ready[block], __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return buffer->blocks[block];
+}
+
+void block_buffer_commit(block_buffer_t *buffer) {
+    uint32_t block = buffer->write_block;
+    __atomic_store_n(&buffer->ready[block], 1, __ATOMIC_RELEASE);
+    buffer->write_block = block ^ 1;
+
+    // samples queued ahead of the consumer (a snapshot, the consumer keeps running)
+    uint32_t fill = 0;
+    for (int i = 0; i < 2; i++) {
+        if (__atomic_load_n(&buffer->ready[i], __ATOMIC_RELAXED)) {
+            fill += BLOCK_BUFFER_SAMPLES;
+        }
+    }
+    uint32_t read_index = __atomic_load_n(&buffer->read_index, __ATOMIC_RELAXED);
+    fill = fill > read_index ? fill - read_index : 0;
+
+    block_buffer_stats_t *stats = &buffer->stats;
+    if (fill < stats->min_fill) {
+        stats->min_fill = fill;
+    }
+    if (fill > stats->max_fill) {
+        stats->max_fill = fill;
+    }
+    stats->fill_sum += fill;
+    stats->fill_count++;
+}
+
+uint32_t block_buffer_mean_fill(const block_buffer_t *buffer) {
+    const block_buffer_stats_t *stats = &buffer->stats;
+    return stats->fill_count > 0 ? (uint32_t)(stats->fill_sum / stats->fill_count) : 0;
+}
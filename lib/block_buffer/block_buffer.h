@@ -0,0 +1,167 @@
+/**
+ * Double-buffered (ping-pong) sample blocks between a render task and the
+ * timer callback.
+ *
+ * The render task (producer) fills one block of BLOCK_BUFFER_SAMPLES 8-bit DAC
+ * values while the timer callback (consumer) plays the other one, so all of the
+ * waveform math moves out of the callback. The callback only reads the next
+ * byte, and when it finishes a block it hands the block back to the producer
+ * (block_buffer_read() returns true so the callback can notify the task).
+ *
+ * There are no locks. Each block has a "ready" flag that the producer sets
+ * (release) after filling the block and the consumer clears (release) after
+ * playing it. Every other field has a single writer.
+ *
+ * For two DAC channels the blocks hold interleaved frames (channel 1, channel
+ * 2, channel 1, ...), and the consumer reads a whole frame per call with
+ * block_buffer_read_frame().
+ *
+ * If the producer falls behind, the consumer repeats the last sample and
+ * counts an underrun. The producer records how far ahead of the consumer it
+ * is (the fill level) each time it commits a block.
+ *
+ * @file block_buffer.h
+ * @author Philip Giacalone
+ */
+
+#ifndef BLOCK_BUFFER_H
+#define BLOCK_BUFFER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef BLOCK_BUFFER_SAMPLES
+#define BLOCK_BUFFER_SAMPLES    256     // samples per block (N), even
+#endif
+
+typedef struct {
+    // --- written by the consumer (timer callback) ---
+    // number of times the consumer found no ready block
+    uint32_t underruns;
+    // number of blocks played to the end
+    uint32_t blocks_played;
+
+    // --- written by the producer (render task) ---
+    // samples queued ahead of the consumer when a block was committed
+    uint32_t min_fill;
+    uint32_t max_fill;
+    uint64_t fill_sum;
+    uint32_t fill_count;
+} block_buffer_stats_t;
+
+typedef struct {
+    uint8_t blocks[2][BLOCK_BUFFER_SAMPLES];
+    // 1 when the block has been rendered and not yet played
+    uint32_t ready[2];
+
+    // consumer state
+    uint32_t read_block;
+    uint32_t read_index;
+    uint8_t last_sample;
+    uint8_t last_frame[2];
+
+    // producer state
+    uint32_t write_block;
+
+    block_buffer_stats_t stats;
+} block_buffer_t;
+
+/**
+ * @brief Empties the buffer and resets the statistics
+ *
+ * @param initial_sample played until the first block is ready (e.g. mid-scale)
+ */
+void block_buffer_init(block_buffer_t *buffer, uint8_t initial_sample);
+
+/**
+ * @brief Producer: returns the next block to render into, or NULL if both
+ * blocks are full (wait for the consumer to release one).
+ */
+uint8_t *block_buffer_acquire(block_buffer_t *buffer);
+
+/**
+ * @brief Producer: marks the block returned by block_buffer_acquire() as ready
+ */
+void block_buffer_commit(block_buffer_t *buffer);
+
+/**
+ * @brief Producer (or any task): returns the mean fill level in samples
+ */
+uint32_t block_buffer_mean_fill(const block_buffer_t *buffer);
+
+/**
+ * @brief Consumer: gets the next sample to play
+ *
+ * Safe to call from an IRAM ISR (no locks, no floating point, always inlined).
+ *
+ * @param buffer the buffer to read from
+ * @param sample receives the next sample (the last one again on an underrun)
+ * @return true when a block was just released back to the producer
+ */
+ISR_INLINE bool block_buffer_read(block_buffer_t *buffer, uint8_t *sample) {
+    uint32_t block = buffer->read_block;
+    if (!__atomic_load_n(&buffer->ready[block], __ATOMIC_ACQUIRE)) {
+        buffer->stats.underruns++;
+        *sample = buffer->last_sample;
+        return false;
+    }
+
+    uint8_t value = buffer->blocks[block][buffer->read_index];
+    buffer->last_sample = value;
+    *sample = value;
+
+    if (++buffer->read_index < BLOCK_BUFFER_SAMPLES) {
+        return false;
+    }
+    // end of the block: give it back to the producer and move to the other one
+    buffer->read_index = 0;
+    buffer->read_block = block ^ 1;
+    buffer->stats.blocks_played++;
+    __atomic_store_n(&buffer->ready[block], 0, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * @brief Consumer: gets the next interleaved frame (two samples) to play
+ *
+ * The producer writes frames as pairs of samples (BLOCK_BUFFER_SAMPLES is
+ * even, so a frame never spans two blocks).
+ *
+ * @param first receives the frame's first sample (e.g. DAC_CHANNEL_1)
+ * @param second receives the frame's second sample (e.g. DAC_CHANNEL_2)
+ * @return true when a block was just released back to the producer
+ */
+ISR_INLINE bool block_buffer_read_frame(block_buffer_t *buffer, uint8_t *first, uint8_t *second) {
+    uint32_t block = buffer->read_block;
+    if (!__atomic_load_n(&buffer->ready[block], __ATOMIC_ACQUIRE)) {
+        buffer->stats.underruns++;
+        *first = buffer->last_frame[0];
+        *second = buffer->last_frame[1];
+        return false;
+    }
+
+    uint32_t index = buffer->read_index;
+    *first = buffer->last_frame[0] = buffer->blocks[block][index];
+    *second = buffer->last_frame[1] = buffer->blocks[block][index + 1];
+
+    if ((buffer->read_index = index + 2) < BLOCK_BUFFER_SAMPLES) {
+        return false;
+    }
+    buffer->read_index = 0;
+    buffer->read_block = block ^ 1;
+    buffer->stats.blocks_played++;
+    __atomic_store_n(&buffer->ready[block], 0, __ATOMIC_RELEASE);
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLOCK_BUFFER_H
@@ -0,0 +1,61 @@
+/**
+ * Cycle cost of each path through a timer callback. See cycle_probe.h
+ *
+ * @file cycle_probe.c
+ * @author Philip Giacalone
+ */
+
+#include "cycle_probe.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// empty probes measured by cycle_probe_init(), the cheapest one is the overhead
+#define CYCLE_PROBE_CALIBRATION 1000
+
+void cycle_probe_init(cycle_probe_table_t *table, const char *const names[], uint32_t count) {
+    memset(table, 0, sizeof(*table));
+    table->count = count < CYCLE_PROBE_MAX ? count : CYCLE_PROBE_MAX;
+    for (uint32_t i = 0; i < table->count; i++) {
+        table->probes[i].name = names[i];
+        isr_cycle_stats_reset(&table->probes[i].stats);
+    }
+
+    isr_cycle_stats_t empty;
+    isr_cycle_stats_reset(&empty);
+    for (int i = 0; i < CYCLE_PROBE_CALIBRATION; i++) {
+        uint32_t start = isr_cycle_count();
+        isr_cycle_stats_add(&empty, isr_cycle_count() - start);
+    }
+    table->overhead = empty.min;
+}
+
+void cycle_probe_take(cycle_probe_table_t *table, cycle_probe_table_t *snapshot) {
+    *snapshot = *table;
+    for (uint32_t i = 0; i < table->count; i++) {
+        isr_cycle_stats_reset(&table->probes[i].stats);
+    }
+}
+
+// cycles less the cost of the probe, at least 0
+static uint32_t less_overhead(uint32_t cycles, uint32_t overhead) {
+    return cycles > overhead ? cycles - overhead : 0;
+}
+
+int cycle_probe_format(const cycle_probe_table_t *table, uint32_t probe, uint32_t share_of, char *line,
+                       size_t size) {
+    const isr_cycle_stats_t *stats = &table->probes[probe].stats;
+    uint64_t calls = 0;
+    for (uint32_t i = 0; i < share_of && i < table->count; i++) {
+        calls += table->probes[i].stats.count;
+    }
+    double share = calls > 0 ? 100.0 * stats->count / calls : 0.0;
+    if (stats->count == 0) {
+        return snprintf(line, size, "%-18s %9u  %5.1f%%       -       -       -", table->probes[probe].name, 0U,
+                        share);
+    }
+    return snprintf(line, size, "%-18s %9u  %5.1f%% %7u %7u %7u", table->probes[probe].name,
+                    (unsigned)stats->count, share, (unsigned)less_overhead(stats->min, table->overhead),
+                    (unsigned)less_overhead(isr_cycle_stats_mean(stats), table->overhead),
+                    (unsigned)less_overhead(stats->max, table->overhead));
+}
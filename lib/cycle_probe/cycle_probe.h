@@ -0,0 +1,106 @@
+/**
+ * Opt-in cycle cost of each path through a timer callback.
+ *
+ * The callback's total (isr_cycle_stats_t) says how long it takes, not where
+ * the time goes. A probe is a pair of cycle counter reads around one path
+ * (e.g. the STATIC or the DYNAMIC branch of onTimer()) or one step of it
+ * (e.g. the DAC write), added to that path's row of a cycle_probe_table_t:
+ *
+ *      CYCLE_PROBE_BEGIN(dac);
+ *      isr_dac_write(DAC_CHANNEL_1, value);
+ *      CYCLE_PROBE_END(&probes, PROBE_DAC_WRITE, dac);
+ *
+ * A path can also be measured from a cycle count the callback already read,
+ * e.g. CYCLE_PROBE_END(&probes, PROBE_STATIC, startCycles) at its end.
+ *
+ * The cycles come from isr_cycle_count(): ccount on the ESP32, the TSC (or
+ * clock_gettime() nanoseconds) on the host, so the benchmarks print the same
+ * table for the same paths on a PC. cycle_probe_init() measures an empty probe
+ * and cycle_probe_format() takes that off, so the rows count the path itself.
+ * A probe nested inside another adds its own reads to the outer one.
+ *
+ * Everything compiles out unless the build defines CYCLE_PROBE_ENABLED=1
+ * (e.g. build_flags = -D CYCLE_PROBE_ENABLED=1): CYCLE_PROBE_BEGIN() and
+ * CYCLE_PROBE_END() are then empty.
+ *
+ * @file cycle_probe.h
+ * @author Philip Giacalone
+ */
+
+#ifndef CYCLE_PROBE_H
+#define CYCLE_PROBE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CYCLE_PROBE_ENABLED
+#define CYCLE_PROBE_ENABLED     0
+#endif
+
+#define CYCLE_PROBE_MAX         12
+// the column names of the rows from cycle_probe_format()
+#define CYCLE_PROBE_HEADER      "path                   calls   share     min    mean     max"
+
+typedef struct {
+    const char *name;
+    // written by the ISR
+    isr_cycle_stats_t stats;
+} cycle_probe_t;
+
+typedef struct {
+    cycle_probe_t probes[CYCLE_PROBE_MAX];
+    uint32_t count;
+    // cycles of an empty probe (two counter reads back to back)
+    uint32_t overhead;
+} cycle_probe_table_t;
+
+/**
+ * @brief Names the rows (probe i is names[i]), empties them and measures the
+ * cost of an empty probe. Call before the timer starts.
+ *
+ * @param count at most CYCLE_PROBE_MAX
+ */
+void cycle_probe_init(cycle_probe_table_t *table, const char *const names[], uint32_t count);
+
+/**
+ * @brief Copies the rows into snapshot and empties them, e.g. every few
+ * seconds in a task. A call the ISR makes meanwhile may go to either.
+ */
+void cycle_probe_take(cycle_probe_table_t *table, cycle_probe_table_t *snapshot);
+
+/**
+ * @brief Formats one row under CYCLE_PROBE_HEADER: the calls, their share of
+ * the calls of all the rows that are paths (share_of rows 0 to share_of - 1),
+ * and the min/mean/max cycles, less the cost of an empty probe
+ *
+ * @return the length of the line, as snprintf()
+ */
+int cycle_probe_format(const cycle_probe_table_t *table, uint32_t probe, uint32_t share_of, char *line,
+                       size_t size);
+
+/**
+ * @brief ISR: adds one measurement to a row
+ */
+ISR_INLINE void cycle_probe_add(cycle_probe_table_t *table, uint32_t probe, uint32_t cycles) {
+    isr_cycle_stats_add(&table->probes[probe].stats, cycles);
+}
+
+#if CYCLE_PROBE_ENABLED
+#define CYCLE_PROBE_BEGIN(start)            uint32_t start = isr_cycle_count()
+#define CYCLE_PROBE_END(table, probe, start) cycle_probe_add((table), (probe), isr_cycle_count() - (start))
+#else
+#define CYCLE_PROBE_BEGIN(start)            ((void)0)
+#define CYCLE_PROBE_END(table, probe, start) ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CYCLE_PROBE_H
@@ -0,0 +1,154 @@
+/**
+ * Direct digital synthesis (DDS) engine. See dds.h
+ *
+ * @file dds.c
+ * @author Philip Giacalone
+ */
+
+#include "dds.h"
+
+#include <math.h>
+
+#ifndef M_TWOPI
+#define M_TWOPI (2.0 * M_PI)
+#endif
+
+// 2^32, one full cycle of the phase accumulator
+#define DDS_PHASE_CYCLE     4294967296.0
+
+// read from interrupt handlers, so it must stay in DRAM
+ISR_DATA int16_t dds_sine_table[DDS_TABLE_SIZE];
+
+void dds_init(void) {
+    for (int i = 0; i < DDS_TABLE_SIZE; i++) {
+        double angle = M_TWOPI * i / DDS_TABLE_SIZE;
+        dds_sine_table[i] = (int16_t)lround(DDS_Q15_ONE * sin(angle));
+    }
+}
+
+uint32_t dds_phase_increment(double frequency, double sample_rate) {
+    if (sample_rate <= 0.0) {
+        return 0;
+    }
+    double cycles_per_sample = frequency / sample_rate;
+    // only the fractional part of a cycle matters (the accumulator wraps)
+    cycles_per_sample -= floor(cycles_per_sample);
+    return (uint32_t)llround(cycles_per_sample * DDS_PHASE_CYCLE);
+}
+
+double dds_frequency_actual(uint32_t phase_inc, double sample_rate) {
+    return phase_inc * sample_rate / DDS_PHASE_CYCLE;
+}
+
+double dds_frequency_error(double frequency, double sample_rate) {
+    return dds_frequency_actual(dds_phase_increment(frequency, sample_rate), sample_rate) - frequency;
+}
+
+double dds_frequency_resolution(double sample_rate) {
+    return sample_rate / DDS_PHASE_CYCLE;
+}
+
+uint32_t dds_phase_from_radians(double radians) {
+    double cycles = radians / M_TWOPI;
+    cycles -= floor(cycles);
+    return (uint32_t)llround(cycles * DDS_PHASE_CYCLE);
+}
+
+int32_t dds_q15(double value) {
+    long q = lround(value * DDS_Q15_ONE);
+    if (q > DDS_Q15_ONE) {
+        q = DDS_Q15_ONE;
+    } else if (q < -DDS_Q15_ONE) {
+        q = -DDS_Q15_ONE;
+    }
+    return (int32_t)q;
+}
+
+void dds_voice_init(dds_voice_t *voice, double frequency, double amplitude,
+                    double phase_angle, double y_offset, double sample_rate) {
+    voice->phase = dds_phase_from_radians(phase_angle);
+    voice->phase_inc = dds_phase_increment(frequency, sample_rate);
+    voice->amplitude = dds_q15(amplitude);
+    voice->y_offset = dds_q15(y_offset);
+    voice->mode = DDS_MODE_TABLE;
+}
+
+// converts a value between -1.0 and 1.0 into Q30
+static int32_t dds_q30(double value) {
+    return (int32_t)llround(value * DDS_ROTOR_ONE);
+}
+
+void dds_voice_set_mode(dds_voice_t *voice, dds_mode_t mode) {
+    voice->mode = mode;
+    if (mode != DDS_MODE_ROTOR) {
+        return;
+    }
+    double phase = M_TWOPI * voice->phase / DDS_PHASE_CYCLE;
+    double step = M_TWOPI * voice->phase_inc / DDS_PHASE_CYCLE;
+    // the block rotation is computed directly (not by repeating the step), so it has no accumulated error
+    double block = fmod(step * DDS_ROTOR_BLOCK, M_TWOPI);
+
+    voice->rotor_cos = voice->anchor_cos = dds_q30(cos(phase));
+    voice->rotor_sin = voice->anchor_sin = dds_q30(sin(phase));
+    voice->step_cos = dds_q30(cos(step));
+    voice->step_sin = dds_q30(sin(step));
+    voice->block_cos = dds_q30(cos(block));
+    voice->block_sin = dds_q30(sin(block));
+    voice->count = 0;
+}
+
+void dds_table_init(dds_table_player_t *player, const uint8_t *table, uint32_t bits,
+                    double frequency, double sample_rate) {
+    player->table = table;
+    player->bits = bits;
+    player->phase = 0;
+    player->phase_inc = dds_phase_increment(frequency, sample_rate);
+}
+
+void dds_quarter_init(dds_quarter_player_t *player, const void *table, uint32_t bits, int32_t middle,
+                      double frequency, double sample_rate) {
+    player->table = table;
+    player->bits = bits;
+    player->phase = 0;
+    player->phase_inc = dds_phase_increment(frequency, sample_rate);
+    player->middle = middle;
+}
+
+uint32_t dds_mipmap_entries(uint32_t bits, uint32_t level) {
+    // DDS_MIPMAP_ENTRIES_PER_HARMONIC x 2^(bits-1-level) harmonics, at most 2^bits
+    uint32_t shift = bits - 1 - level + DDS_MIPMAP_ENTRIES_BITS;
+    return shift < bits ? 1UL << shift : 1UL << bits;
+}
+
+void dds_mipmap_init(dds_mipmap_player_t *player, const uint8_t *tables, uint32_t bits,
+                     double frequency, double sample_rate) {
+    player->bits = bits;
+    for (uint32_t level = 0; level < bits; level++) {
+        uint32_t entries = dds_mipmap_entries(bits, level);
+        player->levels[level].table = tables;
+        player->levels[level].shift = 32 - (uint32_t)__builtin_ctz(entries);
+        tables += entries;
+    }
+    player->phase = 0;
+    player->phase_inc = dds_phase_increment(frequency, sample_rate);
+}
+
+void dds_mipmap_set_frequency(dds_mipmap_player_t *player, double frequency, double sample_rate) {
+    __atomic_store_n(&player->phase_inc, dds_phase_increment(frequency, sample_rate), __ATOMIC_RELEASE);
+}
+
+void dds_dual_init(dds_dual_player_t *player, const uint8_t *table, uint32_t bits,
+                   double frequency1, double frequency2, double phase_offset, double sample_rate) {
+    player->table = table;
+    player->bits = bits;
+    player->phase[0] = 0;
+    player->phase[1] = dds_phase_from_radians(phase_offset);
+    player->phase_inc[0] = dds_phase_increment(frequency1, sample_rate);
+    player->phase_inc[1] = dds_phase_increment(frequency2, sample_rate);
+}
+
+void dds_table_select(dds_table_player_t *player, const uint8_t *table,
+                      double frequency, double sample_rate) {
+    __atomic_store_n(&player->table, table, __ATOMIC_RELEASE);
+    __atomic_store_n(&player->phase_inc, dds_phase_increment(frequency, sample_rate), __ATOMIC_RELEASE);
+}
@@ -0,0 +1,467 @@
+/**
+ * Direct digital synthesis (DDS) engine.
+ *
+ * Each voice keeps a 32-bit phase accumulator. The full 32-bit range is one
+ * cycle of the waveform, so the accumulator wraps around for free when it
+ * overflows. The phase increment is computed once from the frequency:
+ *
+ *   phase_inc = frequency / sample_rate * 2^32
+ *
+ * after which every sample costs one addition and one table lookup
+ * (no sin(), no pow(), no time conversions). The top DDS_TABLE_BITS of the
+ * accumulator are used as the index into the sine table.
+ *
+ * Sample values are Q15 fixed point (32767 ~= 1.0).
+ *
+ * The phase increment is fractional (32 bits per cycle), so the frequency no
+ * longer has to divide the sample rate and one small table serves every
+ * frequency. The frequency resolution is sample_rate / 2^32 (about 42 µHz at
+ * 180,000 samples/sec). dds_frequency_actual() reports the frequency that a
+ * given increment really produces. Optional linear interpolation between
+ * table entries (dds_sine_interp(), dds_table_next_interp()) lowers the
+ * distortion of small tables.
+ *
+ * A dds_quarter_player_t plays a quarter-wave table: only the first quarter
+ * of a sine, square or triangle cycle (wave_table::makeQuarterCycle()). The
+ * second quarter is read backwards and the second half is subtracted from the
+ * midpoint, so a 1024 entry cycle takes 257 bytes (uint8_t) or 514 bytes
+ * (uint16_t, with 8 more bits that are rounded off) instead of 1024.
+ *
+ * A dds_mipmap_player_t plays a mipmap (wave_table::makeMipMap()): one
+ * table per octave of the phase increment, each with half the harmonics of
+ * the one below, so a square or sawtooth stays band-limited (does not alias)
+ * at any frequency. The level is picked every sample from the bit length of
+ * the phase increment (one count-leading-zeros), so a frequency change needs
+ * nothing but a new increment. Level 0 holds as many harmonics as its table
+ * can, level i has 2^(bits-1-i) harmonics. The levels shrink once they have
+ * more than 64 entries per harmonic (reading the nearest entry is then as
+ * clean as it is in level 0), so 10 levels of up to 1024 entries take 7104
+ * bytes.
+ *
+ * A dds_dual_player_t reads one table with two heads (e.g. one per DAC
+ * channel), each with its own phase increment. Both heads advance on the same
+ * call, so with equal frequencies their phase offset (e.g. 90 degrees for I/Q)
+ * stays exact forever.
+ *
+ * A voice can also run in DDS_MODE_ROTOR (dds_voice_set_mode()). Instead of
+ * the table lookup it rotates a (cos, sin) pair by the phase increment every
+ * sample (the coupled-form oscillator):
+ *
+ *   cos' = cos * cos(w) - sin * sin(w)
+ *   sin' = cos * sin(w) + sin * cos(w)
+ *
+ * which costs four multiplies, no trig and no table, and has no table
+ * quantization (phase jitter). Rounding would slowly change the radius and the
+ * phase, so every DDS_ROTOR_BLOCK samples the pair is reset from an "anchor"
+ * that is advanced by the exact block rotation (computed in double precision)
+ * and pulled back to a radius of 1.0 with a Newton step. The drift therefore
+ * never builds up over more than one block (the same idea as lib/envelope).
+ *
+ * The per-sample functions are integer only and always inlined (ISR_INLINE),
+ * and the sine table is in DRAM, so they can be called from an IRAM interrupt
+ * handler.
+ *
+ * This is plain C with no ESP-IDF or Arduino dependencies, so it also builds
+ * in a host `native` env (see ESP32_waveform_benchmarks).
+ *
+ * @file dds.h
+ * @author Philip Giacalone
+ */
+
+#ifndef DDS_H
+#define DDS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef DDS_TABLE_BITS
+#define DDS_TABLE_BITS      10      // 1024 entry sine table (2 KB)
+#endif
+
+#define DDS_TABLE_SIZE      (1 << DDS_TABLE_BITS)
+#define DDS_TABLE_SHIFT     (32 - DDS_TABLE_BITS)   // phase bits below the table index
+#define DDS_Q15_ONE         32767                   // 1.0 in Q15
+
+#ifndef DDS_ROTOR_BLOCK
+#define DDS_ROTOR_BLOCK     1024    // DDS_MODE_ROTOR: samples between renormalizations
+#endif
+
+#define DDS_ROTOR_ONE       (1L << 30)              // 1.0 in Q30 (the rotor's radius)
+
+// how a voice computes sin(phase)
+typedef enum {
+    DDS_MODE_TABLE = 0,     // sine table lookup (the default)
+    DDS_MODE_ROTOR          // coupled-form recurrence, no table
+} dds_mode_t;
+
+// one cycle of a sine wave in Q15, filled in by dds_init()
+extern int16_t dds_sine_table[DDS_TABLE_SIZE];
+
+// holds the state of one DDS voice
+// y = amplitude * (y_offset + sin(phase))
+typedef struct {
+    // current position within the cycle (2^32 == one full cycle)
+    uint32_t phase;
+    // added to the phase every sample. set from the frequency by dds_voice_init()
+    uint32_t phase_inc;
+    // amplitude in Q15 (0 to DDS_Q15_ONE)
+    int32_t amplitude;
+    // vertical offset in Q15. DDS_Q15_ONE keeps the output from going negative
+    int32_t y_offset;
+
+    dds_mode_t mode;
+    // --- DDS_MODE_ROTOR state, all Q30. set up by dds_voice_set_mode() ---
+    // (cos, sin) of the current phase
+    int32_t rotor_cos;
+    int32_t rotor_sin;
+    // (cos, sin) of the phase increment, applied every sample
+    int32_t step_cos;
+    int32_t step_sin;
+    // (cos, sin) at the start of the current block, and the rotation of a whole block
+    int32_t anchor_cos;
+    int32_t anchor_sin;
+    int32_t block_cos;
+    int32_t block_sin;
+    // samples since the start of the current block
+    uint32_t count;
+} dds_voice_t;
+
+// plays a table of 8-bit DAC values (one cycle, 2^bits entries) with a fractional phase increment
+typedef struct {
+    const uint8_t *table;
+    // log2 of the number of table entries (at most 24)
+    uint32_t bits;
+    uint32_t phase;
+    uint32_t phase_inc;
+} dds_table_player_t;
+
+#define DDS_QUARTER_FRACTION_BITS   8   // the bits below the DAC step in a uint16_t quarter table
+
+// plays a quarter-wave table: entries 0 to 2^(bits-2) of the first quarter of a cycle
+typedef struct {
+    const void *table;      // uint8_t or uint16_t entries (dds_quarter_next() or dds_quarter_next16())
+    // log2 of the number of entries of the whole cycle (at most 24)
+    uint32_t bits;
+    uint32_t phase;
+    uint32_t phase_inc;
+    // the value at the midpoint of the cycle, in the table's units
+    int32_t middle;
+} dds_quarter_player_t;
+
+#define DDS_MIPMAP_MAX_LEVELS   16      // the most levels (a 2^16 entry cycle)
+#define DDS_MIPMAP_ENTRIES_BITS 6       // a level has at most 2^6 = 64 entries per harmonic
+
+// one level of a mipmap: its table, and the phase bits below its index
+typedef struct {
+    const uint8_t *table;
+    uint32_t shift;
+} dds_mipmap_level_t;
+
+// plays a mipmap of 8-bit DAC values: the level is chosen by the phase increment
+typedef struct {
+    dds_mipmap_level_t levels[DDS_MIPMAP_MAX_LEVELS];
+    // the number of levels (log2 of the number of entries of level 0)
+    uint32_t bits;
+    uint32_t phase;
+    uint32_t phase_inc;
+} dds_mipmap_player_t;
+
+// plays one table with two read heads, e.g. DAC_CHANNEL_1 and DAC_CHANNEL_2
+typedef struct {
+    const uint8_t *table;
+    uint32_t bits;
+    uint32_t phase[2];
+    uint32_t phase_inc[2];
+} dds_dual_player_t;
+
+/**
+ * @brief Fills the sine table. Call once at startup, before any voice is used.
+ */
+void dds_init(void);
+
+/**
+ * @brief Converts a frequency into a 32-bit phase increment
+ *
+ * @param frequency the output frequency in Hz
+ * @param sample_rate the number of samples per second
+ * @return the value to add to the phase accumulator every sample
+ */
+uint32_t dds_phase_increment(double frequency, double sample_rate);
+
+/**
+ * @brief Returns the frequency (Hz) that a phase increment really produces
+ */
+double dds_frequency_actual(uint32_t phase_inc, double sample_rate);
+
+/**
+ * @brief Returns the actual minus the requested frequency (Hz) for a configuration
+ */
+double dds_frequency_error(double frequency, double sample_rate);
+
+/**
+ * @brief Returns the smallest possible frequency step (Hz) at a sample rate
+ */
+double dds_frequency_resolution(double sample_rate);
+
+/**
+ * @brief Converts a phase angle in radians to a 32-bit phase
+ */
+uint32_t dds_phase_from_radians(double radians);
+
+/**
+ * @brief Converts a value between -1.0 and 1.0 into Q15 (clamped)
+ */
+int32_t dds_q15(double value);
+
+/**
+ * @brief Sets up a voice. All of the floating point math happens here, once.
+ *
+ * @param voice the voice to initialize
+ * @param frequency in cycles/second
+ * @param amplitude between 0.0 and 1.0
+ * @param phase_angle in radians
+ * @param y_offset vertical offset (1.0 to avoid negative outputs)
+ * @param sample_rate the rate at which dds_voice_next() will be called
+ */
+void dds_voice_init(dds_voice_t *voice, double frequency, double amplitude,
+                    double phase_angle, double y_offset, double sample_rate);
+
+/**
+ * @brief Switches a voice between the sine table and the rotor
+ * (DDS_MODE_ROTOR). The rotor starts at the voice's current phase.
+ * Call after dds_voice_init().
+ */
+void dds_voice_set_mode(dds_voice_t *voice, dds_mode_t mode);
+
+/**
+ * @brief Looks up the sine of a 32-bit phase (Q15)
+ */
+ISR_INLINE int32_t dds_sine(uint32_t phase) {
+    return dds_sine_table[phase >> DDS_TABLE_SHIFT];
+}
+
+/**
+ * @brief Looks up the sine of a 32-bit phase (Q15), interpolating linearly
+ * between the two nearest table entries
+ */
+ISR_INLINE int32_t dds_sine_interp(uint32_t phase) {
+    uint32_t index = phase >> DDS_TABLE_SHIFT;
+    int32_t s0 = dds_sine_table[index];
+    int32_t s1 = dds_sine_table[(index + 1) & (DDS_TABLE_SIZE - 1)];
+    // the 15 phase bits just below the index
+    int32_t frac = (phase >> (DDS_TABLE_SHIFT - 15)) & 0x7FFF;
+    return s0 + (((s1 - s0) * frac) >> 15);
+}
+
+/**
+ * @brief Sets up a table player
+ *
+ * @param player the player to initialize
+ * @param table one cycle of the waveform, 2^bits entries
+ * @param bits log2 of the number of table entries
+ * @param frequency in cycles/second
+ * @param sample_rate the rate at which dds_table_next() will be called
+ */
+void dds_table_init(dds_table_player_t *player, const uint8_t *table, uint32_t bits,
+                    double frequency, double sample_rate);
+
+/**
+ * @brief Switches a player to another table (with the same number of entries)
+ * and frequency while it is playing. Call from a task, not from the ISR.
+ *
+ * The phase carries on, so the waveform stays continuous. The table and the
+ * increment are each stored atomically, so the ISR sees at most one sample
+ * with the new table at the old frequency.
+ */
+void dds_table_select(dds_table_player_t *player, const uint8_t *table,
+                      double frequency, double sample_rate);
+
+/**
+ * @brief Sets up a quarter-wave table player
+ *
+ * @param table the first quarter of the cycle, 2^(bits-2) + 1 uint8_t or uint16_t entries
+ * @param bits log2 of the number of entries of the whole cycle
+ * @param middle the value at the midpoint (wave_table::quarterMiddle())
+ * @param frequency in cycles/second
+ * @param sample_rate the rate at which dds_quarter_next() will be called
+ */
+void dds_quarter_init(dds_quarter_player_t *player, const void *table, uint32_t bits, int32_t middle,
+                      double frequency, double sample_rate);
+
+// the table entry of the current phase, reflected into the first quarter. *negative is set in the second half
+ISR_INLINE uint32_t dds_quarter_index_(const dds_quarter_player_t *player, bool *negative) {
+    uint32_t index = player->phase >> (32 - player->bits);
+    uint32_t quarter = 1UL << (player->bits - 2);
+    uint32_t offset = index & (quarter - 1);
+    *negative = (index & (quarter << 1)) != 0;
+    return (index & quarter) ? quarter - offset : offset;
+}
+
+/**
+ * @brief Returns the next value of a uint8_t quarter table and advances the phase
+ */
+ISR_INLINE uint8_t dds_quarter_next(dds_quarter_player_t *player) {
+    bool negative;
+    int32_t value = ((const uint8_t *)player->table)[dds_quarter_index_(player, &negative)];
+    player->phase += player->phase_inc;
+    return (uint8_t)(negative ? player->middle - value : player->middle + value);
+}
+
+/**
+ * @brief Returns the next value of a uint16_t quarter table, rounded to a DAC value, and advances the phase
+ */
+ISR_INLINE uint8_t dds_quarter_next16(dds_quarter_player_t *player) {
+    bool negative;
+    int32_t value = ((const uint16_t *)player->table)[dds_quarter_index_(player, &negative)];
+    player->phase += player->phase_inc;
+    value = negative ? player->middle - value : player->middle + value;
+    return (uint8_t)((value + (1 << (DDS_QUARTER_FRACTION_BITS - 1))) >> DDS_QUARTER_FRACTION_BITS);
+}
+
+/**
+ * @brief Returns the number of entries of a level of a mipmap
+ * (wave_table::mipMapEntries() builds the same layout)
+ *
+ * @param bits log2 of the number of entries of level 0
+ */
+uint32_t dds_mipmap_entries(uint32_t bits, uint32_t level);
+
+/**
+ * @brief Sets up a mipmap player
+ *
+ * @param tables the levels, one after another (wave_table::makeMipMap())
+ * @param bits log2 of the number of entries of level 0 (at most DDS_MIPMAP_MAX_LEVELS)
+ * @param frequency in cycles/second
+ * @param sample_rate the rate at which dds_mipmap_next() will be called
+ */
+void dds_mipmap_init(dds_mipmap_player_t *player, const uint8_t *tables, uint32_t bits,
+                     double frequency, double sample_rate);
+
+/**
+ * @brief Changes the frequency of a mipmap player while it plays. Call from a
+ * task. The increment is stored atomically, and the ISR picks the level for it.
+ */
+void dds_mipmap_set_frequency(dds_mipmap_player_t *player, double frequency, double sample_rate);
+
+/**
+ * @brief Returns the level for a phase increment: level i (i > 0) is used while the
+ * increment is below 2^(32-bits+i), so its 2^(bits-1-i) harmonics stay below Nyquist
+ */
+ISR_INLINE uint32_t dds_mipmap_level(const dds_mipmap_player_t *player, uint32_t phase_inc) {
+    // the bit length of the increment (| 1: __builtin_clz(0) is undefined)
+    uint32_t length = 32 - (uint32_t)__builtin_clz(phase_inc | 1);
+    uint32_t level = length > 32 - player->bits ? length - (32 - player->bits) : 0;
+    // increments of 2^31 and above are at or past Nyquist, play the fewest harmonics
+    return level < player->bits ? level : player->bits - 1;
+}
+
+/**
+ * @brief Returns the next value from the level of the current phase increment and advances the phase
+ */
+ISR_INLINE uint8_t dds_mipmap_next(dds_mipmap_player_t *player) {
+    const dds_mipmap_level_t *level = &player->levels[dds_mipmap_level(player, player->phase_inc)];
+    uint8_t value = level->table[player->phase >> level->shift];
+    player->phase += player->phase_inc;
+    return value;
+}
+
+/**
+ * @brief Sets up a dual player: one table, two read heads
+ *
+ * @param table one cycle of the waveform, 2^bits entries
+ * @param frequency1 of the first head, in cycles/second
+ * @param frequency2 of the second head, in cycles/second
+ * @param phase_offset radians that the second head starts ahead of the first (π/2 for I/Q)
+ * @param sample_rate the rate at which dds_dual_next() will be called
+ */
+void dds_dual_init(dds_dual_player_t *player, const uint8_t *table, uint32_t bits,
+                   double frequency1, double frequency2, double phase_offset, double sample_rate);
+
+/**
+ * @brief Returns the next value of each head (one frame) and advances both phases
+ */
+ISR_INLINE void dds_dual_next(dds_dual_player_t *player, uint8_t *value1, uint8_t *value2) {
+    uint32_t shift = 32 - player->bits;
+    *value1 = player->table[player->phase[0] >> shift];
+    *value2 = player->table[player->phase[1] >> shift];
+    player->phase[0] += player->phase_inc[0];
+    player->phase[1] += player->phase_inc[1];
+}
+
+/**
+ * @brief Returns the next table value and advances the phase
+ */
+ISR_INLINE uint8_t dds_table_next(dds_table_player_t *player) {
+    uint8_t value = player->table[player->phase >> (32 - player->bits)];
+    player->phase += player->phase_inc;
+    return value;
+}
+
+/**
+ * @brief Returns the next value, interpolated linearly between the two
+ * nearest table entries, and advances the phase
+ */
+ISR_INLINE uint8_t dds_table_next_interp(dds_table_player_t *player) {
+    uint32_t shift = 32 - player->bits;
+    uint32_t index = player->phase >> shift;
+    int32_t v0 = player->table[index];
+    int32_t v1 = player->table[(index + 1) & ((1UL << player->bits) - 1)];
+    // the 8 phase bits just below the index
+    int32_t frac = (player->phase >> (shift - 8)) & 0xFF;
+    player->phase += player->phase_inc;
+    return (uint8_t)(v0 + (((v1 - v0) * frac + 128) >> 8));
+}
+
+// rotates (c, s) by (rc, rs): returns the new cos, and the new sin in *s
+ISR_INLINE int32_t dds_rotate_(int32_t c, int32_t *s, int32_t rc, int32_t rs) {
+    int64_t next_cos = (int64_t)c * rc - (int64_t)*s * rs;
+    int64_t next_sin = (int64_t)c * rs + (int64_t)*s * rc;
+    *s = (int32_t)((next_sin + (1L << 29)) >> 30);
+    return (int32_t)((next_cos + (1L << 29)) >> 30);
+}
+
+// DDS_MODE_ROTOR: returns sin(phase) in Q15 and rotates to the next sample
+ISR_INLINE int32_t dds_rotor_next_(dds_voice_t *voice) {
+    int32_t sin_q30 = voice->rotor_sin;
+    if (++voice->count >= DDS_ROTOR_BLOCK) {
+        // advance the anchor by the exact block rotation
+        int32_t s = voice->anchor_sin;
+        int32_t c = dds_rotate_(voice->anchor_cos, &s, voice->block_cos, voice->block_sin);
+        // one Newton step towards a radius of 1.0: g = (3 - r^2) / 2
+        int64_t r2 = ((int64_t)c * c + (int64_t)s * s) >> 30;
+        int64_t g = (3 * (int64_t)DDS_ROTOR_ONE - r2) >> 1;
+        voice->anchor_cos = (int32_t)((c * g) >> 30);
+        voice->anchor_sin = (int32_t)((s * g) >> 30);
+        voice->rotor_cos = voice->anchor_cos;
+        voice->rotor_sin = voice->anchor_sin;
+        voice->count = 0;
+    } else {
+        voice->rotor_cos = dds_rotate_(voice->rotor_cos, &voice->rotor_sin, voice->step_cos, voice->step_sin);
+    }
+    // Q30 -> Q15, scaled by 32767/32768 so 1.0 becomes DDS_Q15_ONE
+    return (sin_q30 - (sin_q30 >> 15)) >> 15;
+}
+
+/**
+ * @brief Returns the voice's next sample and advances its phase.
+ *
+ * The result is amplitude * (y_offset + sin) in Q15, i.e. between 0 and
+ * 2 * DDS_Q15_ONE when y_offset is 1.0.
+ */
+ISR_INLINE int32_t dds_voice_next(dds_voice_t *voice) {
+    int32_t s = voice->mode == DDS_MODE_ROTOR ? dds_rotor_next_(voice) : dds_sine(voice->phase);
+    voice->phase += voice->phase_inc;
+    return (voice->amplitude * (voice->y_offset + s)) >> 15;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DDS_H
@@ -0,0 +1,64 @@
+/**
+ * Incremental ADSR envelopes. See envelope.h
+ *
+ * @file envelope.c
+ * @author Philip Giacalone
+ */
+
+#include "envelope.h"
+
+#include <math.h>
+
+// converts a value between 0.0 and 1.0 to Q30
+static uint32_t to_q30(double value) {
+    if (value <= 0.0) {
+        return 0;
+    }
+    if (value >= 1.0) {
+        return ENVELOPE_ONE;
+    }
+    return (uint32_t)llround(value * ENVELOPE_ONE);
+}
+
+void envelope_init(envelope_t *env, double attack_seconds, double decay_constant,
+                   double sustain_level, double release_constant, double sample_rate) {
+    double seconds_per_sample = 1.0 / sample_rate;
+    double seconds_per_block = seconds_per_sample * ENVELOPE_RENORM_SAMPLES;
+
+    double attack_samples = attack_seconds * sample_rate;
+    env->attack_step = attack_samples >= 1.0 ? to_q30(1.0 / attack_samples) : 0;
+    if (attack_samples >= 1.0 && env->attack_step == 0) {
+        env->attack_step = 1;   // very long attack, ramp as slowly as Q30 allows
+    }
+
+    // e^(-a * dt)
+    env->decay_mult = to_q30(exp(-decay_constant * seconds_per_sample));
+    env->decay_block_mult = to_q30(exp(-decay_constant * seconds_per_block));
+    env->sustain = to_q30(sustain_level);
+    env->release_mult = to_q30(exp(-release_constant * seconds_per_sample));
+    env->release_block_mult = to_q30(exp(-release_constant * seconds_per_block));
+
+    env->stage = ENVELOPE_IDLE;
+    env->level = 0;
+    env->distance = 0;
+    env->anchor = 0;
+    env->count = 0;
+}
+
+void envelope_trigger(envelope_t *env) {
+    env->count = 0;
+    if (env->attack_step == 0) {
+        // no attack, start the decay from the peak right away
+        env->level = ENVELOPE_ONE;
+        env->stage = ENVELOPE_DECAY;
+        env->distance = env->anchor = ENVELOPE_ONE - env->sustain;
+    } else {
+        env->stage = ENVELOPE_ATTACK;
+    }
+}
+
+void envelope_release(envelope_t *env) {
+    env->stage = ENVELOPE_RELEASE;
+    env->distance = env->anchor = env->level;
+    env->count = 0;
+}
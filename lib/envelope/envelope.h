@@ -0,0 +1,187 @@
+/**
+ * Incremental ADSR envelopes.
+ *
+ * Replaces the per-sample pow(M_E, -a * t) with a per-sample multiplier that
+ * is computed once from the decay constant:
+ *
+ *   e^(-a * (t + dt)) = e^(-a * t) * e^(-a * dt)
+ *
+ * so each sample costs one fixed point multiply. Levels are Q30
+ * (ENVELOPE_ONE == 1.0).
+ *
+ * Repeated multiplies accumulate rounding error, so every
+ * ENVELOPE_RENORM_SAMPLES samples the level is reset from an "anchor" that is
+ * advanced by a block multiplier (e^(-a * dt * ENVELOPE_RENORM_SAMPLES),
+ * computed in double precision). The drift therefore never builds up over
+ * more than one block.
+ *
+ * Stages:
+ *   attack  - linear ramp from the current level up to 1.0
+ *   decay   - exponential approach to the sustain level (decay constant a)
+ *   sustain - holds the sustain level until envelope_release() is called
+ *   release - exponential decay to 0.0 (release constant)
+ *
+ * The plain decaying wave y(t) = A * e^(-at) * sin(2πft + φ) is an envelope
+ * with no attack and a sustain level of 0.0.
+ *
+ * envelope_next() and envelope_apply() are integer only and always inlined,
+ * so they can be called from an IRAM interrupt handler.
+ *
+ * @file envelope.h
+ * @author Philip Giacalone
+ */
+
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <stdint.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ENVELOPE_ONE            (1UL << 30)     // 1.0 in Q30
+#define ENVELOPE_FLOOR          (1UL << 8)      // below this the stage is finished (~2.4e-7)
+
+#ifndef ENVELOPE_RENORM_SAMPLES
+#define ENVELOPE_RENORM_SAMPLES 4096            // samples between renormalizations
+#endif
+
+typedef enum {
+    ENVELOPE_IDLE = 0,
+    ENVELOPE_ATTACK,
+    ENVELOPE_DECAY,
+    ENVELOPE_SUSTAIN,
+    ENVELOPE_RELEASE
+} envelope_stage_t;
+
+typedef struct {
+    // --- settings, computed once by envelope_init() ---
+    // added to the level every sample during the attack
+    uint32_t attack_step;
+    // per-sample and per-block multipliers for the decay stage
+    uint32_t decay_mult;
+    uint32_t decay_block_mult;
+    // the level held during the sustain stage
+    uint32_t sustain;
+    // per-sample and per-block multipliers for the release stage
+    uint32_t release_mult;
+    uint32_t release_block_mult;
+
+    // --- state ---
+    envelope_stage_t stage;
+    // the current level (Q30)
+    uint32_t level;
+    // distance from the current level to the stage's target level
+    uint32_t distance;
+    // the exact distance at the start of the current renormalization block
+    uint32_t anchor;
+    // samples since the start of the current renormalization block
+    uint32_t count;
+} envelope_t;
+
+/**
+ * @brief Sets up an ADSR envelope. All of the floating point math happens here.
+ *
+ * The envelope is left idle (level 0.0) until envelope_trigger() is called.
+ *
+ * @param env the envelope to initialize
+ * @param attack_seconds time to ramp from 0.0 to 1.0 (0 for an instant start)
+ * @param decay_constant a, in e^(-at), of the decay towards the sustain level
+ * @param sustain_level between 0.0 and 1.0
+ * @param release_constant a, in e^(-at), of the release towards 0.0
+ * @param sample_rate the rate at which envelope_next() will be called
+ */
+void envelope_init(envelope_t *env, double attack_seconds, double decay_constant,
+                   double sustain_level, double release_constant, double sample_rate);
+
+/**
+ * @brief Starts (or restarts) the attack stage from the current level
+ */
+void envelope_trigger(envelope_t *env);
+
+/**
+ * @brief Starts the release stage from the current level
+ */
+void envelope_release(envelope_t *env);
+
+/**
+ * @brief Returns the current level as a float between 0.0 and 1.0
+ */
+static inline float envelope_level(const envelope_t *env) {
+    return env->level * (1.0f / ENVELOPE_ONE);
+}
+
+// Q30 multiply, rounded
+ISR_INLINE uint32_t envelope_mul_(uint32_t a, uint32_t b) {
+    return (uint32_t)(((uint64_t)a * b + (ENVELOPE_ONE >> 1)) >> 30);
+}
+
+// one step of an exponential stage. returns the new distance to the target
+ISR_INLINE uint32_t envelope_step_(envelope_t *env, uint32_t mult, uint32_t block_mult) {
+    if (++env->count >= ENVELOPE_RENORM_SAMPLES) {
+        env->count = 0;
+        env->anchor = envelope_mul_(env->anchor, block_mult);
+        env->distance = env->anchor;
+    } else {
+        env->distance = envelope_mul_(env->distance, mult);
+    }
+    return env->distance;
+}
+
+/**
+ * @brief Advances the envelope by one sample and returns the new level (Q30)
+ *
+ * Costs one add (attack) or one multiply (decay, release) per sample.
+ */
+ISR_INLINE uint32_t envelope_next(envelope_t *env) {
+    switch (env->stage) {
+        case ENVELOPE_ATTACK:
+            if (env->level >= ENVELOPE_ONE - env->attack_step) {
+                env->level = ENVELOPE_ONE;
+                env->stage = ENVELOPE_DECAY;
+                env->distance = env->anchor = ENVELOPE_ONE - env->sustain;
+                env->count = 0;
+            } else {
+                env->level += env->attack_step;
+            }
+            break;
+        case ENVELOPE_DECAY:
+            if (envelope_step_(env, env->decay_mult, env->decay_block_mult) < ENVELOPE_FLOOR) {
+                env->stage = ENVELOPE_SUSTAIN;
+                env->level = env->sustain;
+            } else {
+                env->level = env->sustain + env->distance;
+            }
+            break;
+        case ENVELOPE_RELEASE:
+            if (envelope_step_(env, env->release_mult, env->release_block_mult) < ENVELOPE_FLOOR) {
+                env->stage = ENVELOPE_IDLE;
+                env->level = 0;
+            } else {
+                env->level = env->distance;
+            }
+            break;
+        default:
+            // idle and sustain hold their level
+            break;
+    }
+    return env->level;
+}
+
+/**
+ * @brief Advances the envelope and applies it to a (Q15) sample
+ */
+ISR_INLINE int32_t envelope_apply(envelope_t *env, int32_t sample) {
+    // 32 x 32 -> 64 bit multiply (the level is at most 2^30, so it fits in an int32_t)
+    int32_t level = (int32_t)envelope_next(env);
+    return (int32_t)(((int64_t)sample * level) >> 30);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENVELOPE_H
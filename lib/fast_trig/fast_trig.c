@@ -0,0 +1,46 @@
+/**
+ * Fast sine and cosine in tiers. See fast_trig.h
+ *
+ * @file fast_trig.c
+ * @author Philip Giacalone
+ */
+
+#include "fast_trig.h"
+
+#include <math.h>
+
+#ifndef M_TWOPI
+#define M_TWOPI (2.0 * M_PI)
+#endif
+
+// 2^32, one full cycle of the phase
+#define FAST_TRIG_PHASE_CYCLE   4294967296.0
+
+// the table and rounding errors added up, checked by ESP32_waveform_benchmarks (bench_fast_trig.c)
+const fast_trig_tier_info_t fast_trig_tiers[FAST_TRIG_TIERS] = {
+    {"lut", 3.1e-3, sizeof(fast_trig_table)},
+    {"lut interp", 3.5e-5, sizeof(fast_trig_table)},
+    {"poly", 1.6e-5, 0},
+    {"cordic", 5.0e-5, sizeof(fast_trig_cordic_angles)},
+};
+
+// read from interrupt handlers, so they must stay in DRAM
+ISR_DATA int16_t fast_trig_table[FAST_TRIG_TABLE_SIZE + 1];
+
+ISR_DATA const int32_t fast_trig_cordic_angles[FAST_TRIG_CORDIC_ANGLES] = {
+    536870912, 316933406, 167458907, 85004756, 42667331, 21354465, 10679838, 5340245,
+    2670163, 1335087, 667544, 333772, 166886, 83443, 41722, 20861,
+    10430, 5215, 2608, 1304, 652, 326, 163, 81,
+};
+
+void fast_trig_init(void) {
+    for (int i = 0; i <= FAST_TRIG_TABLE_SIZE; i++) {
+        double angle = M_TWOPI * i / FAST_TRIG_TABLE_SIZE;
+        fast_trig_table[i] = (int16_t)lround(FAST_TRIG_ONE * sin(angle));
+    }
+}
+
+uint32_t fast_trig_phase(double radians) {
+    // the 64-bit integer wraps into one cycle when it is cut to 32 bits
+    return (uint32_t)llround(radians * (FAST_TRIG_PHASE_CYCLE / M_TWOPI));
+}
@@ -0,0 +1,222 @@
+/**
+ * Fast sine and cosine of a 32-bit phase, in four tiers of speed, accuracy
+ * and memory. It replaces the FastTrig library (isin()), which the projects
+ * used to pull from GitHub, and libm sin() in the per-sample code.
+ *
+ * The phase is the one of lib/dds: the full 32-bit range is one cycle
+ * (2^32 = 2π), so it wraps around for free. fast_trig_phase() converts
+ * radians. The result is Q15 (DDS_Q15_ONE = 32767 ~= 1.0), like dds_sine().
+ *
+ *   tier                   max error   memory   cycles (x86 host)   how
+ *   FAST_TRIG_LUT          3.1e-3      2 KB       2                 the nearest entry of a 1024 entry table
+ *   FAST_TRIG_LUT_INTERP   3.5e-5      2 KB       5                 linear interpolation between two entries
+ *   FAST_TRIG_POLY         1.6e-5      -          9                 degree 7 minimax polynomial (4 multiplies)
+ *   FAST_TRIG_CORDIC       5.0e-5      96 B      65                 16 shift-and-add rotations, sin and cos at once
+ *
+ * The max error is against sin() over the whole cycle, in units of 1.0 (one
+ * Q15 step is 3.1e-5, so the last three tiers are within about a step). For
+ * comparison, on the same host libm sin() takes 25 cycles, sinf() 16 and
+ * FastTrig's isin() 21 (with a max error of 1.9e-4). The max errors are also
+ * published at run time in fast_trig_tiers[], and checked by
+ * ESP32_waveform_benchmarks (bench_fast_trig.c), which measures all of them
+ * on the board too, where the double math of sin() is done in software.
+ *
+ * The table is filled by fast_trig_init(). The polynomial needs no table,
+ * and the CORDIC angles are constants. Everything is integer math, always
+ * inlined (ISR_INLINE) and reads only DRAM, so it can be called from an IRAM
+ * interrupt handler.
+ *
+ * This is plain C with no ESP-IDF or Arduino dependencies, so it also builds
+ * in a host `native` env (see ESP32_waveform_benchmarks).
+ *
+ * @file fast_trig.h
+ * @author Philip Giacalone
+ */
+
+#ifndef FAST_TRIG_H
+#define FAST_TRIG_H
+
+#include <stdint.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FAST_TRIG_TABLE_BITS    10      // 1024 entry sine table (2 KB)
+#define FAST_TRIG_TABLE_SIZE    (1 << FAST_TRIG_TABLE_BITS)
+#define FAST_TRIG_TABLE_SHIFT   (32 - FAST_TRIG_TABLE_BITS)    // phase bits below the table index
+#define FAST_TRIG_ONE           32767                           // 1.0 in Q15 (DDS_Q15_ONE)
+#define FAST_TRIG_QUARTER       0x40000000U                     // 90 degrees of phase
+
+#define FAST_TRIG_CORDIC_ANGLES 24
+
+#ifndef FAST_TRIG_CORDIC_ITERATIONS
+#define FAST_TRIG_CORDIC_ITERATIONS 16  // each one adds about a bit
+#endif
+#if FAST_TRIG_CORDIC_ITERATIONS > FAST_TRIG_CORDIC_ANGLES
+#error "FAST_TRIG_CORDIC_ITERATIONS is more than FAST_TRIG_CORDIC_ANGLES"
+#endif
+
+typedef enum {
+    FAST_TRIG_LUT = 0,
+    FAST_TRIG_LUT_INTERP,
+    FAST_TRIG_POLY,
+    FAST_TRIG_CORDIC,
+    FAST_TRIG_TIERS
+} fast_trig_tier_t;
+
+typedef struct {
+    const char *name;
+    // the largest difference from sin() over the whole cycle (1.0 = full scale)
+    double max_error;
+    // bytes of tables that the tier reads
+    uint32_t bytes;
+} fast_trig_tier_info_t;
+
+extern const fast_trig_tier_info_t fast_trig_tiers[FAST_TRIG_TIERS];
+
+// one cycle of a sine wave in Q15, plus the first entry again at the end. filled in by fast_trig_init()
+extern int16_t fast_trig_table[FAST_TRIG_TABLE_SIZE + 1];
+
+// atan(2^-i) in phase units (2^32 per cycle)
+extern const int32_t fast_trig_cordic_angles[FAST_TRIG_CORDIC_ANGLES];
+
+/**
+ * @brief Fills the sine table of FAST_TRIG_LUT and FAST_TRIG_LUT_INTERP.
+ * Call once at startup, before they are used.
+ */
+void fast_trig_init(void);
+
+/**
+ * @brief Converts an angle in radians (either sign, up to about 10^10) into
+ * a 32-bit phase. Uses double math, so not from an ISR.
+ */
+uint32_t fast_trig_phase(double radians);
+
+/**
+ * @brief FAST_TRIG_LUT: the sine of a phase (Q15), from the nearest table entry
+ */
+ISR_INLINE int32_t fast_trig_sin_lut(uint32_t phase) {
+    // rounds to the nearest entry. the add wraps, so the last half step reads entry 0
+    return fast_trig_table[(phase + (1U << (FAST_TRIG_TABLE_SHIFT - 1))) >> FAST_TRIG_TABLE_SHIFT];
+}
+
+/**
+ * @brief FAST_TRIG_LUT_INTERP: the sine of a phase (Q15), interpolating
+ * linearly between the two nearest table entries
+ */
+ISR_INLINE int32_t fast_trig_sin_lut_interp(uint32_t phase) {
+    uint32_t index = phase >> FAST_TRIG_TABLE_SHIFT;
+    int32_t s0 = fast_trig_table[index];
+    int32_t s1 = fast_trig_table[index + 1];
+    // the 15 phase bits just below the index
+    int32_t frac = (phase >> (FAST_TRIG_TABLE_SHIFT - 15)) & 0x7FFF;
+    return s0 + (((s1 - s0) * frac + (1 << 14)) >> 15);
+}
+
+// folds the second and third quarters onto the first and fourth (sin(π - a) = sin(a)).
+// returns the angle in Q30, where 1 << 30 is π/2
+ISR_INLINE int32_t fast_trig_fold_(uint32_t phase) {
+    if ((phase + FAST_TRIG_QUARTER) & 0x80000000U) {
+        phase = 0x80000000U - phase;
+    }
+    return (int32_t)phase;
+}
+
+/**
+ * @brief FAST_TRIG_POLY: the sine of a phase (Q15), from a degree 7 minimax
+ * polynomial of the angle folded into -90 to 90 degrees
+ */
+ISR_INLINE int32_t fast_trig_sin_poly(uint32_t phase) {
+    // sin(π/2 z) = z (c1 + z^2 (c3 + z^2 (c5 + z^2 c7))) within 5.9e-7 for z in [-1, 1].
+    // Q30, scaled by 32767/32768 so 1.0 becomes FAST_TRIG_ONE
+    const int32_t c1 = 1686572534;
+    const int32_t c3 = -693501002;
+    const int32_t c5 = 85289375;
+    const int32_t c7 = -4652484;
+
+    int32_t z = fast_trig_fold_(phase);
+    int32_t z2 = (int32_t)(((int64_t)z * z) >> 30);
+    int32_t r = c5 + (int32_t)(((int64_t)c7 * z2) >> 30);
+    r = c3 + (int32_t)(((int64_t)r * z2) >> 30);
+    r = c1 + (int32_t)(((int64_t)r * z2) >> 30);
+    int32_t s = (int32_t)(((int64_t)r * z) >> 30);
+    return (s + (1 << 14)) >> 15;
+}
+
+/**
+ * @brief FAST_TRIG_CORDIC: the sine and cosine of a phase (Q15) with
+ * FAST_TRIG_CORDIC_ITERATIONS shift-and-add rotations (no multiplies)
+ *
+ * @param cos returns the cosine
+ * @return the sine
+ */
+ISR_INLINE int32_t fast_trig_sin_cos_cordic(uint32_t phase, int32_t *cos) {
+    // 1 / the gain of the rotations (0.607252935) in Q30, scaled by 32767/32768
+    int32_t x = 652012976;
+    int32_t y = 0;
+    // folding the second and third quarters flips the cosine
+    uint32_t flip = (phase + FAST_TRIG_QUARTER) & 0x80000000U;
+    int32_t z = fast_trig_fold_(phase);
+
+    for (int i = 0; i < FAST_TRIG_CORDIC_ITERATIONS; i++) {
+        int32_t dx = y >> i;
+        int32_t dy = x >> i;
+        if (z >= 0) {
+            x -= dx;
+            y += dy;
+            z -= fast_trig_cordic_angles[i];
+        } else {
+            x += dx;
+            y -= dy;
+            z += fast_trig_cordic_angles[i];
+        }
+    }
+    x = (x + (1 << 14)) >> 15;
+    *cos = flip ? -x : x;
+    return (y + (1 << 14)) >> 15;
+}
+
+/**
+ * @brief FAST_TRIG_CORDIC: the sine of a phase (Q15)
+ */
+ISR_INLINE int32_t fast_trig_sin_cordic(uint32_t phase) {
+    int32_t cos;
+    return fast_trig_sin_cos_cordic(phase, &cos);
+}
+
+/**
+ * @brief The sine of a phase (Q15) with the given tier. With a constant
+ * tier the choice is made at compile time.
+ */
+ISR_INLINE int32_t fast_trig_sin(fast_trig_tier_t tier, uint32_t phase) {
+    switch (tier) {
+        case FAST_TRIG_LUT: return fast_trig_sin_lut(phase);
+        case FAST_TRIG_LUT_INTERP: return fast_trig_sin_lut_interp(phase);
+        case FAST_TRIG_POLY: return fast_trig_sin_poly(phase);
+        default: return fast_trig_sin_cordic(phase);
+    }
+}
+
+/**
+ * @brief The cosine of a phase (Q15) with the given tier
+ */
+ISR_INLINE int32_t fast_trig_cos(fast_trig_tier_t tier, uint32_t phase) {
+    return fast_trig_sin(tier, phase + FAST_TRIG_QUARTER);
+}
+
+/**
+ * @brief sin(radians) with the given tier, for code that works in radians
+ * and floats (not from an ISR)
+ */
+static inline float fast_trig_sin_radians(fast_trig_tier_t tier, double radians) {
+    return fast_trig_sin(tier, fast_trig_phase(radians)) * (1.0f / FAST_TRIG_ONE);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FAST_TRIG_H
@@ -0,0 +1,28 @@
+/**
+ * Lock-free hot swap of a table between a control task and the timer ISR. See hot_swap.h
+ *
+ * @file hot_swap.c
+ * @author Philip Giacalone
+ */
+
+#include "hot_swap.h"
+
+void hot_swap_init(hot_swap_t *swap, void *slot0, void *slot1, void *slot2) {
+    swap->slots[0] = slot0;
+    swap->slots[1] = slot1;
+    swap->slots[2] = slot2;
+    swap->front = 0;
+    swap->middle = 1;
+    swap->back = 2;
+    swap->published = 0;
+    swap->taken = 0;
+    swap->retries = 0;
+}
+
+void hot_swap_publish(hot_swap_t *swap) {
+    // release: the back slot is completely written before the ISR can take it.
+    // acquire: the ISR is done with the slot it handed back
+    uint32_t old = __atomic_exchange_n(&swap->middle, swap->back | HOT_SWAP_FRESH, __ATOMIC_ACQ_REL);
+    swap->back = old & HOT_SWAP_INDEX;
+    swap->published++;
+}
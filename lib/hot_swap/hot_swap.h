@@ -0,0 +1,124 @@
+/**
+ * Lock-free hot swap of a table (or any block of data) that the timer ISR is
+ * playing, from a control task (loop()): a triple buffer.
+ *
+ * There are three slots. At any time one of them is the ISR's (front), one
+ * is the control task's (back) and one is in the middle, holding the latest
+ * table published. Neither side ever touches the other's slot:
+ *
+ *  - the control task fills the back slot, then hot_swap_publish() exchanges
+ *    it with the middle one (one atomic exchange) and marks the middle fresh.
+ *    It never waits for the ISR: if the ISR has not taken the previous table
+ *    yet, that table simply becomes the new back slot (the newest wins).
+ *  - the ISR calls hot_swap_take() where a swap cannot be heard (e.g. at a
+ *    cycle boundary). If the middle is fresh, it exchanges it with its front
+ *    slot with one compare-and-set. The compare-and-set is tried once: if the
+ *    control task published in between, the ISR keeps its table and takes the
+ *    newer one at its next call. So the ISR is wait-free (a bounded number of
+ *    instructions, no loop, no critical section).
+ *
+ * The slots are read and written with plain loads and stores. The middle
+ * index is released by the side that hands a slot over and acquired by the
+ * side that gets it, so a table is always seen completely written.
+ *
+ * @file hot_swap.h
+ * @author Philip Giacalone
+ */
+
+#ifndef HOT_SWAP_H
+#define HOT_SWAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HOT_SWAP_SLOTS      3
+#define HOT_SWAP_INDEX      0x3U    // the slot index in middle
+#define HOT_SWAP_FRESH      0x4U    // set in middle from a publish until the ISR takes it
+
+typedef struct {
+    void *slots[HOT_SWAP_SLOTS];
+
+    // the slot index of each side. front is only used by the ISR, back only by the control task
+    uint32_t front;
+    uint32_t back;
+    // the slot in the middle, and HOT_SWAP_FRESH. Exchanged atomically by both sides
+    uint32_t middle;
+
+    // --- written by the control task ---
+    uint32_t published;
+    // --- written by the ISR ---
+    uint32_t taken;
+    // compare-and-sets lost to a publish (the table was taken at the next call)
+    uint32_t retries;
+} hot_swap_t;
+
+/**
+ * @brief Sets up the slots. slot0 is the ISR's first table, so it must be
+ * filled in before the ISR starts. slot1 and slot2 must be the same size.
+ */
+void hot_swap_init(hot_swap_t *swap, void *slot0, void *slot1, void *slot2);
+
+/**
+ * @brief Control task: returns the slot to fill in before the next hot_swap_publish().
+ * It is not the ISR's, and the ISR will not read it until it is published.
+ */
+static inline void *hot_swap_back(hot_swap_t *swap) {
+    return swap->slots[swap->back];
+}
+
+/**
+ * @brief Control task: hands the back slot to the ISR. Never waits.
+ * The next hot_swap_back() is another slot.
+ */
+void hot_swap_publish(hot_swap_t *swap);
+
+/**
+ * @brief Control task: returns the number of tables published but never taken by the ISR
+ * (replaced by a newer one first)
+ */
+static inline uint32_t hot_swap_superseded(const hot_swap_t *swap) {
+    uint32_t taken = __atomic_load_n(&swap->taken, __ATOMIC_RELAXED);
+    uint32_t pending = (__atomic_load_n(&swap->middle, __ATOMIC_RELAXED) & HOT_SWAP_FRESH) ? 1 : 0;
+    return swap->published - taken - pending;
+}
+
+/**
+ * @brief ISR: returns the table the ISR plays
+ */
+ISR_INLINE void *hot_swap_front(const hot_swap_t *swap) {
+    return swap->slots[swap->front];
+}
+
+/**
+ * @brief ISR: takes the latest published table, if there is a new one.
+ * Wait-free: one load, and at most one compare-and-set.
+ *
+ * @return true if hot_swap_front() is now a new table
+ */
+ISR_INLINE bool hot_swap_take(hot_swap_t *swap) {
+    uint32_t middle = __atomic_load_n(&swap->middle, __ATOMIC_RELAXED);
+    if ((middle & HOT_SWAP_FRESH) == 0) {
+        return false;
+    }
+    // hand the old front back, take the fresh slot. Acquire pairs with the publish's release
+    if (!__atomic_compare_exchange_n(&swap->middle, &middle, swap->front, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        swap->retries++;
+        return false;
+    }
+    swap->front = middle & HOT_SWAP_INDEX;
+    __atomic_store_n(&swap->taken, swap->taken + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOT_SWAP_H
@@ -0,0 +1,122 @@
+/**
+ * Helpers for code that runs inside timer interrupts.
+ *
+ * An ESP32 interrupt handler should be in IRAM (IRAM_ATTR), and so should
+ * everything it calls, and everything it reads should be in DRAM. Otherwise it
+ * can crash while the flash cache is disabled (e.g. during a flash write) or
+ * stall on a cache miss. The FPU context is also not saved for interrupts, so
+ * the handler should use integer (fixed point) math only.
+ *
+ * ISR_CODE / ISR_DATA   place a function / variable in IRAM / DRAM on the ESP32
+ * ISR_INLINE            forces inlining, so an inline helper called from an IRAM
+ *                       handler is never emitted as an out-of-line copy in flash
+ * isr_cycle_count()     the CPU cycle counter (ccount on the ESP32, the TSC or
+ *                       a nanosecond clock on the host)
+ * isr_cycle_stats_t     min/mean/max cycles of a callback, updated from the ISR
+ * isr_dac_write()       writes an 8-bit DAC channel directly (IRAM safe,
+ *                       unlike dac_output_voltage() which lives in flash)
+ * isr_timer_alarm_write() sets the alarm of a hardware timer from its own
+ *                       callback (IRAM safe, unlike timerAlarmWrite())
+ *
+ * @file isr_safe.h
+ * @author Philip Giacalone
+ */
+
+#ifndef ISR_SAFE_H
+#define ISR_SAFE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ISR_INLINE      static inline __attribute__((always_inline))
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "xtensa/core-macros.h"
+#include "hal/dac_ll.h"
+#include "hal/timer_ll.h"
+
+#define ISR_CODE        IRAM_ATTR
+#define ISR_DATA        DRAM_ATTR
+
+ISR_INLINE uint32_t isr_cycle_count(void) {
+    return XTHAL_GET_CCOUNT();
+}
+
+/**
+ * @brief Writes a value to a DAC channel (DAC_CHANNEL_1 or DAC_CHANNEL_2).
+ * Call dac_output_enable() for the channel once, before the timer starts.
+ */
+ISR_INLINE void isr_dac_write(dac_channel_t channel, uint8_t value) {
+    dac_ll_update_output_value(channel, value);
+}
+
+/**
+ * @brief Sets the alarm (the period, with auto reload) of timer index of a
+ * timer group. From the timer's callback, it takes effect at the next period.
+ */
+ISR_INLINE void isr_timer_alarm_write(uint32_t group, uint32_t index, uint64_t ticks) {
+    timer_ll_set_alarm_value(TIMER_LL_GET_HW(group), (timer_idx_t)index, ticks);
+}
+#else
+#define ISR_CODE
+#define ISR_DATA
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+
+ISR_INLINE uint32_t isr_cycle_count(void) {
+    return (uint32_t)__rdtsc();
+}
+#else
+#include <time.h>
+
+ISR_INLINE uint32_t isr_cycle_count(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+#endif
+#endif
+
+typedef struct {
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t count;
+} isr_cycle_stats_t;
+
+ISR_INLINE void isr_cycle_stats_reset(isr_cycle_stats_t *stats) {
+    stats->min = UINT32_MAX;
+    stats->max = 0;
+    stats->total = 0;
+    stats->count = 0;
+}
+
+/**
+ * @brief Adds one measurement, e.g. isr_cycle_count() at the end of the
+ * callback minus isr_cycle_count() at its start.
+ */
+ISR_INLINE void isr_cycle_stats_add(isr_cycle_stats_t *stats, uint32_t cycles) {
+    if (cycles < stats->min) {
+        stats->min = cycles;
+    }
+    if (cycles > stats->max) {
+        stats->max = cycles;
+    }
+    stats->total += cycles;
+    stats->count++;
+}
+
+ISR_INLINE uint32_t isr_cycle_stats_mean(const isr_cycle_stats_t *stats) {
+    return stats->count > 0 ? (uint32_t)(stats->total / stats->count) : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ISR_SAFE_H
@@ -0,0 +1,37 @@
+/**
+ * AM, FM and PM between DDS voices. See modulation.h
+ *
+ * @file modulation.c
+ * @author Philip Giacalone
+ */
+
+#include "modulation.h"
+
+#include <math.h>
+
+void modulation_route_init(modulation_route_t *route, modulation_type_t type, uint32_t target,
+                           double depth, double sample_rate) {
+    route->type = type;
+    route->target = target;
+    switch (type) {
+        case MODULATION_AM:
+            route->depth = dds_q15(depth);
+            break;
+        case MODULATION_FM: {
+            // a signed phase increment, so the deviation can be up to sample_rate / 2 (just below, in Q32)
+            double increment = depth / sample_rate * 4294967296.0;
+            route->depth = increment >= 2147483647.0 ? INT32_MAX
+                         : increment <= -2147483648.0 ? INT32_MIN : (int32_t)lround(increment);
+            break;
+        }
+        case MODULATION_PM: {
+            double phase = depth / (2.0 * M_PI) * 4294967296.0;
+            route->depth = phase >= 2147483647.0 ? INT32_MAX
+                         : phase <= -2147483648.0 ? INT32_MIN : (int32_t)lround(phase);
+            break;
+        }
+        default:
+            route->depth = 0;
+            break;
+    }
+}
@@ -0,0 +1,129 @@
+/**
+ * AM, FM and PM between DDS voices: one voice (the modulator) changes the
+ * amplitude, frequency or phase of another (the carrier), every sample.
+ *
+ * A modulator's output is not mixed into the waveform. It is a bipolar Q15
+ * value m (-1.0 to 1.0: a voice with a y_offset of 0.0, usually through an
+ * envelope) that its route turns into an input of the carrier:
+ *
+ *  MODULATION_AM - amplitude * (1 + depth m)     depth 0.0 to 1.0
+ *  MODULATION_FM - frequency + depth m           depth in Hz (the peak deviation)
+ *  MODULATION_PM - phase + depth m               depth in radians, at most π
+ *
+ * All three are integer adds and one multiply per sample:
+ * modulation_apply() scales m into a Q15 amplitude change, a phase increment
+ * change or a phase change, and modulation_voice_next() adds them to the
+ * carrier's amplitude, phase_inc and phase before its table lookup. No
+ * frequency or trig is recomputed.
+ *
+ * The inputs of a carrier are summed in a modulation_input_t, so a carrier
+ * can have several modulators, and a carrier can itself be a modulator
+ * (a chain). modulation_voice_next() clears the inputs it used. Voices are
+ * computed in order: a modulator listed before its carrier acts on the same
+ * sample, one listed after it on the next sample.
+ *
+ * Carriers always read the sine table (DDS_MODE_TABLE), since the rotor's
+ * step is fixed.
+ *
+ * @file modulation.h
+ * @author Philip Giacalone
+ */
+
+#ifndef MODULATION_H
+#define MODULATION_H
+
+#include <stdint.h>
+
+#include "dds.h"
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    MODULATION_NONE = 0,    // not a modulator: the voice is mixed into the output
+    MODULATION_AM,
+    MODULATION_FM,
+    MODULATION_PM
+} modulation_type_t;
+
+// where a modulator's value goes
+typedef struct {
+    modulation_type_t type;
+    // the index of the carrier
+    uint32_t target;
+    // the carrier's input for m = 1.0: AM in Q15, FM in phase increment units, PM in phase units (2^32 = one cycle)
+    int32_t depth;
+} modulation_route_t;
+
+// the sum of a carrier's modulation for the current sample
+typedef struct {
+    int32_t am;         // Q15, added to 1.0 to scale the amplitude
+    int32_t fm;         // added to the phase increment
+    int32_t pm;         // added to the phase
+} modulation_input_t;
+
+/**
+ * @brief Sets up a route. Floating point, call once at startup.
+ *
+ * @param depth AM: 0.0 to 1.0, FM: Hz (clamped just below sample_rate / 2), PM: radians (at most π)
+ * @param sample_rate the rate at which the voices are computed
+ */
+void modulation_route_init(modulation_route_t *route, modulation_type_t type, uint32_t target,
+                           double depth, double sample_rate);
+
+/**
+ * @brief Clears the inputs of a carrier
+ */
+ISR_INLINE void modulation_input_clear(modulation_input_t *input) {
+    input->am = 0;
+    input->fm = 0;
+    input->pm = 0;
+}
+
+/**
+ * @brief Adds a modulator's value to its carrier's inputs
+ *
+ * @param inputs the inputs of all of the voices (indexed by route->target)
+ * @param value the modulator's output, bipolar Q15
+ */
+ISR_INLINE void modulation_apply(const modulation_route_t *route, modulation_input_t *inputs, int32_t value) {
+    modulation_input_t *input = &inputs[route->target];
+    int32_t change = (int32_t)(((int64_t)route->depth * value) >> 15);
+    switch (route->type) {
+        case MODULATION_AM:
+            input->am += change;
+            break;
+        case MODULATION_FM:
+            input->fm += change;
+            break;
+        case MODULATION_PM:
+            input->pm += change;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Returns the voice's next sample with its modulation inputs applied, and advances its phase.
+ * Clears the inputs.
+ *
+ * The result is amplitude * (1 + am) * (y_offset + sin(phase + pm)) in Q15, and the phase
+ * advances by phase_inc + fm. Without inputs it is the same as dds_voice_next() (table mode).
+ */
+ISR_INLINE int32_t modulation_voice_next(dds_voice_t *voice, modulation_input_t *input) {
+    int32_t s = dds_sine(voice->phase + (uint32_t)input->pm);
+    voice->phase += voice->phase_inc + (uint32_t)input->fm;
+    int32_t y = (voice->amplitude * (voice->y_offset + s)) >> 15;
+    y += (y * input->am) >> 15;
+    modulation_input_clear(input);
+    return y;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MODULATION_H
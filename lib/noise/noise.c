@@ -0,0 +1,30 @@
+/**
+ * Fixed-point noise generators. See noise.h
+ *
+ * @file noise.c
+ * @author Philip Giacalone
+ */
+
+#include "noise.h"
+
+#include <math.h>
+
+void noise_init(noise_t *noise, noise_color_t color, double amplitude, double y_offset, uint32_t seed) {
+    noise->color = color;
+    // spread the seed over the state (splitmix32), xorshift32 must not start at 0
+    uint32_t x = seed + 0x9E3779B9UL;
+    x = (x ^ (x >> 16)) * 0x85EBCA6BUL;
+    x = (x ^ (x >> 13)) * 0xC2B2AE35UL;
+    x ^= x >> 16;
+    noise->state = x != 0 ? x : 1;
+    noise->amplitude = (int32_t)lround(amplitude * NOISE_Q15_MAX);
+    noise->y_offset = (int32_t)lround(y_offset * NOISE_Q15_MAX);
+
+    noise->counter = 0;
+    noise->row_sum = 0;
+    for (int i = 0; i < NOISE_PINK_ROWS; i++) {
+        noise->rows[i] = noise_white(noise) >> 3;
+        noise->row_sum += noise->rows[i];
+    }
+    noise->level = 0;
+}
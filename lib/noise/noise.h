@@ -0,0 +1,136 @@
+/**
+ * Fixed-point noise generators: white, pink and brown.
+ *
+ *  white - xorshift32, the top 16 bits as a Q15 sample (flat spectrum)
+ *  pink  - Voss-McCartney: NOISE_PINK_ROWS white values, row k re-drawn every
+ *          2^(k+1) samples, plus a fresh white value each sample. The sum
+ *          falls at about -3 dB per octave over NOISE_PINK_ROWS octaves.
+ *  brown - a leaky integrator of white noise, -6 dB per octave above
+ *          sample_rate / (2π 2^NOISE_BROWN_LEAK) (the leak keeps it from
+ *          drifting off to full scale).
+ *
+ * noise_next() returns amplitude * (y_offset + noise) in Q15, like
+ * dds_voice_next(), so a noise source mixes with DDS voices and envelopes.
+ *
+ * Every sample costs a fixed number of integer operations (the pink generator
+ * re-draws one row per sample, picked by counting trailing zeros), and the
+ * functions are always inlined, so they can run in an IRAM timer ISR.
+ *
+ * @file noise.h
+ * @author Philip Giacalone
+ */
+
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <stdint.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef NOISE_PINK_ROWS
+#define NOISE_PINK_ROWS     12      // octaves of pink noise below sample_rate / 2
+#endif
+#define NOISE_BROWN_LEAK    8       // the brown integrator loses 1/2^8 of its level per sample
+#define NOISE_Q15_MAX       32767
+
+typedef enum {
+    NOISE_NONE = 0,
+    NOISE_WHITE,
+    NOISE_PINK,
+    NOISE_BROWN
+} noise_color_t;
+
+// y = amplitude * (y_offset + noise)
+typedef struct {
+    noise_color_t color;
+    // xorshift32 state, never 0
+    uint32_t state;
+    // amplitude in Q15 (0 to NOISE_Q15_MAX)
+    int32_t amplitude;
+    // vertical offset in Q15. NOISE_Q15_MAX keeps the output from going negative
+    int32_t y_offset;
+
+    // --- NOISE_PINK ---
+    uint32_t counter;
+    int32_t rows[NOISE_PINK_ROWS];
+    int32_t row_sum;
+
+    // --- NOISE_BROWN ---
+    int32_t level;
+} noise_t;
+
+/**
+ * @brief Sets up a noise source
+ *
+ * @param amplitude between 0.0 and 1.0
+ * @param y_offset vertical offset, 1.0 keeps the output from going negative
+ * @param seed any value (sources with different seeds are uncorrelated)
+ */
+void noise_init(noise_t *noise, noise_color_t color, double amplitude, double y_offset, uint32_t seed);
+
+ISR_INLINE int32_t noise_clamp_(int32_t value) {
+    return value > NOISE_Q15_MAX ? NOISE_Q15_MAX : (value < -NOISE_Q15_MAX ? -NOISE_Q15_MAX : value);
+}
+
+/**
+ * @brief Returns the next white noise value, in Q15 (-32768 to 32767)
+ */
+ISR_INLINE int32_t noise_white(noise_t *noise) {
+    uint32_t x = noise->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    noise->state = x;
+    return (int32_t)x >> 16;
+}
+
+ISR_INLINE int32_t noise_pink_(noise_t *noise) {
+    // row k is re-drawn when bit k is the lowest set bit of the counter (every 2^(k+1) samples)
+    uint32_t row = (uint32_t)__builtin_ctz(++noise->counter | (1UL << NOISE_PINK_ROWS));
+    if (row < NOISE_PINK_ROWS) {
+        // each row is white >> 3, so the sum of the rows and the white value is about Q15
+        int32_t value = noise_white(noise) >> 3;
+        noise->row_sum += value - noise->rows[row];
+        noise->rows[row] = value;
+    }
+    return noise_clamp_(noise->row_sum + (noise_white(noise) >> 3));
+}
+
+ISR_INLINE int32_t noise_brown_(noise_t *noise) {
+    int32_t level = noise->level + (noise_white(noise) >> 5);
+    level -= level >> NOISE_BROWN_LEAK;
+    noise->level = noise_clamp_(level);
+    return noise->level;
+}
+
+/**
+ * @brief Returns the next value of the noise source: amplitude * (y_offset + noise) in Q15
+ */
+ISR_INLINE int32_t noise_next(noise_t *noise) {
+    int32_t n;
+    switch (noise->color) {
+        case NOISE_PINK:
+            n = noise_pink_(noise);
+            break;
+        case NOISE_BROWN:
+            n = noise_brown_(noise);
+            break;
+        case NOISE_WHITE:
+            n = noise_white(noise);
+            break;
+        default:
+            n = 0;
+            break;
+    }
+    return (noise->amplitude * (noise->y_offset + n)) >> 15;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // NOISE_H
@@ -0,0 +1,15 @@
+/**
+ * Quantizer for the 8-bit DAC. See quantize.h
+ *
+ * @file quantize.c
+ * @author Philip Giacalone
+ */
+
+#include "quantize.h"
+
+void quantize_init(quantizer_t *quantizer, quantize_mode_t mode, uint32_t seed) {
+    quantizer->mode = mode;
+    noise_init(&quantizer->noise, NOISE_WHITE, 1.0, 0.0, seed);
+    quantizer->error1 = 0;
+    quantizer->error2 = 0;
+}
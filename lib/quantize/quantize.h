@@ -0,0 +1,114 @@
+/**
+ * Quantizer for the 8-bit DAC: turns a value with QUANTIZE_FRACTION_BITS
+ * bits below the DAC step into a DAC value, with optional dither and noise
+ * shaping.
+ *
+ * Truncating a waveform to 8 bits makes an error that follows the signal, so
+ * it shows up as harmonics. They are loudest (relative to the signal) on low
+ * amplitude waves, e.g. ATTENUATION 0.5 or the tail of a decaying wave.
+ *
+ *  QUANTIZE_TRUNCATE - drop the fraction (what the generators always did)
+ *  QUANTIZE_ROUND    - round to the nearest step (no DC offset, same harmonics)
+ *  QUANTIZE_TPDF     - add triangular (TPDF) dither of +-1 step before rounding.
+ *                      The error becomes noise, independent of the signal: no
+ *                      harmonics, a slightly higher noise floor.
+ *  QUANTIZE_SHAPED_1 - TPDF dither plus first-order error feedback. The error
+ *                      of each sample is subtracted from the next, so the noise
+ *                      is shaped by (1 - z^-1): lower at low frequencies, higher
+ *                      near sample_rate / 2.
+ *  QUANTIZE_SHAPED_2 - the same with second-order feedback, (1 - z^-1)^2: even
+ *                      less noise at low frequencies, more near sample_rate / 2.
+ *
+ * Noise shaping only helps if the frequencies it moves the noise to are
+ * filtered out after the DAC (or are far above the band of interest).
+ *
+ * Integer math only: a xorshift32 step (see lib/noise), a few adds and a
+ * shift, always inlined, so quantize_next() can run per sample in a timer
+ * callback or a render task.
+ *
+ * @file quantize.h
+ * @author Philip Giacalone
+ */
+
+#ifndef QUANTIZE_H
+#define QUANTIZE_H
+
+#include <stdint.h>
+
+#include "isr_safe.h"
+#include "noise.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QUANTIZE_FRACTION_BITS  8       // input bits below one DAC step (at most 8, the dither has 8 bits)
+#define QUANTIZE_MAX            255     // the largest DAC value
+
+typedef enum {
+    QUANTIZE_TRUNCATE = 0,
+    QUANTIZE_ROUND,
+    QUANTIZE_TPDF,
+    QUANTIZE_SHAPED_1,
+    QUANTIZE_SHAPED_2
+} quantize_mode_t;
+
+typedef struct {
+    quantize_mode_t mode;
+    // the dither's random numbers (noise_white())
+    noise_t noise;
+    // the errors of the last two samples, in input units (QUANTIZE_SHAPED_1, QUANTIZE_SHAPED_2)
+    int32_t error1;
+    int32_t error2;
+} quantizer_t;
+
+/**
+ * @brief Sets up a quantizer
+ *
+ * @param seed any value (quantizers with different seeds have uncorrelated dither)
+ */
+void quantize_init(quantizer_t *quantizer, quantize_mode_t mode, uint32_t seed);
+
+/**
+ * @brief Returns the next dither value: triangular, -(1 step) to +(1 step), in input units
+ */
+ISR_INLINE int32_t quantize_dither_(quantizer_t *quantizer) {
+    // two 8-bit uniform values from one 16-bit white value, their difference is triangular
+    int32_t white = noise_white(&quantizer->noise);
+    int32_t dither = ((white >> 8) & 0xFF) - (white & 0xFF);
+    return dither >> (8 - QUANTIZE_FRACTION_BITS);
+}
+
+/**
+ * @brief Quantizes one sample
+ *
+ * @param value the DAC value times 2^QUANTIZE_FRACTION_BITS
+ * @return the DAC value (between 0 and QUANTIZE_MAX)
+ */
+ISR_INLINE uint8_t quantize_next(quantizer_t *quantizer, int32_t value) {
+    int32_t q;
+    if (quantizer->mode == QUANTIZE_TRUNCATE) {
+        q = value >> QUANTIZE_FRACTION_BITS;
+    } else {
+        // with the feedback, the output is value + e[n] - e[n-1] (first order) or
+        // value + e[n] - 2 e[n-1] + e[n-2] (second order), e being each sample's error
+        int32_t u = value;
+        if (quantizer->mode == QUANTIZE_SHAPED_1) {
+            u -= quantizer->error1;
+        } else if (quantizer->mode == QUANTIZE_SHAPED_2) {
+            u -= 2 * quantizer->error1 - quantizer->error2;
+        }
+        int32_t dither = quantizer->mode == QUANTIZE_ROUND ? 0 : quantize_dither_(quantizer);
+        q = (u + (1 << (QUANTIZE_FRACTION_BITS - 1)) + dither) >> QUANTIZE_FRACTION_BITS;
+        // the error before clamping, so a clipped peak cannot wind up the feedback
+        quantizer->error2 = quantizer->error1;
+        quantizer->error1 = (q << QUANTIZE_FRACTION_BITS) - u;
+    }
+    return (uint8_t)(q > QUANTIZE_MAX ? QUANTIZE_MAX : (q < 0 ? 0 : q));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // QUANTIZE_H
@@ -0,0 +1,36 @@
+/**
+ * Glitch-free retuning of a playing dds_table_player_t. See retune.h
+ *
+ * @file retune.c
+ * @author Philip Giacalone
+ */
+
+#include "retune.h"
+
+#include <stddef.h>
+
+void retune_init(retune_t *retune, retune_point_t point, uint32_t dac_channel) {
+    retune->point = point;
+    retune->channel = dac_channel;
+    retune->pending = 0;
+    retune->waited = 0;
+    retune->period = 0;
+    retune->fade_table = NULL;
+    retune->fade_left = 0;
+    retune->applied = 0;
+    retune->last_cycles = 0;
+    retune->last_samples = 0;
+    isr_cycle_stats_reset(&retune->latency_cycles);
+    isr_cycle_stats_reset(&retune->latency_samples);
+}
+
+bool retune_request(retune_t *retune, const retune_params_t *params) {
+    if (retune_pending(retune)) {
+        return false;
+    }
+    // the ISR does not read the block while pending == 0
+    retune->next = *params;
+    retune->requested_at = isr_cycle_count();
+    __atomic_store_n(&retune->pending, 1, __ATOMIC_RELEASE);
+    return true;
+}
@@ -0,0 +1,182 @@
+/**
+ * Glitch-free retuning of a playing dds_table_player_t.
+ *
+ * A control task fills in a parameter block (table, phase increment, DAC
+ * channel) with retune_request(). The timer ISR plays samples with
+ * retune_next(), and picks the new parameters up at the next cycle boundary
+ * or zero crossing of the phase:
+ *
+ *  - the phase accumulator carries on, so the phase is continuous. Only the
+ *    increment (frequency) and the table (shape, amplitude) change.
+ *  - a new table is faded in over RETUNE_FADE_SAMPLES samples, from the
+ *    previous table at the same phase. The tables do not meet at the retune
+ *    point: the midpoint of a wave_table cycle is 127 * attenuation, and a
+ *    square or sawtooth is at its edge there. Without the fade, a change of
+ *    amplitude or shape steps the output by up to half the DAC range.
+ *
+ * A block can also carry a new timer period (for a new sample rate, with the
+ * increment computed for it). The ISR hands it to the timer callback in
+ * "period" at the same sample it switches the increment, so the callback can
+ * write the alarm on that tick (isr_timer_alarm_write()) and the new
+ * increment is never played at the old rate.
+ *
+ * There are no locks. The block has a single writer at a time: the control
+ * task writes it only while no request is pending, then publishes it with a
+ * release store of "pending". The ISR copies it and clears "pending" (release)
+ * at the end of the fade, so the previous table stays in use until then.
+ * retune_request() returns false while the previous request is still pending.
+ *
+ * The ISR records the latency of each retune (request to pick up) in CPU
+ * cycles and in samples.
+ *
+ * @file retune.h
+ * @author Philip Giacalone
+ */
+
+#ifndef RETUNE_H
+#define RETUNE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dds.h"
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// samples to fade from the previous table to a new one (a power of 2)
+#define RETUNE_FADE_BITS        6
+#define RETUNE_FADE_SAMPLES     (1 << RETUNE_FADE_BITS)
+
+// where the ISR picks up a new parameter block
+typedef enum {
+    RETUNE_AT_CYCLE = 0,        // when the phase wraps to the start of a cycle
+    RETUNE_AT_ZERO_CROSSING,    // when the phase passes 0 or 1/2 cycle
+    RETUNE_NOW                  // at the next sample (the phase is still continuous)
+} retune_point_t;
+
+typedef struct {
+    // one cycle, with the same number of entries as the player's current table
+    const uint8_t *table;
+    uint32_t phase_inc;
+    // the DAC channel to write to (e.g. DAC_CHANNEL_1)
+    uint32_t dac_channel;
+    // the timer period (alarm ticks) to play them at, 0 to keep the current one
+    uint32_t period;
+} retune_params_t;
+
+typedef struct {
+    retune_point_t point;
+    // the DAC channel in use (set by the ISR when it picks up a block)
+    uint32_t channel;
+
+    // --- written by the control task while pending == 0 ---
+    retune_params_t next;
+    uint32_t requested_at;      // isr_cycle_count() when it was published
+    // 1 from retune_request() until the ISR picks the block up
+    uint32_t pending;
+
+    // --- written by the ISR ---
+    // samples played since the request
+    uint32_t waited;
+    // the period of the block just picked up, until the timer callback writes the alarm (then 0)
+    uint32_t period;
+    // the table being faded out, and the samples left of the fade (0 when none)
+    const uint8_t *fade_table;
+    uint32_t fade_left;
+    // number of blocks picked up
+    uint32_t applied;
+    // the latency of the last block picked up
+    uint32_t last_cycles;
+    uint32_t last_samples;
+    isr_cycle_stats_t latency_cycles;
+    isr_cycle_stats_t latency_samples;
+} retune_t;
+
+/**
+ * @brief Sets up a retuner. The player keeps its current table and frequency
+ * until the first request.
+ */
+void retune_init(retune_t *retune, retune_point_t point, uint32_t dac_channel);
+
+/**
+ * @brief Control task: publishes new parameters for the ISR.
+ *
+ * @return false (and changes nothing) if the previous request has not been
+ *         picked up yet
+ */
+bool retune_request(retune_t *retune, const retune_params_t *params);
+
+/**
+ * @brief Control task: returns true while a request is waiting for the ISR,
+ * or its table is still fading in
+ */
+static inline bool retune_pending(const retune_t *retune) {
+    return __atomic_load_n(&retune->pending, __ATOMIC_ACQUIRE) != 0;
+}
+
+/**
+ * @brief ISR: returns the next table value, advances the phase, and picks up
+ * a pending parameter block at the retune point.
+ *
+ * @param interpolate use dds_table_next_interp() instead of dds_table_next()
+ */
+ISR_INLINE uint8_t retune_next(retune_t *retune, dds_table_player_t *player, bool interpolate) {
+    uint32_t before = player->phase;
+    uint8_t value = interpolate ? dds_table_next_interp(player) : dds_table_next(player);
+
+    if (__atomic_load_n(&retune->pending, __ATOMIC_ACQUIRE) && retune->fade_left != 0) {
+        // mix in the previous table at the same phase: all of it at first, none at the end
+        int32_t previous = retune->fade_table[before >> (32 - player->bits)];
+        int32_t mixed = value + (((previous - value) * (int32_t)retune->fade_left) >> RETUNE_FADE_BITS);
+        value = (uint8_t)mixed;
+        if (--retune->fade_left == 0) {
+            // the control task may replace the previous table from here on
+            __atomic_store_n(&retune->pending, 0, __ATOMIC_RELEASE);
+        }
+    } else if (__atomic_load_n(&retune->pending, __ATOMIC_ACQUIRE)) {
+        retune->waited++;
+        uint32_t after = player->phase;
+        bool ready;
+        switch (retune->point) {
+            case RETUNE_AT_CYCLE:
+                // the phase wrapped around past 0
+                ready = after < before;
+                break;
+            case RETUNE_AT_ZERO_CROSSING:
+                // the top bit changed: the phase passed 0 or 1/2 cycle
+                ready = ((after ^ before) & 0x80000000UL) != 0;
+                break;
+            default:
+                ready = true;
+                break;
+        }
+        if (ready) {
+            // the next sample is the first one played with the new parameters
+            retune->fade_table = player->table;
+            retune->fade_left = player->table != retune->next.table ? RETUNE_FADE_SAMPLES : 0;
+            player->table = retune->next.table;
+            player->phase_inc = retune->next.phase_inc;
+            retune->channel = retune->next.dac_channel;
+            retune->period = retune->next.period;
+            retune->last_cycles = isr_cycle_count() - retune->requested_at;
+            retune->last_samples = retune->waited;
+            isr_cycle_stats_add(&retune->latency_cycles, retune->last_cycles);
+            isr_cycle_stats_add(&retune->latency_samples, retune->last_samples);
+            retune->waited = 0;
+            retune->applied++;
+            if (retune->fade_left == 0) {
+                __atomic_store_n(&retune->pending, 0, __ATOMIC_RELEASE);
+            }
+        }
+    }
+    return value;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RETUNE_H
@@ -0,0 +1,108 @@
+/**
+ * Streams 8-bit DAC samples through a ring buffer. See sample_stream.h
+ *
+ * @file sample_stream.c
+ * @author Philip Giacalone
+ */
+
+#include "sample_stream.h"
+
+#include <string.h>
+
+static size_t memory_read(void *context, uint8_t *samples, size_t count) {
+    sample_memory_t *memory = (sample_memory_t *)context;
+    size_t left = memory->size - memory->position;
+    if (count > left) {
+        count = left;
+    }
+    memcpy(samples, memory->data + memory->position, count);
+    memory->position += count;
+    return count;
+}
+
+static bool memory_rewind(void *context) {
+    ((sample_memory_t *)context)->position = 0;
+    return true;
+}
+
+static size_t file_read(void *context, uint8_t *samples, size_t count) {
+    return fread(samples, 1, count, (FILE *)context);
+}
+
+static bool file_rewind(void *context) {
+    return fseek((FILE *)context, 0, SEEK_SET) == 0;
+}
+
+void sample_source_memory(sample_source_t *source, sample_memory_t *memory,
+                          const uint8_t *data, size_t size) {
+    memory->data = data;
+    memory->size = size;
+    memory->position = 0;
+    source->read = memory_read;
+    source->rewind = memory_rewind;
+    source->context = memory;
+}
+
+void sample_source_file(sample_source_t *source, FILE *file) {
+    source->read = file_read;
+    source->rewind = file_rewind;
+    source->context = file;
+}
+
+bool sample_stream_init(sample_stream_t *stream, uint8_t *samples, uint32_t size, uint32_t chunk,
+                        const sample_source_t *source, bool loop, uint8_t initial_sample) {
+    bool power_of_2 = size > 0 && (size & (size - 1)) == 0 && chunk > 0 && (chunk & (chunk - 1)) == 0;
+    if (!power_of_2 || chunk > size / 2 || size > 0x80000000UL) {
+        return false;
+    }
+    memset(stream, 0, sizeof(*stream));
+    stream->samples = samples;
+    stream->size = size;
+    stream->chunk = chunk;
+    stream->source = *source;
+    stream->loop = loop;
+    stream->last_sample = initial_sample;
+    stream->stats.min_fill = UINT32_MAX;
+    return true;
+}
+
+uint32_t sample_stream_fill(sample_stream_t *stream) {
+    sample_stream_stats_t *stats = &stream->stats;
+    uint32_t head = stream->head;
+    uint32_t fill = head - __atomic_load_n(&stream->tail, __ATOMIC_ACQUIRE);
+    // the first fill starts from an empty ring, so it does not count
+    if (stats->chunks_read > 0 && fill < stats->min_fill) {
+        stats->min_fill = fill;
+    }
+
+    uint32_t added = 0;
+    while (!stream->ended) {
+        uint32_t free = stream->size - (head - __atomic_load_n(&stream->tail, __ATOMIC_ACQUIRE));
+        if (free < stream->chunk) {
+            break;
+        }
+        // read straight into the ring, up to its end
+        uint32_t offset = head & (stream->size - 1);
+        uint32_t count = stream->chunk;
+        if (count > stream->size - offset) {
+            count = stream->size - offset;
+        }
+        const sample_source_t *source = &stream->source;
+        size_t got = source->read(source->context, stream->samples + offset, count);
+        if (got == 0 && stream->loop && source->rewind != NULL && source->rewind(source->context)) {
+            stats->loops++;
+            got = source->read(source->context, stream->samples + offset, count);
+        }
+        if (got == 0) {
+            // the consumer holds the last sample from here on
+            __atomic_store_n(&stream->ended, 1, __ATOMIC_RELEASE);
+            break;
+        }
+        head += (uint32_t)got;
+        __atomic_store_n(&stream->head, head, __ATOMIC_RELEASE);
+        added += (uint32_t)got;
+        stats->chunks_read++;
+        stats->samples_read += got;
+    }
+    return added;
+}
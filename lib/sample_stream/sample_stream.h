@@ -0,0 +1,176 @@
+/**
+ * Streams 8-bit DAC samples from a file (or any other source) through a ring
+ * buffer to the timer callback, so a recording can be far longer than RAM.
+ *
+ * The ring buffer is single producer, single consumer:
+ *
+ *  - the producer (a task) calls sample_stream_fill(). It reads the source in
+ *    chunks, straight into the free part of the ring.
+ *  - the consumer (the timer callback) calls sample_stream_read() for each
+ *    sample. It returns true whenever a chunk of space has been freed, so the
+ *    callback can wake the task.
+ *
+ * There are no locks. "head" (samples written) has a single writer, the
+ * producer, and "tail" (samples read) has a single writer, the consumer.
+ * Each publishes with a release store. Both count up forever, modulo 2^32, so
+ * the fill level is head - tail.
+ *
+ * If the producer falls behind, the consumer repeats the last sample and
+ * counts an underrun. At the end of a source that does not loop, the last
+ * sample is held without counting underruns.
+ *
+ * Sources:
+ *  - sample_source_memory(): samples already in the address space. This is a
+ *    const array in flash, a flash partition mapped with esp_partition_mmap(),
+ *    or a file mapped with mmap() on the host.
+ *  - sample_source_file(): a stdio FILE. On the ESP32 this is any file on a
+ *    VFS mounted file system, e.g. "/littlefs/wave.raw" or "/spiffs/wave.raw".
+ *
+ * @file sample_stream.h
+ * @author Philip Giacalone
+ */
+
+#ifndef SAMPLE_STREAM_H
+#define SAMPLE_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    // returns up to count samples, 0 at the end of the source
+    size_t (*read)(void *context, uint8_t *samples, size_t count);
+    // goes back to the first sample, returns false if it cannot
+    bool (*rewind)(void *context);
+    void *context;
+} sample_source_t;
+
+// the state of a sample_source_memory()
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+    size_t position;
+} sample_memory_t;
+
+typedef struct {
+    // --- written by the consumer (timer callback) ---
+    // number of samples the consumer found no sample for
+    uint32_t underruns;
+
+    // --- written by the producer (task) ---
+    // samples queued ahead of the consumer when a refill started (the margin left)
+    uint32_t min_fill;
+    uint32_t chunks_read;
+    uint64_t samples_read;
+    // times the source was rewound (looping)
+    uint32_t loops;
+} sample_stream_stats_t;
+
+typedef struct {
+    uint8_t *samples;
+    uint32_t size;          // a power of 2
+    uint32_t chunk;         // a power of 2, at most size / 2
+    sample_source_t source;
+    bool loop;
+
+    // samples written, by the producer
+    uint32_t head;
+    // samples read, by the consumer
+    uint32_t tail;
+    // 1 once the source has ended (and does not loop)
+    uint32_t ended;
+    uint8_t last_sample;
+
+    sample_stream_stats_t stats;
+} sample_stream_t;
+
+/**
+ * @brief Sets up a source that reads from memory (flash, or an mmap'd file)
+ *
+ * @param memory holds the read position, must outlive the source
+ */
+void sample_source_memory(sample_source_t *source, sample_memory_t *memory,
+                          const uint8_t *data, size_t size);
+
+/**
+ * @brief Sets up a source that reads from an open stdio file
+ */
+void sample_source_file(sample_source_t *source, FILE *file);
+
+/**
+ * @brief Sets up a stream. The ring starts empty, call sample_stream_fill()
+ * before the timer starts.
+ *
+ * @param samples the ring, size entries
+ * @param size ring entries, a power of 2
+ * @param chunk samples per read from the source, a power of 2 and at most size / 2
+ * @param loop start over at the end of the source
+ * @param initial_sample played until the first sample is ready (e.g. mid-scale)
+ * @return false if size or chunk is not valid
+ */
+bool sample_stream_init(sample_stream_t *stream, uint8_t *samples, uint32_t size, uint32_t chunk,
+                        const sample_source_t *source, bool loop, uint8_t initial_sample);
+
+/**
+ * @brief Producer: reads whole chunks from the source until the ring has less
+ * than a chunk free (or the source ends)
+ *
+ * @return the number of samples added
+ */
+uint32_t sample_stream_fill(sample_stream_t *stream);
+
+/**
+ * @brief Returns the number of samples queued for the consumer
+ */
+static inline uint32_t sample_stream_fill_level(const sample_stream_t *stream) {
+    return __atomic_load_n(&stream->head, __ATOMIC_ACQUIRE) - __atomic_load_n(&stream->tail, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Returns true once a source that does not loop has been played to the end
+ */
+static inline bool sample_stream_finished(const sample_stream_t *stream) {
+    return __atomic_load_n(&stream->ended, __ATOMIC_ACQUIRE) && sample_stream_fill_level(stream) == 0;
+}
+
+/**
+ * @brief Consumer: gets the next sample to play
+ *
+ * Safe to call from an IRAM ISR (no locks, no floating point, always inlined).
+ *
+ * @param stream the stream to read from
+ * @param sample receives the next sample (the last one again on an underrun)
+ * @return true when a chunk of space was just freed for the producer
+ */
+ISR_INLINE bool sample_stream_read(sample_stream_t *stream, uint8_t *sample) {
+    uint32_t tail = stream->tail;
+    if (tail == __atomic_load_n(&stream->head, __ATOMIC_ACQUIRE)) {
+        if (!__atomic_load_n(&stream->ended, __ATOMIC_RELAXED)) {
+            stream->stats.underruns++;
+        }
+        *sample = stream->last_sample;
+        return false;
+    }
+
+    uint8_t value = stream->samples[tail & (stream->size - 1)];
+    stream->last_sample = value;
+    *sample = value;
+
+    tail++;
+    // the producer may overwrite the sample from here on
+    __atomic_store_n(&stream->tail, tail, __ATOMIC_RELEASE);
+    return (tail & (stream->chunk - 1)) == 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SAMPLE_STREAM_H
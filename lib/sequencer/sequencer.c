@@ -0,0 +1,103 @@
+/**
+ * A sample-accurate event sequencer for a playing table. See sequencer.h
+ *
+ * @file sequencer.c
+ * @author Philip Giacalone
+ */
+
+#include "sequencer.h"
+
+// the sample index of the next event, or UINT32_MAX after the last one
+ISR_INLINE uint32_t next_at(const sequencer_t *seq) {
+    return seq->next < seq->count ? seq->events[seq->next].at : UINT32_MAX;
+}
+
+// whether a must be played after b: a later sample, or a repeat before another event at the same sample
+static bool plays_after(const sequencer_event_t *a, const sequencer_event_t *b) {
+    return a->at > b->at ||
+           (a->at == b->at && a->type == SEQUENCER_REPEAT && b->type != SEQUENCER_REPEAT);
+}
+
+bool sequencer_init(sequencer_t *seq, sequencer_event_t *events, uint32_t count,
+                    const uint8_t *const *tables, uint32_t table_count, int32_t middle) {
+    for (uint32_t i = 0; i < count; i++) {
+        const sequencer_event_t *event = &events[i];
+        if ((event->type == SEQUENCER_TABLE && (event->value >= table_count || tables[event->value] == NULL)) ||
+            (event->type == SEQUENCER_AMPLITUDE && event->value > SEQUENCER_UNITY_GAIN) ||
+            (event->type == SEQUENCER_REPEAT && event->at == 0) ||
+            event->type > SEQUENCER_REPEAT) {
+            return false;
+        }
+    }
+
+    // insertion sort: stable, and the timeline is short and usually sorted already. a repeat goes after
+    // the other events at its sample, which would never be reached behind it
+    for (uint32_t i = 1; i < count; i++) {
+        sequencer_event_t event = events[i];
+        uint32_t j = i;
+        while (j > 0 && plays_after(&events[j - 1], &event)) {
+            events[j] = events[j - 1];
+            j--;
+        }
+        events[j] = event;
+    }
+
+    seq->events = events;
+    seq->count = count;
+    seq->tables = tables;
+    seq->table_count = table_count;
+    seq->middle = middle;
+    seq->sample = 0;
+    seq->next = 0;
+    seq->gain = SEQUENCER_UNITY_GAIN << SEQUENCER_RAMP_BITS;
+    seq->gain_target = seq->gain;
+    seq->gain_step = 0;
+    seq->ramp_left = 0;
+    seq->gate = 1;
+    seq->burst_left = 0;
+    seq->fired = 0;
+    seq->repeats = 0;
+    seq->next_at = next_at(seq);
+    return true;
+}
+
+void ISR_CODE sequencer_fire_(sequencer_t *seq, dds_table_player_t *player) {
+    while (seq->next < seq->count && seq->events[seq->next].at == seq->sample) {
+        const sequencer_event_t *event = &seq->events[seq->next++];
+        seq->fired++;
+        switch (event->type) {
+            case SEQUENCER_FREQUENCY:
+                player->phase_inc = event->value;
+                break;
+            case SEQUENCER_TABLE:
+                player->table = seq->tables[event->value];
+                break;
+            case SEQUENCER_AMPLITUDE:
+                seq->gain_target = (int32_t)event->value << SEQUENCER_RAMP_BITS;
+                seq->ramp_left = event->length;
+                if (event->length == 0) {
+                    seq->gain = seq->gain_target;
+                } else {
+                    // one integer divide per ramp. the rounding error is made up at the last step
+                    seq->gain_step = (seq->gain_target - seq->gain) / (int32_t)event->length;
+                }
+                break;
+            case SEQUENCER_GATE:
+                seq->gate = event->value != 0;
+                seq->burst_left = 0;
+                break;
+            case SEQUENCER_BURST:
+                player->phase = 0;
+                seq->gate = event->value != 0;
+                seq->burst_left = event->value;
+                break;
+            default:
+                // SEQUENCER_REPEAT: this sample is sample 0 of the next pass
+                seq->sample = 0;
+                seq->next = 0;
+                seq->repeats++;
+                break;
+        }
+    }
+    seq->next_at = next_at(seq);
+}
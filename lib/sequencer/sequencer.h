@@ -0,0 +1,146 @@
+/**
+ * A sample-accurate event sequencer for a playing dds_table_player_t.
+ *
+ * A timeline of events (frequency steps, amplitude steps and ramps, table
+ * switches, gates and N-cycle bursts) is sorted once by sequencer_init(),
+ * into the array it is given. The timer ISR plays samples with
+ * sequencer_next(), which compares one sample counter with the sample index
+ * of the next event. The events due at that sample are applied before it is
+ * played, so each one lands on its exact sample, with no task-level jitter:
+ *
+ *  - the cost per sample is O(1): one compare, plus the ramp and burst
+ *    counters while they run. Applying events is a separate function
+ *    (in IRAM on the ESP32), called only at an event.
+ *  - everything is integer math. The gain is Q16 (65536 plays the table as
+ *    it is) and is applied around the table's midpoint. It ramps in Q30, so
+ *    a ramp of millions of samples still steps smoothly.
+ *  - events at the same sample are applied in the order they were given.
+ *  - a SEQUENCER_REPEAT event starts the timeline over at its sample (which
+ *    becomes sample 0), after the other events at that sample, whatever
+ *    order they were given in. Without one, the last settings keep playing.
+ *
+ * The events and tables must stay in place (in DRAM on the ESP32) while the
+ * ISR plays them. The sequencer changes the player's table, phase and phase
+ * increment, so do not retune (lib/retune) the same player at the same time.
+ *
+ * @file sequencer.h
+ * @author Philip Giacalone
+ */
+
+#ifndef SEQUENCER_H
+#define SEQUENCER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dds.h"
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SEQUENCER_UNITY_GAIN    65536   // Q16 gain of 1.0
+#define SEQUENCER_RAMP_BITS     14      // the bits below the Q16 gain while it ramps (Q30)
+#define SEQUENCER_MAX_LENGTH    0xFFFFFFU   // the longest ramp in samples (the length field is 24 bits)
+
+typedef enum {
+    SEQUENCER_FREQUENCY = 0,    // value: the new phase increment (dds_phase_increment())
+    SEQUENCER_TABLE,            // value: an index into the tables (all with the player's number of entries)
+    SEQUENCER_AMPLITUDE,        // value: the Q16 gain, reached in length samples (0 for a step)
+    SEQUENCER_GATE,             // value: 1 to play, 0 to hold the midpoint. ends a burst
+    SEQUENCER_BURST,            // value: cycles to play from phase 0, then the gate closes
+    SEQUENCER_REPEAT            // starts the timeline over (at must be more than 0)
+} sequencer_event_type_t;
+
+// one event of the timeline (12 bytes)
+typedef struct {
+    // the sample index, from the start of the timeline
+    uint32_t at;
+    uint32_t value;
+    // sequencer_event_type_t
+    uint32_t type : 8;
+    // SEQUENCER_AMPLITUDE: the ramp in samples
+    uint32_t length : 24;
+} sequencer_event_t;
+
+typedef struct {
+    const sequencer_event_t *events;
+    uint32_t count;
+    const uint8_t *const *tables;
+    uint32_t table_count;
+    // the output while the gate is closed, and the center the gain is applied around
+    int32_t middle;
+
+    // --- written by the ISR ---
+    // samples played since the start of the timeline
+    uint32_t sample;
+    // the next event, and its sample index (UINT32_MAX after the last one)
+    uint32_t next;
+    uint32_t next_at;
+    // Q30 (Q16 << SEQUENCER_RAMP_BITS)
+    int32_t gain;
+    int32_t gain_target;
+    int32_t gain_step;
+    uint32_t ramp_left;
+    uint32_t gate;
+    uint32_t burst_left;
+    // events applied, and times the timeline started over
+    uint32_t fired;
+    uint32_t repeats;
+} sequencer_t;
+
+/**
+ * @brief Sorts the events by sample index (keeping the order of events at
+ * the same sample) and sets up the sequencer, with the gate open at unity
+ * gain. Call before the ISR starts playing.
+ *
+ * @param events the timeline, sorted in place
+ * @param tables the tables that SEQUENCER_TABLE events select
+ * @param middle the value at the midpoint of the tables
+ * @return false if an event is invalid (a missing table, a gain above unity
+ *         or a repeat at sample 0)
+ */
+bool sequencer_init(sequencer_t *seq, sequencer_event_t *events, uint32_t count,
+                    const uint8_t *const *tables, uint32_t table_count, int32_t middle);
+
+/**
+ * @brief ISR: applies the events due at the current sample. Called by
+ * sequencer_next(), not inlined, since it runs only at an event.
+ */
+void sequencer_fire_(sequencer_t *seq, dds_table_player_t *player);
+
+/**
+ * @brief ISR: applies the events due at this sample, then returns the next
+ * value of the player with the gain and gate applied, and advances the phase
+ */
+ISR_INLINE uint8_t sequencer_next(sequencer_t *seq, dds_table_player_t *player) {
+    if (seq->sample == seq->next_at) {
+        sequencer_fire_(seq, player);
+    }
+    uint32_t before = player->phase;
+    int32_t value = dds_table_next(player);
+    int32_t gain = seq->gain >> SEQUENCER_RAMP_BITS;
+    uint32_t gate = seq->gate;
+
+    // the phase wrapped: a cycle of the burst ended
+    if (seq->burst_left != 0 && player->phase < before && --seq->burst_left == 0) {
+        seq->gate = 0;
+    }
+    if (seq->ramp_left != 0) {
+        // the last step lands exactly on the target
+        seq->gain = --seq->ramp_left == 0 ? seq->gain_target : seq->gain + seq->gain_step;
+    }
+    seq->sample++;
+
+    if (!gate) {
+        return (uint8_t)seq->middle;
+    }
+    return (uint8_t)(seq->middle + (((value - seq->middle) * gain) >> 16));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SEQUENCER_H
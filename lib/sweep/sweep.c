@@ -0,0 +1,176 @@
+/**
+ * Swept-sine frequency response measurement. See sweep.h
+ *
+ * @file sweep.c
+ * @author Philip Giacalone
+ */
+
+#include "sweep.h"
+
+#include <math.h>
+
+// the frequency at the lower edge of a bin (edge == bins is the stop frequency)
+static double bin_edge(const sweep_config_t *config, uint32_t edge) {
+    double fraction = (double)edge / config->bins;
+    if (config->spacing == SWEEP_LOG) {
+        return config->start_frequency * pow(config->stop_frequency / config->start_frequency, fraction);
+    }
+    return config->start_frequency + (config->stop_frequency - config->start_frequency) * fraction;
+}
+
+// the number of samples in a bin of a mean frequency
+static uint32_t bin_length(const sweep_config_t *config, double frequency) {
+    uint32_t length = (uint32_t)ceil(config->min_cycles * config->sample_rate / frequency);
+    return length > config->min_samples ? length : config->min_samples;
+}
+
+// Q32.32 phase increment
+static uint64_t phase_inc_q32(double frequency, double sample_rate) {
+    return (uint64_t)(frequency / sample_rate * 4294967296.0 * 4294967296.0);
+}
+
+static void start_warm_up(sweep_t *sweep) {
+    double frequency = sweep->config.start_frequency;
+    sweep->stage = SWEEP_WARM_UP;
+    sweep->count = 0;
+    sweep->length = bin_length(&sweep->config, frequency);
+    sweep->phase_inc = phase_inc_q32(frequency, sweep->config.sample_rate);
+    sweep->slope = 0;
+}
+
+static void start_bin(sweep_t *sweep, uint32_t bin) {
+    const sweep_config_t *config = &sweep->config;
+    double low = bin_edge(config, bin);
+    double high = bin_edge(config, bin + 1);
+    // the frequency ramps linearly within the bin, so its mean is the midpoint
+    double frequency = (low + high) / 2;
+
+    sweep->stage = SWEEP_BINS;
+    sweep->bin = bin;
+    sweep->count = 0;
+    sweep->length = bin_length(config, frequency);
+
+    // the phase carries on, only the increment and its slope change
+    uint64_t low_inc = phase_inc_q32(low, config->sample_rate);
+    uint64_t high_inc = phase_inc_q32(high, config->sample_rate);
+    sweep->phase_inc = low_inc;
+    sweep->slope = ((int64_t)high_inc - (int64_t)low_inc) / (int64_t)sweep->length;
+
+    double w = 2.0 * M_PI * frequency / config->sample_rate;
+    sweep->cos_w = (float)cos(w);
+    sweep->sin_w = (float)sin(w);
+    sweep->coeff = 2.0f * sweep->cos_w;
+    sweep->x1 = sweep->x2 = 0.0f;
+    sweep->y1 = sweep->y2 = 0.0f;
+    sweep->results[bin].frequency = (float)frequency;
+}
+
+// H = Y / X from the Goertzel filters at the end of a bin
+static void finish_bin(sweep_t *sweep) {
+    float x_re = sweep->x1 - sweep->x2 * sweep->cos_w;
+    float x_im = sweep->x2 * sweep->sin_w;
+    float y_re = sweep->y1 - sweep->y2 * sweep->cos_w;
+    float y_im = sweep->y2 * sweep->sin_w;
+
+    sweep_bin_t *result = &sweep->results[sweep->bin];
+    float x_magnitude = sqrtf(x_re * x_re + x_im * x_im);
+    result->magnitude = x_magnitude > 0.0f ? sqrtf(y_re * y_re + y_im * y_im) / x_magnitude : 0.0f;
+    float phase = (atan2f(y_im, y_re) - atan2f(x_im, x_re)) * (float)(180.0 / M_PI);
+    if (phase > 180.0f) {
+        phase -= 360.0f;
+    } else if (phase <= -180.0f) {
+        phase += 360.0f;
+    }
+    result->phase = phase;
+}
+
+bool sweep_init(sweep_t *sweep, const sweep_config_t *config, sweep_bin_t *results) {
+    float nyquist = config->sample_rate / 2;
+    if (config->bins == 0 || config->start_frequency <= 0.0f || config->stop_frequency <= 0.0f ||
+        config->start_frequency >= nyquist || config->stop_frequency >= nyquist ||
+        config->amplitude == 0 || config->amplitude > 127 || config->min_samples == 0) {
+        return false;
+    }
+    dds_init();
+    sweep->config = *config;
+    sweep->results = results;
+    sweep->phase = 0;
+    sweep->phase_inc = 0;
+    sweep->slope = 0;
+    sweep->stimulus = 128;
+    sweep->dc_sum = 0.0f;
+    sweep->dc = 0.0f;
+    sweep->stage = SWEEP_SETTLE;
+    sweep->count = 0;
+    sweep->length = config->settle_samples;
+    if (sweep->length == 0) {
+        start_warm_up(sweep);
+    }
+    return true;
+}
+
+uint32_t sweep_total_samples(const sweep_config_t *config) {
+    uint32_t total = config->settle_samples + bin_length(config, config->start_frequency);
+    for (uint32_t bin = 0; bin < config->bins; bin++) {
+        total += bin_length(config, (bin_edge(config, bin) + bin_edge(config, bin + 1)) / 2);
+    }
+    return total;
+}
+
+bool sweep_capture(sweep_t *sweep, float response) {
+    switch (sweep->stage) {
+        case SWEEP_SETTLE:
+            sweep->dc_sum += response;
+            if (++sweep->count == sweep->length) {
+                sweep->dc = sweep->dc_sum / sweep->length;
+                start_warm_up(sweep);
+            }
+            return true;
+
+        case SWEEP_WARM_UP:
+            if (++sweep->count == sweep->length) {
+                start_bin(sweep, 0);
+            }
+            return true;
+
+        case SWEEP_BINS: {
+            float x = (float)sweep->stimulus - 128.0f;
+            float y = response - sweep->dc;
+            float x0 = x + sweep->coeff * sweep->x1 - sweep->x2;
+            sweep->x2 = sweep->x1;
+            sweep->x1 = x0;
+            float y0 = y + sweep->coeff * sweep->y1 - sweep->y2;
+            sweep->y2 = sweep->y1;
+            sweep->y1 = y0;
+            if (++sweep->count < sweep->length) {
+                return true;
+            }
+            finish_bin(sweep);
+            if (sweep->bin + 1 < sweep->config.bins) {
+                start_bin(sweep, sweep->bin + 1);
+                return true;
+            }
+            sweep->stage = SWEEP_DONE;
+            return false;
+        }
+
+        default:
+            return false;
+    }
+}
+
+void sweep_rc_init(sweep_rc_t *rc, float cutoff, float sample_rate, float y) {
+    // time constant RC = 1 / (2π cutoff)
+    rc->a = (float)(1.0 - exp(-2.0 * M_PI * cutoff / sample_rate));
+    rc->y = y;
+}
+
+void sweep_rc_response(const sweep_rc_t *rc, float frequency, float sample_rate,
+                       float *magnitude, float *phase) {
+    // H(e^jw) = a / (1 - (1 - a) e^-jw)
+    double w = 2.0 * M_PI * frequency / sample_rate;
+    double re = 1.0 - (1.0 - rc->a) * cos(w);
+    double im = (1.0 - rc->a) * sin(w);
+    *magnitude = (float)(rc->a / sqrt(re * re + im * im));
+    *phase = (float)(-atan2(im, re) * 180.0 / M_PI);
+}
@@ -0,0 +1,184 @@
+/**
+ * Swept-sine frequency response measurement.
+ *
+ * A sweep plays a phase-continuous chirp (linear or log) on the DAC, and
+ * compares the response captured for each sample (e.g. from an ADC) with the
+ * stimulus:
+ *
+ *  1) settle: the DAC sits at mid-scale while the response settles. The mean
+ *     of the response is its DC level, subtracted from then on.
+ *  2) warm-up: one bin's worth of the start frequency, so the device under
+ *     test is in steady state when the first bin starts.
+ *  3) bins: the frequency range is split into bins (spaced linearly or
+ *     logarithmically). During bin k the chirp's frequency ramps from edge k
+ *     to edge k+1, and a pair of Goertzel filters at the bin's mean frequency
+ *     measures the stimulus X and the response Y. The bin's result is
+ *     H = Y / X, as a magnitude and a phase.
+ *
+ * Dividing by the measured stimulus cancels the DAC quantization and the
+ * leakage of the chirp within the bin. Each bin lasts at least min_cycles
+ * cycles of its frequency (and at least min_samples samples), so a log sweep
+ * has a constant relative resolution.
+ *
+ * The chirp is integer only (a 32-bit phase, a Q32.32 increment and the lib/dds
+ * sine table). The Goertzel filters use float (single precision, which the
+ * ESP32 FPU supports), so call sweep_capture() from a task, not from an ISR.
+ *
+ * sweep_rc_t is a simulated RC low-pass filter (the device under test in host
+ * builds and benchmarks), with its exact response for checking the results.
+ *
+ * Example:
+ *
+ *   sweep_init(&sweep, &config, results);
+ *   do {
+ *       isr_dac_write(DAC_CHANNEL_1, sweep_next(&sweep));
+ *   } while (sweep_capture(&sweep, adc1_get_raw(ADC1_CHANNEL_6)));
+ *
+ * @file sweep.h
+ * @author Philip Giacalone
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "dds.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    SWEEP_LINEAR = 0,
+    SWEEP_LOG
+} sweep_spacing_t;
+
+typedef struct {
+    sweep_spacing_t spacing;
+    // Hz, both positive and below sample_rate / 2
+    float start_frequency;
+    float stop_frequency;
+    uint32_t bins;
+    float sample_rate;
+    // each bin lasts at least this many cycles of its frequency...
+    uint32_t min_cycles;
+    // ...and at least this many samples
+    uint32_t min_samples;
+    // DAC steps either side of mid-scale (1 to 127)
+    uint8_t amplitude;
+    // samples at mid-scale before the sweep (the response settles, its DC level is measured)
+    uint32_t settle_samples;
+} sweep_config_t;
+
+typedef struct {
+    // Hz, the mean frequency of the chirp during the bin
+    float frequency;
+    // |Y / X|, in response units per DAC step
+    float magnitude;
+    // degrees, arg(Y / X) (negative for a lag)
+    float phase;
+} sweep_bin_t;
+
+typedef enum {
+    SWEEP_SETTLE = 0,
+    SWEEP_WARM_UP,
+    SWEEP_BINS,
+    SWEEP_DONE
+} sweep_stage_t;
+
+typedef struct {
+    sweep_config_t config;
+    sweep_bin_t *results;
+
+    // the chirp
+    uint32_t phase;
+    uint64_t phase_inc;     // Q32.32, the top 32 bits are added to the phase
+    int64_t slope;          // added to phase_inc every sample
+    uint8_t stimulus;       // the DAC value returned by sweep_next()
+
+    sweep_stage_t stage;
+    uint32_t bin;
+    // samples played and the length of the current stage (or bin)
+    uint32_t count;
+    uint32_t length;
+
+    // the DC level of the response
+    float dc_sum;
+    float dc;
+
+    // Goertzel filters for the stimulus (x) and the response (y)
+    float coeff;
+    float cos_w;
+    float sin_w;
+    float x1, x2;
+    float y1, y2;
+} sweep_t;
+
+/**
+ * @brief Sets up a sweep
+ *
+ * @param results receives config->bins results
+ * @return false if the configuration is not valid
+ */
+bool sweep_init(sweep_t *sweep, const sweep_config_t *config, sweep_bin_t *results);
+
+/**
+ * @brief Returns the total number of samples a sweep plays (all stages)
+ */
+uint32_t sweep_total_samples(const sweep_config_t *config);
+
+/**
+ * @brief Returns the next DAC value of the stimulus
+ */
+static inline uint8_t sweep_next(sweep_t *sweep) {
+    int32_t value = 128;
+    if (sweep->stage == SWEEP_WARM_UP || sweep->stage == SWEEP_BINS) {
+        value += (sweep->config.amplitude * dds_sine_interp(sweep->phase)) >> 15;
+        sweep->phase += (uint32_t)(sweep->phase_inc >> 32);
+        sweep->phase_inc += sweep->slope;
+    }
+    sweep->stimulus = (uint8_t)value;
+    return sweep->stimulus;
+}
+
+/**
+ * @brief Records the response to the sample returned by sweep_next()
+ *
+ * @return true while the sweep goes on, false once every bin has a result
+ */
+bool sweep_capture(sweep_t *sweep, float response);
+
+// a simulated RC low-pass filter: y[n] = y[n-1] + a * (x[n] - y[n-1])
+typedef struct {
+    float a;
+    float y;
+} sweep_rc_t;
+
+/**
+ * @brief Sets up an RC low-pass filter with a -3 dB frequency (Hz), sampled
+ * at sample_rate, starting at the value y
+ */
+void sweep_rc_init(sweep_rc_t *rc, float cutoff, float sample_rate, float y);
+
+/**
+ * @brief Returns the filter's output for the next input sample
+ */
+static inline float sweep_rc_next(sweep_rc_t *rc, float x) {
+    rc->y += rc->a * (x - rc->y);
+    return rc->y;
+}
+
+/**
+ * @brief Returns the exact response of the (sampled) filter at a frequency:
+ * magnitude and phase (degrees)
+ */
+void sweep_rc_response(const sweep_rc_t *rc, float frequency, float sample_rate,
+                       float *magnitude, float *phase);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SWEEP_H
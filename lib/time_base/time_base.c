@@ -0,0 +1,47 @@
+/**
+ * A drift-free sample-count time base. See time_base.h
+ *
+ * @file time_base.c
+ * @author Philip Giacalone
+ */
+
+#include "time_base.h"
+
+#include <math.h>
+
+// 2^32, one full cycle of the 32-bit phase
+#define TIME_BASE_PHASE_CYCLE   4294967296.0
+
+void time_base_init(time_base_t *tb, double sample_rate) {
+    tb->sample_rate = sample_rate;
+    tb->sample = 0;
+}
+
+uint64_t time_base_increment(const time_base_t *tb, double frequency) {
+    if (tb->sample_rate <= 0.0) {
+        return 0;
+    }
+    double cycles = frequency / tb->sample_rate;
+    // what the division rounded off (exact with fma()), so the low 32 bits are right too
+    double rest = fma(-cycles, tb->sample_rate, frequency) / tb->sample_rate;
+    // the whole and the fraction of a 32-bit phase step
+    double steps = fmod(cycles, 1.0) * TIME_BASE_PHASE_CYCLE;
+    double whole = floor(steps);
+    int64_t low = llround((steps - whole + rest * TIME_BASE_PHASE_CYCLE) * TIME_BASE_PHASE_CYCLE);
+    return ((uint64_t)(int64_t)whole << 32) + (uint64_t)low;
+}
+
+uint64_t time_base_samples(const time_base_t *tb) {
+    const volatile uint64_t *sample = &tb->sample;
+    uint64_t a;
+    uint64_t b;
+    do {
+        a = *sample;
+        b = *sample;
+    } while (a != b);
+    return a;
+}
+
+double time_base_seconds(const time_base_t *tb) {
+    return tb->sample_rate > 0.0 ? time_base_samples(tb) / tb->sample_rate : 0.0;
+}
@@ -0,0 +1,98 @@
+/**
+ * A drift-free time base: the number of samples played, as a 64-bit count.
+ *
+ * Computing the phase from the clock (t = esp_timer_get_time() / 1e6, then
+ * 2πft in floating point) loses precision as the uptime grows, and a late
+ * callback reads a later time, so its sample (and the phase it plays) jumps.
+ * Here the timer callback calls time_base_tick() once per sample, and the
+ * phase of each waveform is its increment times the sample count:
+ *
+ *   phase = sample * increment (mod 2^64), top 32 bits
+ *
+ * The increment is in 2^-64 cycles per sample (time_base_increment()), so
+ * its rounding adds about 2^-64 of a cycle per sample, 10^-7 of a cycle
+ * after a year at 150,000 samples/sec. A 32-bit DDS increment is off by up
+ * to 2^-33 of a cycle per sample, which is up to 1.5 cycles a day at that
+ * rate. Nothing is accumulated, so there is no error to build up, and a
+ * late callback plays its sample late but does not move the phase of any
+ * sample after it.
+ *
+ * The phase is the one of lib/dds and lib/fast_trig (2^32 is one cycle).
+ * Each phase costs one 64-bit multiply (three 32-bit multiplies on the
+ * ESP32). The per-sample functions are integer only and always inlined
+ * (ISR_INLINE), so they can be called from an IRAM interrupt handler.
+ *
+ * ESP32_waveform_benchmarks (bench_time_base.c) soaks it: it simulates
+ * days of uptime in virtual time, with late callbacks, and reports the
+ * phase error against the clock-based and the 32-bit DDS phase.
+ *
+ * @file time_base.h
+ * @author Philip Giacalone
+ */
+
+#ifndef TIME_BASE_H
+#define TIME_BASE_H
+
+#include <stdint.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    double sample_rate;
+
+    // --- written by the ISR ---
+    // samples played since time_base_init()
+    uint64_t sample;
+} time_base_t;
+
+/**
+ * @brief Starts the count at sample 0. Call before the timer starts.
+ *
+ * @param sample_rate the samples per second (the timer callback rate)
+ */
+void time_base_init(time_base_t *tb, double sample_rate);
+
+/**
+ * @brief The phase increment of a frequency in 2^-64 cycles per sample
+ * (not from an ISR, uses double math). Negative frequencies run backwards.
+ */
+uint64_t time_base_increment(const time_base_t *tb, double frequency);
+
+/**
+ * @brief The samples played so far. Safe to call from a task while the ISR
+ * ticks (the 64-bit count is two words on the ESP32, so it is read until it
+ * does not change).
+ */
+uint64_t time_base_samples(const time_base_t *tb);
+
+/**
+ * @brief The time of the current sample in seconds (samples / sample rate)
+ */
+double time_base_seconds(const time_base_t *tb);
+
+/**
+ * @brief ISR: counts one sample. Call once per timer callback, after its
+ * sample is computed.
+ */
+ISR_INLINE void time_base_tick(time_base_t *tb) {
+    tb->sample++;
+}
+
+/**
+ * @brief ISR: the 32-bit phase of a waveform at the current sample
+ *
+ * @param increment from time_base_increment()
+ */
+ISR_INLINE uint32_t time_base_phase(const time_base_t *tb, uint64_t increment) {
+    return (uint32_t)((tb->sample * increment) >> 32);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIME_BASE_H
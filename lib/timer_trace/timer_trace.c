@@ -0,0 +1,213 @@
+/**
+ * Timer callback latency and jitter histograms. See timer_trace.h
+ *
+ * @file timer_trace.c
+ * @author Philip Giacalone
+ */
+
+#include "timer_trace.h"
+
+#include <string.h>
+
+static void histogram_init(timer_trace_histogram_t *histogram, int32_t offset, uint32_t width) {
+    memset(histogram, 0, sizeof(*histogram));
+    histogram->offset = offset;
+    histogram->width = width > 0 ? width : 1;
+}
+
+static void histogram_add(timer_trace_histogram_t *histogram, int32_t value) {
+    int64_t bin = ((int64_t)value - histogram->offset) / histogram->width;
+    if (value < histogram->offset || bin < 0) {
+        bin = 0;
+    } else if (bin >= TIMER_TRACE_BINS) {
+        bin = TIMER_TRACE_BINS - 1;
+    }
+    histogram->bins[bin]++;
+    if (histogram->count == 0 || value < histogram->min) {
+        histogram->min = value;
+    }
+    if (histogram->count == 0 || value > histogram->max) {
+        histogram->max = value;
+    }
+    histogram->count++;
+    histogram->total += value;
+}
+
+void timer_trace_init(timer_trace_t *trace) {
+    trace->head = 0;
+    trace->sequence = 0;
+    trace->dropped = 0;
+    trace->tail = 0;
+}
+
+void timer_trace_report_init(timer_trace_report_t *report, uint32_t period, uint32_t cycles_per_us,
+                             uint32_t bin_width) {
+    memset(report, 0, sizeof(*report));
+    report->period = period;
+    report->cycles_per_us = cycles_per_us;
+    histogram_init(&report->latency, 0, bin_width);
+    histogram_init(&report->jitter, -(int32_t)(bin_width * TIMER_TRACE_BINS / 2), bin_width);
+}
+
+void timer_trace_report_reset(timer_trace_report_t *report) {
+    histogram_init(&report->latency, report->latency.offset, report->latency.width);
+    histogram_init(&report->jitter, report->jitter.offset, report->jitter.width);
+    report->dropped = 0;
+}
+
+uint32_t timer_trace_collect(timer_trace_t *trace, timer_trace_report_t *report) {
+    uint32_t tail = trace->tail;
+    uint32_t head = __atomic_load_n(&trace->head, __ATOMIC_ACQUIRE);
+    for (uint32_t i = tail; i != head; i++) {
+        timer_trace_stamp_t stamp = trace->ring[i & (TIMER_TRACE_RING - 1)];
+        if (!report->started) {
+            report->due_sequence = stamp.sequence;
+            report->due_cycles = stamp.cycles;
+            report->started = true;
+        } else if (stamp.sequence == report->last_sequence + 1) {
+            histogram_add(&report->jitter, (int32_t)(stamp.cycles - report->last_cycles - report->period));
+        }
+        // the wrapping subtraction works across overflows of the 32-bit cycle counter
+        uint32_t due = report->due_cycles + (stamp.sequence - report->due_sequence) * report->period;
+        int32_t latency = (int32_t)(stamp.cycles - due);
+        if (latency < 0) {
+            // the least late call so far: later calls are due from here
+            report->due_sequence = stamp.sequence;
+            report->due_cycles = stamp.cycles;
+            latency = 0;
+        }
+        histogram_add(&report->latency, latency);
+        report->last_sequence = stamp.sequence;
+        report->last_cycles = stamp.cycles;
+    }
+    // the ISR may overwrite the stamps from here on
+    __atomic_store_n(&trace->tail, head, __ATOMIC_RELEASE);
+
+    uint32_t dropped = __atomic_load_n(&trace->dropped, __ATOMIC_RELAXED);
+    report->dropped += dropped - report->dropped_seen;
+    report->dropped_seen = dropped;
+    return head - tail;
+}
+
+int32_t timer_trace_percentile(const timer_trace_histogram_t *histogram, uint32_t permille) {
+    if (histogram->count == 0) {
+        return 0;
+    }
+    uint64_t target = ((uint64_t)histogram->count * permille + 999) / 1000;
+    uint64_t below = 0;
+    for (int i = 0; i < TIMER_TRACE_BINS - 1; i++) {
+        below += histogram->bins[i];
+        if (below >= target) {
+            int64_t edge = histogram->offset + (int64_t)(i + 1) * histogram->width;
+            return edge < histogram->max ? (int32_t)edge : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+int32_t timer_trace_mean(const timer_trace_histogram_t *histogram) {
+    return histogram->count > 0 ? (int32_t)(histogram->total / histogram->count) : 0;
+}
+
+// --- the binary frame: little endian words, then the bins as varints (7 bits per byte) ---
+
+static uint8_t *put_u32(uint8_t *out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        *out++ = (uint8_t)(value >> (8 * i));
+    }
+    return out;
+}
+
+static uint8_t *put_varint(uint8_t *out, uint32_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t)value;
+    return out;
+}
+
+static uint8_t *put_histogram(uint8_t *out, const timer_trace_histogram_t *histogram) {
+    out = put_u32(out, (uint32_t)histogram->offset);
+    out = put_u32(out, histogram->width);
+    out = put_u32(out, histogram->count);
+    out = put_u32(out, (uint32_t)histogram->min);
+    out = put_u32(out, (uint32_t)histogram->max);
+    out = put_u32(out, (uint32_t)(uint64_t)histogram->total);
+    out = put_u32(out, (uint32_t)((uint64_t)histogram->total >> 32));
+    for (int i = 0; i < TIMER_TRACE_BINS; i++) {
+        out = put_varint(out, histogram->bins[i]);
+    }
+    return out;
+}
+
+size_t timer_trace_export(const timer_trace_report_t *report, uint8_t *out) {
+    uint8_t *p = put_u32(out, TIMER_TRACE_MAGIC);
+    p = put_u32(p, report->period);
+    p = put_u32(p, report->cycles_per_us);
+    p = put_u32(p, report->dropped);
+    p = put_histogram(p, &report->latency);
+    p = put_histogram(p, &report->jitter);
+    return (size_t)(p - out);
+}
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    bool ok;
+} reader_t;
+
+static uint32_t get_u32(reader_t *in) {
+    if (in->end - in->p < 4) {
+        in->ok = false;
+        return 0;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= (uint32_t)*in->p++ << (8 * i);
+    }
+    return value;
+}
+
+static uint32_t get_varint(reader_t *in) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (in->p == in->end) {
+            break;
+        }
+        uint8_t byte = *in->p++;
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    in->ok = false;
+    return 0;
+}
+
+static void get_histogram(reader_t *in, timer_trace_histogram_t *histogram) {
+    histogram->offset = (int32_t)get_u32(in);
+    histogram->width = get_u32(in);
+    histogram->count = get_u32(in);
+    histogram->min = (int32_t)get_u32(in);
+    histogram->max = (int32_t)get_u32(in);
+    uint64_t low = get_u32(in);
+    histogram->total = (int64_t)(low | (uint64_t)get_u32(in) << 32);
+    for (int i = 0; i < TIMER_TRACE_BINS; i++) {
+        histogram->bins[i] = get_varint(in);
+    }
+}
+
+bool timer_trace_import(timer_trace_report_t *report, const uint8_t *in, size_t size) {
+    reader_t reader = {in, in + size, true};
+    if (get_u32(&reader) != TIMER_TRACE_MAGIC) {
+        return false;
+    }
+    memset(report, 0, sizeof(*report));
+    report->period = get_u32(&reader);
+    report->cycles_per_us = get_u32(&reader);
+    report->dropped = get_u32(&reader);
+    get_histogram(&reader, &report->latency);
+    get_histogram(&reader, &report->jitter);
+    return reader.ok && reader.p == reader.end && report->latency.width > 0 && report->jitter.width > 0;
+}
@@ -0,0 +1,200 @@
+/**
+ * Opt-in arrival timing of a timer callback: latency and jitter histograms.
+ *
+ * The callback stamps each call with the CPU cycle counter it already reads
+ * (TIMER_TRACE_STAMP()). The stamps go through a single producer, single
+ * consumer ring buffer, like lib/sample_stream:
+ *
+ *  - the producer (the timer ISR) writes a stamp and publishes "head" with a
+ *    release store. The cost is bounded: a few loads and stores, no loops,
+ *    no floating point. When the ring is full the stamp is dropped (and
+ *    counted), it never waits.
+ *  - the consumer (a low-priority task) calls timer_trace_collect() often
+ *    enough to keep up (every TIMER_TRACE_RING stamps), which adds them to a
+ *    timer_trace_report_t:
+ *
+ *      latency   cycles between the time the call was due and the stamp.
+ *                The alarm time is not visible to the callback, so a call is
+ *                due a whole number of periods after the least late call
+ *                seen so far (latency 0)
+ *      jitter    the interval between two consecutive calls, minus the
+ *                period (negative when a call comes early)
+ *
+ *    Each is a histogram of TIMER_TRACE_BINS bins of the same width (the
+ *    first and last bins also hold everything below and above them), plus
+ *    the exact min, mean and max. timer_trace_percentile() reads e.g. the
+ *    p99 from the bins.
+ *
+ * timer_trace_export() packs a report into a compact binary frame (a fixed
+ * header, then the bins as varints, so empty bins take a byte) that the task
+ * can print or send, and timer_trace_import() unpacks it on the host.
+ *
+ * Everything compiles out unless the build defines TIMER_TRACE_ENABLED=1
+ * (e.g. build_flags = -D TIMER_TRACE_ENABLED=1): TIMER_TRACE_STAMP() is then
+ * empty, and the projects leave out the ring, the report and the task.
+ *
+ * @file timer_trace.h
+ * @author Philip Giacalone
+ */
+
+#ifndef TIMER_TRACE_H
+#define TIMER_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "isr_safe.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef TIMER_TRACE_ENABLED
+#define TIMER_TRACE_ENABLED     0
+#endif
+
+#ifndef TIMER_TRACE_RING_BITS
+#define TIMER_TRACE_RING_BITS   9       // 512 stamps (4 KB)
+#endif
+#define TIMER_TRACE_RING        (1 << TIMER_TRACE_RING_BITS)
+#define TIMER_TRACE_BINS        64
+#define TIMER_TRACE_MAGIC       0x31525454U     // "TTR1"
+// the largest frame from timer_trace_export()
+#define TIMER_TRACE_EXPORT_MAX  (16 + 2 * (28 + 5 * TIMER_TRACE_BINS))
+
+typedef struct {
+    // the callback's number, counting the dropped ones
+    uint32_t sequence;
+    uint32_t cycles;
+} timer_trace_stamp_t;
+
+typedef struct {
+    // --- written by the ISR ---
+    timer_trace_stamp_t ring[TIMER_TRACE_RING];
+    // stamps written
+    uint32_t head;
+    // callbacks stamped (or dropped)
+    uint32_t sequence;
+    // stamps that found the ring full
+    uint32_t dropped;
+
+    // --- written by the task ---
+    // stamps read
+    uint32_t tail;
+} timer_trace_t;
+
+typedef struct {
+    // bin i holds the values from offset + i * width, up to the next bin
+    int32_t offset;
+    uint32_t width;
+    uint32_t bins[TIMER_TRACE_BINS];
+    uint32_t count;
+    int32_t min;
+    int32_t max;
+    int64_t total;
+} timer_trace_histogram_t;
+
+typedef struct {
+    // cycles between calls, and per microsecond
+    uint32_t period;
+    uint32_t cycles_per_us;
+    timer_trace_histogram_t latency;
+    timer_trace_histogram_t jitter;
+    // stamps the ISR dropped
+    uint32_t dropped;
+
+    // the consumer's state: when the least late call was due, and the last stamp
+    uint32_t due_sequence;
+    uint32_t due_cycles;
+    uint32_t last_sequence;
+    uint32_t last_cycles;
+    uint32_t dropped_seen;
+    bool started;
+} timer_trace_report_t;
+
+/**
+ * @brief Empties the ring. Call before the timer starts.
+ */
+void timer_trace_init(timer_trace_t *trace);
+
+/**
+ * @brief Sets up an empty report
+ *
+ * @param period the cycles between calls (e.g. CPU MHz * microseconds per call)
+ * @param cycles_per_us the CPU MHz, to print the results in microseconds
+ * @param bin_width the cycles per bin. Latency bins start at 0, jitter bins
+ *        are centered on 0
+ */
+void timer_trace_report_init(timer_trace_report_t *report, uint32_t period, uint32_t cycles_per_us,
+                             uint32_t bin_width);
+
+/**
+ * @brief Empties the histograms (keeps the settings and when calls are due)
+ */
+void timer_trace_report_reset(timer_trace_report_t *report);
+
+/**
+ * @brief Consumer: adds the stamps in the ring to the report
+ *
+ * @return the number of stamps read
+ */
+uint32_t timer_trace_collect(timer_trace_t *trace, timer_trace_report_t *report);
+
+/**
+ * @brief The value (cycles) that permille / 1000 of the histogram is at or
+ * below, e.g. 990 for the p99. The upper edge of its bin.
+ */
+int32_t timer_trace_percentile(const timer_trace_histogram_t *histogram, uint32_t permille);
+
+/**
+ * @brief The mean of a histogram in cycles (0 when it is empty)
+ */
+int32_t timer_trace_mean(const timer_trace_histogram_t *histogram);
+
+/**
+ * @brief Packs a report into a binary frame (little endian)
+ *
+ * @param out at least TIMER_TRACE_EXPORT_MAX bytes
+ * @return the bytes written
+ */
+size_t timer_trace_export(const timer_trace_report_t *report, uint8_t *out);
+
+/**
+ * @brief Unpacks a frame from timer_trace_export() into the settings and
+ * histograms of a report
+ *
+ * @return false if the frame is not valid
+ */
+bool timer_trace_import(timer_trace_report_t *report, const uint8_t *in, size_t size);
+
+/**
+ * @brief ISR: stamps one call of the callback
+ *
+ * @param cycles isr_cycle_count() at the start of the callback
+ */
+ISR_INLINE void timer_trace_stamp(timer_trace_t *trace, uint32_t cycles) {
+    uint32_t head = trace->head;
+    uint32_t sequence = trace->sequence++;
+    if (head - __atomic_load_n(&trace->tail, __ATOMIC_ACQUIRE) >= TIMER_TRACE_RING) {
+        trace->dropped++;
+        return;
+    }
+    timer_trace_stamp_t *stamp = &trace->ring[head & (TIMER_TRACE_RING - 1)];
+    stamp->sequence = sequence;
+    stamp->cycles = cycles;
+    // the consumer may read the stamp from here on
+    __atomic_store_n(&trace->head, head + 1, __ATOMIC_RELEASE);
+}
+
+#if TIMER_TRACE_ENABLED
+#define TIMER_TRACE_STAMP(trace, cycles)    timer_trace_stamp((trace), (cycles))
+#else
+#define TIMER_TRACE_STAMP(trace, cycles)    ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMER_TRACE_H
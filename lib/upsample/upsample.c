@@ -0,0 +1,100 @@
+/**
+ * Polyphase FIR interpolator. See upsample.h
+ *
+ * @file upsample.c
+ * @author Philip Giacalone
+ */
+
+#include "upsample.h"
+
+#include <math.h>
+
+// the zeroth order modified Bessel function of the first kind (for the Kaiser window)
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+bool upsample_init(upsample_t *upsample, uint32_t factor, uint32_t taps, double cutoff) {
+    if (factor < 1 || factor > UPSAMPLE_MAX_FACTOR || taps < 1 || taps > UPSAMPLE_MAX_TAPS) {
+        return false;
+    }
+    upsample->factor = factor;
+    upsample->taps = taps;
+
+    // the prototype low-pass at the output rate: sinc cutting off at cutoff * (output rate / 2L)
+    uint32_t length = factor * taps;
+    double center = (length - 1) / 2.0;
+    double fc = cutoff / factor;
+    double window_norm = bessel_i0(UPSAMPLE_KAISER_BETA);
+    double h[UPSAMPLE_MAX_FACTOR * UPSAMPLE_MAX_TAPS];
+    for (uint32_t n = 0; n < length; n++) {
+        double t = n - center;
+        double sinc = t == 0 ? 1.0 : sin(M_PI * fc * t) / (M_PI * fc * t);
+        double r = length > 1 ? t / (length / 2.0) : 0.0;
+        double window = bessel_i0(UPSAMPLE_KAISER_BETA * sqrt(1.0 - r * r)) / window_norm;
+        h[n] = sinc * window;
+    }
+
+    // split into phases, each scaled to a gain of 1.0 and rounded to Q14
+    const double one = 1 << UPSAMPLE_COEF_BITS;
+    for (uint32_t j = 0; j < factor; j++) {
+        double gain = 0.0;
+        for (uint32_t k = 0; k < taps; k++) {
+            gain += h[k * factor + j];
+        }
+        int32_t sum = 0;
+        uint32_t largest = 0;
+        int16_t *phase = &upsample->coefficients[j * taps];
+        for (uint32_t k = 0; k < taps; k++) {
+            phase[k] = (int16_t)lround(h[k * factor + j] / gain * one);
+            sum += phase[k];
+            largest = fabs(h[k * factor + j]) > fabs(h[largest * factor + j]) ? k : largest;
+        }
+        // the rounding error goes to the largest coefficient, so the gain is exactly 1.0
+        phase[largest] += (int16_t)((int32_t)one - sum);
+    }
+
+    upsample_reset(upsample);
+    return true;
+}
+
+void upsample_reset(upsample_t *upsample) {
+    for (uint32_t i = 0; i < 2 * UPSAMPLE_MAX_TAPS; i++) {
+        upsample->history[i] = 0;
+    }
+    upsample->position = 0;
+}
+
+double upsample_delay(const upsample_t *upsample) {
+    return (upsample->factor * upsample->taps - 1) / 2.0;
+}
+
+void upsample_process(upsample_t *upsample, const int16_t *input, uint32_t count, int16_t *output) {
+    const uint32_t factor = upsample->factor;
+    const uint32_t taps = upsample->taps;
+    const int32_t round = 1 << (UPSAMPLE_COEF_BITS - 1);
+
+    for (uint32_t i = 0; i < count; i++) {
+        // newest first: history[position] is x[n], history[position + k] is x[n - k]
+        upsample->position = upsample->position == 0 ? taps - 1 : upsample->position - 1;
+        upsample->history[upsample->position] = input[i];
+        upsample->history[upsample->position + taps] = input[i];
+        const int16_t *x = &upsample->history[upsample->position];
+
+        const int16_t *h = upsample->coefficients;
+        for (uint32_t j = 0; j < factor; j++, h += taps) {
+            int32_t sum = round;
+            for (uint32_t k = 0; k < taps; k++) {
+                sum += (int32_t)h[k] * x[k];
+            }
+            sum >>= UPSAMPLE_COEF_BITS;
+            *output++ = (int16_t)(sum > INT16_MAX ? INT16_MAX : (sum < INT16_MIN ? INT16_MIN : sum));
+        }
+    }
+}
@@ -0,0 +1,95 @@
+/**
+ * Fixed-point polyphase FIR interpolator: raises the sample rate of a Q15
+ * signal by a whole factor L, so a waveform can be computed (or stored) at
+ * sample_rate / L and still be played at sample_rate.
+ *
+ * Upsampling inserts L - 1 zeros after every input sample and low-pass filters
+ * the result, which removes the images of the signal around multiples of the
+ * input rate. Most of the filter's inputs are those zeros, so the filter is
+ * split into L phases of `taps` coefficients each. Output j (0 to L - 1) after
+ * an input sample is
+ *
+ *   y = sum over k of h[k L + j] * x[n - k]
+ *
+ * which costs `taps` multiply-adds per output sample, whatever L is.
+ *
+ * The prototype filter is a Kaiser windowed sinc of L * taps coefficients,
+ * designed once in upsample_init(). Each phase is scaled to a gain of exactly
+ * 1.0, so a constant input comes out constant (no ripple at the input rate).
+ * More taps give a sharper cutoff and deeper image rejection
+ * (see bench_upsample.c in ESP32_waveform_benchmarks).
+ *
+ * Samples are int16_t (Q15), coefficients are Q14 and the sums are int32_t.
+ * The output is clamped to the int16_t range, since the filter overshoots a
+ * little at full scale edges. Center a signal on 0 before upsampling it.
+ *
+ * upsample_process() works on blocks, and belongs in a render task (see
+ * lib/block_buffer), not in the timer callback.
+ *
+ * @file upsample.h
+ * @author Philip Giacalone
+ */
+
+#ifndef UPSAMPLE_H
+#define UPSAMPLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef UPSAMPLE_MAX_FACTOR
+#define UPSAMPLE_MAX_FACTOR 8       // the largest interpolation factor L
+#endif
+#ifndef UPSAMPLE_MAX_TAPS
+#define UPSAMPLE_MAX_TAPS   16      // the most coefficients per phase (the int32_t sums have room for 16)
+#endif
+#define UPSAMPLE_COEF_BITS  14      // coefficients are Q14 (a phase's largest coefficient can be about 1.0)
+#define UPSAMPLE_KAISER_BETA 8.0    // about 80 dB of stopband attenuation, given enough taps
+
+typedef struct {
+    uint32_t factor;        // L, output samples per input sample
+    uint32_t taps;          // coefficients per phase
+    // phase j's coefficients are coefficients[j * taps] to coefficients[j * taps + taps - 1]
+    int16_t coefficients[UPSAMPLE_MAX_FACTOR * UPSAMPLE_MAX_TAPS];
+    // the last `taps` inputs, twice, so the newest ones are always history[position] onward
+    int16_t history[2 * UPSAMPLE_MAX_TAPS];
+    uint32_t position;
+} upsample_t;
+
+/**
+ * @brief Designs the filter and clears the history. Floating point, call once at startup.
+ *
+ * @param factor L, between 1 and UPSAMPLE_MAX_FACTOR
+ * @param taps coefficients per phase, between 1 and UPSAMPLE_MAX_TAPS
+ * @param cutoff the end of the passband, as a fraction of the input Nyquist
+ *               frequency (input rate / 2). e.g. 0.8 passes up to 0.4 x the input rate
+ * @return false if the factor or the taps are out of range
+ */
+bool upsample_init(upsample_t *upsample, uint32_t factor, uint32_t taps, double cutoff);
+
+/**
+ * @brief Clears the history (the next outputs are as if the input had been 0)
+ */
+void upsample_reset(upsample_t *upsample);
+
+/**
+ * @brief Returns the delay through the filter, in output samples
+ */
+double upsample_delay(const upsample_t *upsample);
+
+/**
+ * @brief Upsamples a block
+ *
+ * @param input count samples at the input rate
+ * @param output room for count * factor samples at the output rate
+ */
+void upsample_process(upsample_t *upsample, const int16_t *input, uint32_t count, int16_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UPSAMPLE_H
@@ -0,0 +1,314 @@
+/**
+ * A bounded cache of rendered wave tables, keyed by the waveform parameters
+ * (shape, frequency, amplitude, sample rate), with least recently used (LRU)
+ * eviction.
+ *
+ * Switching among a working set of presets then costs a hash lookup (O(1))
+ * instead of rebuilding the table. Only a miss renders (with
+ * wave_table::renderWaveCycle(), band-limited to the key's frequency), into
+ * the least recently used table.
+ *
+ * The tables are played by a timer ISR (dds_table_player_t), so:
+ *  - get() is called from a task, never from the ISR. A miss renders in the
+ *    caller's task (a few ms for 1024 entries), while the ISR keeps playing
+ *    the current table.
+ *  - the table passed to setPlaying() and the one before it are never
+ *    evicted, so a table cannot be overwritten while the ISR may still read it.
+ *  - everything is in fixed arrays (DRAM on the ESP32). The render scratch
+ *    space is allocated only during a miss.
+ *
+ * Example:
+ *
+ *   wave_cache::Cache<1024, 8> cache;
+ *   const uint8_t *table = cache.get({wave_table::Shape::Square, 440.0f, 0.5f, 100000.0f});
+ *   cache.setPlaying(table);
+ *   dds_table_select(&player, table, 440.0, 100000.0);
+ *
+ * Requires C++14 or later.
+ *
+ * @file wave_cache.h
+ * @author Philip Giacalone
+ */
+
+#ifndef WAVE_CACHE_H
+#define WAVE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <new>
+
+#include "wave_table.h"
+
+namespace wave_cache {
+
+/**
+ * @brief The parameters a table is rendered from. Compared exactly.
+ */
+struct Key {
+    wave_table::Shape shape;
+    // the playback frequency in Hz (sets the band limit)
+    float frequency;
+    // attenuation, between 0.0 and 1.0
+    float amplitude;
+    // the playback sample rate
+    float sampleRate;
+
+    bool operator==(const Key &other) const {
+        return shape == other.shape && frequency == other.frequency &&
+               amplitude == other.amplitude && sampleRate == other.sampleRate;
+    }
+};
+
+// FNV-1a over the key's fields
+inline uint32_t hash(const Key &key) {
+    uint32_t words[4] = {(uint32_t)key.shape, 0, 0, 0};
+    memcpy(&words[1], &key.frequency, sizeof(float));
+    memcpy(&words[2], &key.amplitude, sizeof(float));
+    memcpy(&words[3], &key.sampleRate, sizeof(float));
+    uint32_t h = 2166136261UL;
+    for (uint32_t word : words) {
+        for (int byte = 0; byte < 4; byte++) {
+            h = (h ^ ((word >> (8 * byte)) & 0xFF)) * 16777619UL;
+        }
+    }
+    return h;
+}
+
+struct Stats {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+};
+
+/**
+ * @tparam N entries per table (a power of 2, for the DDS table player)
+ * @tparam CAPACITY the most tables kept at once (at least 3)
+ */
+template <size_t N, size_t CAPACITY>
+class Cache {
+public:
+    static_assert(CAPACITY >= 3, "the playing and previous tables are pinned, so keep at least 3");
+    static_assert(CAPACITY < 0x7FFF, "entries are indexed with int16_t");
+
+    /**
+     * @param maxAmplitude half of the DAC's peak-to-peak range (127 for 8 bits)
+     */
+    explicit Cache(int maxAmplitude = 127) : maxAmplitude_(maxAmplitude) {
+        clear();
+    }
+
+    /**
+     * @brief Empties the cache (the tables stay allocated)
+     */
+    void clear() {
+        for (size_t i = 0; i < SLOTS; i++) {
+            slots_[i] = EMPTY;
+        }
+        for (size_t i = 0; i < CAPACITY; i++) {
+            used_[i] = false;
+        }
+        head_ = tail_ = EMPTY;
+        count_ = 0;
+        playing_ = previous_ = EMPTY;
+        stats_ = Stats{};
+    }
+
+    /**
+     * @brief Returns the table for a key if it is cached (and marks it most
+     * recently used), otherwise nullptr. O(1), never renders.
+     */
+    const uint8_t *find(const Key &key) {
+        int16_t entry = lookup(key);
+        if (entry == EMPTY) {
+            return nullptr;
+        }
+        touch(entry);
+        return tables_[entry].values;
+    }
+
+    /**
+     * @brief Returns the table for a key, rendering it on a miss (into the
+     * least recently used table that is not playing). Call from a task.
+     *
+     * @return the table, or nullptr if the scratch space could not be allocated
+     */
+    const uint8_t *get(const Key &key) {
+        const uint8_t *table = find(key);
+        if (table != nullptr) {
+            stats_.hits++;
+            return table;
+        }
+        stats_.misses++;
+
+        std::unique_ptr<Scratch> scratch(new (std::nothrow) Scratch);
+        if (!scratch) {
+            return nullptr;
+        }
+        int16_t entry = allocate();
+        wave_table::renderWaveCycle(tables_[entry], scratch->wave, scratch->im, key.shape,
+                                    wave_table::maxHarmonic(key.frequency, key.sampleRate),
+                                    key.amplitude, maxAmplitude_);
+        keys_[entry] = key;
+        used_[entry] = true;
+        insert(entry);
+        pushFront(entry);
+        count_++;
+        return tables_[entry].values;
+    }
+
+    /**
+     * @brief Marks the table that the ISR is now playing. It and the table
+     * that was playing before are not evicted.
+     */
+    void setPlaying(const uint8_t *table) {
+        for (size_t i = 0; i < CAPACITY; i++) {
+            if (used_[i] && tables_[i].values == table) {
+                if ((int16_t)i != playing_) {
+                    previous_ = playing_;
+                    playing_ = (int16_t)i;
+                }
+                return;
+            }
+        }
+    }
+
+    size_t size() const { return count_; }
+
+    static constexpr size_t capacity() { return CAPACITY; }
+
+    const Stats &stats() const { return stats_; }
+
+private:
+    static constexpr int16_t EMPTY = -1;
+
+    // open addressing slots: a power of 2, at least twice CAPACITY
+    static constexpr size_t slotCount() {
+        size_t slots = 1;
+        while (slots < 2 * CAPACITY) {
+            slots <<= 1;
+        }
+        return slots;
+    }
+    static constexpr size_t SLOTS = slotCount();
+
+    struct Scratch {
+        wave_table::Table<double, N> wave;
+        wave_table::Table<double, N> im;
+    };
+
+    // the entry holding a key, or EMPTY
+    int16_t lookup(const Key &key) const {
+        for (size_t slot = hash(key) & (SLOTS - 1);; slot = (slot + 1) & (SLOTS - 1)) {
+            int16_t entry = slots_[slot];
+            if (entry == EMPTY || keys_[entry] == key) {
+                return entry;
+            }
+        }
+    }
+
+    void insert(int16_t entry) {
+        size_t slot = hash(keys_[entry]) & (SLOTS - 1);
+        while (slots_[slot] != EMPTY) {
+            slot = (slot + 1) & (SLOTS - 1);
+        }
+        slots_[slot] = entry;
+    }
+
+    // removes an entry's slot, shifting later entries of the same probe run back
+    void erase(int16_t entry) {
+        size_t slot = hash(keys_[entry]) & (SLOTS - 1);
+        while (slots_[slot] != entry) {
+            slot = (slot + 1) & (SLOTS - 1);
+        }
+        size_t next = slot;
+        while (true) {
+            next = (next + 1) & (SLOTS - 1);
+            int16_t moved = slots_[next];
+            if (moved == EMPTY) {
+                break;
+            }
+            size_t home = hash(keys_[moved]) & (SLOTS - 1);
+            // move it back unless its home slot lies cyclically in (slot, next]
+            bool stays = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+            if (!stays) {
+                slots_[slot] = moved;
+                slot = next;
+            }
+        }
+        slots_[slot] = EMPTY;
+    }
+
+    // an unused entry, or the least recently used one that is not pinned
+    int16_t allocate() {
+        for (size_t i = 0; i < CAPACITY; i++) {
+            if (!used_[i]) {
+                return (int16_t)i;
+            }
+        }
+        int16_t victim = tail_;
+        while (victim == playing_ || victim == previous_) {
+            victim = prev_[victim];
+        }
+        unlink(victim);
+        erase(victim);
+        used_[victim] = false;
+        count_--;
+        stats_.evictions++;
+        return victim;
+    }
+
+    void unlink(int16_t entry) {
+        if (prev_[entry] != EMPTY) {
+            next_[prev_[entry]] = next_[entry];
+        } else {
+            head_ = next_[entry];
+        }
+        if (next_[entry] != EMPTY) {
+            prev_[next_[entry]] = prev_[entry];
+        } else {
+            tail_ = prev_[entry];
+        }
+    }
+
+    void pushFront(int16_t entry) {
+        prev_[entry] = EMPTY;
+        next_[entry] = head_;
+        if (head_ != EMPTY) {
+            prev_[head_] = entry;
+        }
+        head_ = entry;
+        if (tail_ == EMPTY) {
+            tail_ = entry;
+        }
+    }
+
+    // marks an entry most recently used
+    void touch(int16_t entry) {
+        if (entry != head_) {
+            unlink(entry);
+            pushFront(entry);
+        }
+    }
+
+    wave_table::Table<uint8_t, N> tables_[CAPACITY];
+    Key keys_[CAPACITY];
+    bool used_[CAPACITY];
+    // the LRU list, most recently used first
+    int16_t prev_[CAPACITY];
+    int16_t next_[CAPACITY];
+    int16_t head_;
+    int16_t tail_;
+    int16_t slots_[SLOTS];
+    size_t count_;
+    int16_t playing_;
+    int16_t previous_;
+    int maxAmplitude_;
+    Stats stats_;
+};
+
+} // namespace wave_cache
+
+#endif // WAVE_CACHE_H
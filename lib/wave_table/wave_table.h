@@ -0,0 +1,543 @@
+/**
+ * Compile-time (constexpr) generation of waveform tables.
+ *
+ * Replaces filling an int array with sin() calls at boot (populateWaveArray()).
+ * The table is computed by the compiler, stored as uint8_t (one byte per 8-bit
+ * DAC sample instead of a 4-byte int) and the configuration is checked with
+ * static_assert instead of at runtime.
+ *
+ * Example:
+ *
+ *   WAVE_TABLE_ATTR constexpr auto waveValues =
+ *       wave_table::makeSineTable<FREQUENCY, SAMPLES_PER_SECOND>(ATTENUATION);
+ *
+ * makeSineTable() holds exactly SAMPLES_PER_SECOND / FREQUENCY samples, so the
+ * frequency is truncated when it does not divide the sample rate. For any
+ * frequency, build a fixed size cycle with makeSineCycle<N>() and play it with
+ * a fractional phase increment (see dds_table_player_t in lib/dds).
+ *
+ * Square, triangle, sawtooth and pulse cycles come from makeWaveCycle<N>().
+ * They are band-limited: each is the Fourier series of the shape summed up to
+ * a chosen harmonic (by an inverse FFT at compile time), so nothing above
+ * Nyquist folds back (aliases) when the harmonic count is at most
+ * maxHarmonic(frequency, sample rate). Playing them costs one table read per
+ * sample, the same as the sine.
+ *
+ * A single band-limited table only suits frequencies up to the one it was
+ * built for. makeMipMap<N>() builds one table per octave of the playback
+ * frequency, each with half the harmonics of the one below, for a player
+ * that picks the level from its phase increment (dds_mipmap_player_t in
+ * lib/dds). It takes about 7N bytes (7104 for N = 1024) and does not alias at any frequency.
+ *
+ * Sine, square and triangle cycles are quarter-wave symmetric, so
+ * makeQuarterCycle<T, N>() can store just their first quarter (N / 4 + 1
+ * entries, as uint8_t or uint16_t) for a player that reflects it
+ * (dds_quarter_player_t in lib/dds).
+ *
+ * Placement: the table is const, so it stays in flash (.rodata) by default.
+ * Build with -D WAVE_TABLE_IN_DRAM=1 to place it in DRAM instead (readable
+ * while the flash cache is disabled, e.g. from an IRAM interrupt handler).
+ *
+ * Requires C++14 or later (loops in constexpr functions).
+ *
+ * @file wave_table.h
+ * @author Philip Giacalone
+ */
+
+#ifndef WAVE_TABLE_H
+#define WAVE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if WAVE_TABLE_IN_DRAM && defined(ESP_PLATFORM)
+#include "esp_attr.h"
+#define WAVE_TABLE_ATTR     DRAM_ATTR
+#else
+#define WAVE_TABLE_ATTR
+#endif
+
+namespace wave_table {
+
+constexpr double PI_ = 3.14159265358979323846;
+
+/**
+ * @brief sin(x) that the compiler can evaluate (std::sin is not constexpr)
+ *
+ * Reduces x to [-π/2, π/2] and sums the Taylor series (error < 1e-12).
+ */
+constexpr double sine(double x) {
+    const double twoPi = 2.0 * PI_;
+    x -= twoPi * (long long)(x / twoPi);
+    if (x > PI_) {
+        x -= twoPi;
+    } else if (x < -PI_) {
+        x += twoPi;
+    }
+    if (x > PI_ / 2) {
+        x = PI_ - x;
+    } else if (x < -PI_ / 2) {
+        x = -PI_ - x;
+    }
+    double x2 = x * x;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x2 / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+/**
+ * @brief A fixed size table of samples that can be built at compile time
+ */
+template <typename T, size_t N>
+struct Table {
+    T values[N];
+
+    static constexpr size_t size() { return N; }
+
+    constexpr const T &operator[](size_t i) const { return values[i]; }
+};
+
+/**
+ * @brief Returns true if the attenuation is between 0.0 and 1.0
+ */
+constexpr bool validAttenuation(double attenuation) {
+    return attenuation >= 0.0 && attenuation <= 1.0;
+}
+
+/**
+ * @brief Returns true if the frequency is positive and satisfies Nyquist
+ */
+constexpr bool validFrequency(double frequency, double samplesPerSecond) {
+    return frequency > 0.0 && samplesPerSecond >= 2.0 * frequency;
+}
+
+/**
+ * @brief Builds one cycle of a sine wave with N entries as 8-bit DAC values:
+ *
+ *   value = maxAmplitude * attenuation * (verticalOffset + sin(2πi / N))
+ *
+ * @tparam N the number of entries (a power of 2 for the DDS table player)
+ * @param attenuation between 0.0 and 1.0 (check it with validAttenuation())
+ * @param maxAmplitude half of the DAC's peak-to-peak range (127 for 8 bits)
+ * @param verticalOffset 1.0 to avoid negative outputs
+ */
+template <size_t N>
+constexpr Table<uint8_t, N> makeSineCycle(double attenuation, int maxAmplitude = 127,
+                                          double verticalOffset = 1.0) {
+    static_assert(N >= 2, "a cycle needs at least 2 samples");
+
+    Table<uint8_t, N> table{};
+    for (size_t i = 0; i < N; i++) {
+        double angle = 2.0 * PI_ * (double)i / (double)N;
+        // truncated, the same as the runtime version
+        table.values[i] = (uint8_t)(long)(maxAmplitude * attenuation * (verticalOffset + sine(angle)));
+    }
+    return table;
+}
+
+/**
+ * @brief The shapes that makeWaveCycle() can build
+ */
+enum class Shape {
+    Sine,
+    Square,
+    Triangle,
+    Sawtooth,   // rising ramp
+    Pulse       // square wave with a variable duty cycle
+};
+
+/**
+ * @brief Returns the highest harmonic of a frequency that is below Nyquist
+ * (half the sample rate), i.e. the most harmonics a band-limited table can
+ * hold without aliasing when it is played at that frequency.
+ */
+constexpr int maxHarmonic(double frequency, double samplesPerSecond) {
+    return frequency > 0.0 ? (int)((samplesPerSecond / 2.0) / frequency - 1e-9) : 0;
+}
+
+/**
+ * @brief Turns a spectrum into one cycle of a waveform, in place:
+ *
+ *   re[i] = Re( Σ (re[k] + j im[k]) e^(j2πki / N) )
+ *
+ * A radix 2 inverse FFT, so a 1024 entry table takes about N log2(N)
+ * butterflies at compile time instead of N x harmonics sine() calls.
+ */
+template <size_t N>
+constexpr void inverseFft(Table<double, N> &re, Table<double, N> &im) {
+    static_assert((N & (N - 1)) == 0, "N must be a power of 2");
+
+    // bit reversed order
+    for (size_t i = 1, j = 0; i < N; i++) {
+        size_t bit = N >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double r = re.values[i];
+            double m = im.values[i];
+            re.values[i] = re.values[j];
+            im.values[i] = im.values[j];
+            re.values[j] = r;
+            im.values[j] = m;
+        }
+    }
+    for (size_t len = 2; len <= N; len <<= 1) {
+        for (size_t k = 0; k < len / 2; k++) {
+            double angle = 2.0 * PI_ * (double)k / (double)len;
+            double wr = sine(angle + PI_ / 2);
+            double wi = sine(angle);
+            for (size_t a = k; a < N; a += len) {
+                size_t b = a + len / 2;
+                double tr = re.values[b] * wr - im.values[b] * wi;
+                double ti = re.values[b] * wi + im.values[b] * wr;
+                re.values[b] = re.values[a] - tr;
+                im.values[b] = im.values[a] - ti;
+                re.values[a] += tr;
+                im.values[a] += ti;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Returns the largest magnitude in a table
+ */
+template <size_t N>
+constexpr double peakOf(const Table<double, N> &wave) {
+    double peak = 0.0;
+    for (size_t i = 0; i < N; i++) {
+        double magnitude = wave.values[i] < 0.0 ? -wave.values[i] : wave.values[i];
+        if (magnitude > peak) {
+            peak = magnitude;
+        }
+    }
+    return peak;
+}
+
+/**
+ * @brief Computes one cycle of a band-limited shape (see makeWaveCycle()) into wave,
+ * scaled so that its peak is 1.0 (unless normalize is false). im is scratch space.
+ */
+template <size_t N>
+constexpr void renderWave(Table<double, N> &wave, Table<double, N> &im, Shape shape, int harmonics,
+                          double duty = 0.5, bool normalize = true) {
+    if (shape == Shape::Sine) {
+        for (size_t i = 0; i < N; i++) {
+            wave.values[i] = sine(2.0 * PI_ * (double)i / (double)N);
+        }
+        return;
+    }
+    // the table cannot hold a harmonic at or above N/2 (its own Nyquist limit)
+    if (harmonics > (int)(N / 2) - 1) {
+        harmonics = (int)(N / 2) - 1;
+    }
+
+    // the spectrum: re[k] - j im[k] becomes re[k] cos(kx) + im[k] sin(kx)
+    for (size_t i = 0; i < N; i++) {
+        wave.values[i] = 0.0;
+        im.values[i] = 0.0;
+    }
+    if (shape == Shape::Pulse) {
+        wave.values[0] = 2.0 * duty - 1.0;
+    }
+    for (int k = 1; k <= harmonics; k++) {
+        double sine_k = 0.0;     // coefficient of sin(kx)
+        double cosine_k = 0.0;   // coefficient of cos(kx)
+        switch (shape) {
+            case Shape::Square:
+                sine_k = k % 2 == 1 ? 4.0 / (PI_ * k) : 0.0;
+                break;
+            case Shape::Triangle:
+                sine_k = k % 2 == 1 ? (k % 4 == 1 ? 8.0 : -8.0) / (PI_ * PI_ * k * k) : 0.0;
+                break;
+            case Shape::Sawtooth:
+                sine_k = (k % 2 == 1 ? 2.0 : -2.0) / (PI_ * k);
+                break;
+            case Shape::Pulse:
+                // 4/(πk) sin(πkd) cos(k(x - πd)), expanded
+                cosine_k = 2.0 * sine(2.0 * PI_ * k * duty) / (PI_ * k);
+                sine_k = 2.0 * (1.0 - sine(2.0 * PI_ * k * duty + PI_ / 2)) / (PI_ * k);
+                break;
+            default:
+                break;
+        }
+        wave.values[k] = cosine_k;
+        im.values[k] = -sine_k;
+    }
+    inverseFft(wave, im);
+    if (!normalize) {
+        return;
+    }
+
+    double peak = peakOf(wave);
+    for (size_t i = 0; i < N; i++) {
+        wave.values[i] = peak > 0.0 ? wave.values[i] / peak : 0.0;
+    }
+}
+
+/**
+ * @brief Does the work of makeWaveCycle() (see below) into existing storage,
+ * for rendering tables at runtime (see lib/wave_cache). The two double tables are scratch space
+ * (16 bytes per entry), so they can be allocated only while rendering
+ * instead of on a small task stack.
+ */
+template <size_t N>
+constexpr void renderWaveCycle(Table<uint8_t, N> &table, Table<double, N> &wave, Table<double, N> &im,
+                               Shape shape, int harmonics, double attenuation,
+                               int maxAmplitude = 127, double verticalOffset = 1.0, double duty = 0.5) {
+    if (shape == Shape::Sine) {
+        table = makeSineCycle<N>(attenuation, maxAmplitude, verticalOffset);
+        return;
+    }
+    renderWave(wave, im, shape, harmonics, duty);
+    for (size_t i = 0; i < N; i++) {
+        // truncated, the same as makeSineCycle()
+        table.values[i] = (uint8_t)(long)(maxAmplitude * attenuation * (verticalOffset + wave.values[i]));
+    }
+}
+
+/**
+ * @brief Builds one cycle of a band-limited waveform with N entries as 8-bit
+ * DAC values:
+ *
+ *   value = maxAmplitude * attenuation * (verticalOffset + wave(2πi / N))
+ *
+ * The wave is the Fourier series of the shape, summed up to the given
+ * harmonic:
+ *
+ *   square   = 4/π  * Σ sin(kx) / k                  (odd k)
+ *   triangle = 8/π² * Σ ±sin(kx) / k²                (odd k, alternating signs)
+ *   sawtooth = 2/π  * Σ ±sin(kx) / k                 (all k, alternating signs)
+ *   pulse    = 2d-1 + 4/π * Σ sin(πkd) cos(k(x - πd)) / k
+ *
+ * It is scaled so that its peak (including the Gibbs overshoot of the
+ * square, sawtooth and pulse) is exactly 1.0, so the table never clips.
+ * Shape::Sine gives the same table as makeSineCycle().
+ *
+ * @tparam N the number of entries (a power of 2)
+ * @param shape the waveform
+ * @param harmonics the highest harmonic to include. at most maxHarmonic() of
+ *                  the playback frequency to avoid aliasing. limited to N/2 - 1
+ * @param attenuation between 0.0 and 1.0 (check it with validAttenuation())
+ * @param maxAmplitude half of the DAC's peak-to-peak range (127 for 8 bits)
+ * @param verticalOffset 1.0 to avoid negative outputs
+ * @param duty Pulse only: the fraction of the cycle that is high (0.0 to 1.0)
+ */
+template <size_t N>
+constexpr Table<uint8_t, N> makeWaveCycle(Shape shape, int harmonics, double attenuation,
+                                          int maxAmplitude = 127, double verticalOffset = 1.0,
+                                          double duty = 0.5) {
+    if (shape == Shape::Sine) {
+        return makeSineCycle<N>(attenuation, maxAmplitude, verticalOffset);
+    }
+    Table<uint8_t, N> table{};
+    Table<double, N> wave{};
+    Table<double, N> im{};
+    renderWaveCycle(table, wave, im, shape, harmonics, attenuation, maxAmplitude, verticalOffset, duty);
+    return table;
+}
+
+/**
+ * @brief Returns true if a shape can be stored as a quarter of a cycle (makeQuarterCycle()):
+ * the second quarter mirrors the first, and the second half is the first one upside down.
+ */
+constexpr bool quarterSymmetric(Shape shape) {
+    return shape == Shape::Sine || shape == Shape::Square || shape == Shape::Triangle;
+}
+
+/**
+ * @brief The bits below one DAC step in a quarter table of T (8 for uint16_t, 0 for uint8_t)
+ */
+template <typename T>
+constexpr int quarterFractionBits() {
+    return sizeof(T) > 1 ? 8 : 0;
+}
+
+/**
+ * @brief Returns the value at the midpoint of a full cycle table (makeSineCycle(), makeWaveCycle(),
+ * renderWaveCycle()), which is its value at phase 0 for all the shapes but Pulse:
+ *
+ *   middle = maxAmplitude * attenuation * verticalOffset
+ */
+constexpr long cycleMiddle(double attenuation, int maxAmplitude = 127, double verticalOffset = 1.0) {
+    // truncated, the same as the table entries
+    return (long)(maxAmplitude * attenuation * verticalOffset);
+}
+
+/**
+ * @brief Returns the value at the midpoint of the cycle that a quarter table is played around
+ * (the middle of dds_quarter_init() in lib/dds), in the table's units:
+ *
+ *   middle = maxAmplitude * attenuation * verticalOffset
+ */
+template <typename T>
+constexpr long quarterMiddle(double attenuation, int maxAmplitude = 127, double verticalOffset = 1.0) {
+    // rounded, like the table entries, so the errors of the two halves do not add up
+    return (long)(maxAmplitude * attenuation * verticalOffset * (double)(1L << quarterFractionBits<T>()) + 0.5);
+}
+
+/**
+ * @brief Builds the first quarter of a cycle of a quarter-wave symmetric shape (quarterSymmetric()),
+ * N / 4 + 1 entries, as the distance from the midpoint:
+ *
+ *   value = maxAmplitude * attenuation * wave(2πi / N)        i = 0 to N / 4
+ *
+ * The player (dds_quarter_player_t in lib/dds) rebuilds the rest of the cycle: the second quarter
+ * by reading the table backwards, the second half by subtracting from the midpoint (see
+ * quarterMiddle()). A table of uint8_t takes N / 4 + 1 bytes instead of N. A table of uint16_t
+ * holds 8 more bits below the DAC step (quarterFractionBits()), which the player rounds off.
+ *
+ * @tparam T uint8_t or uint16_t
+ * @tparam N the number of entries of the whole cycle (a power of 2, at least 4)
+ * @param shape Sine, Square or Triangle (any other shape gives a sine, check it with quarterSymmetric())
+ * @param harmonics the highest harmonic to include (see makeWaveCycle())
+ * @param attenuation between 0.0 and 1.0 (check it with validAttenuation())
+ * @param maxAmplitude half of the DAC's peak-to-peak range (127 for 8 bits)
+ */
+template <typename T, size_t N>
+constexpr Table<T, N / 4 + 1> makeQuarterCycle(Shape shape, int harmonics, double attenuation,
+                                               int maxAmplitude = 127) {
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "N must be a power of 2, at least 4");
+
+    Table<T, N / 4 + 1> table{};
+    Table<double, N> wave{};
+    Table<double, N> im{};
+    renderWave(wave, im, quarterSymmetric(shape) ? shape : Shape::Sine, harmonics);
+    double scale = maxAmplitude * attenuation * (double)(1L << quarterFractionBits<T>());
+    for (size_t i = 0; i <= N / 4; i++) {
+        // rounding noise can leave values just below 0 at the zero crossing
+        double value = wave.values[i] > 0.0 ? scale * wave.values[i] : 0.0;
+        table.values[i] = (T)(long)(value + 0.5);
+    }
+    return table;
+}
+
+/**
+ * @brief Returns log2 of a power of 2
+ */
+constexpr size_t log2Of(size_t n) {
+    size_t bits = 0;
+    while (n > 1) {
+        n >>= 1;
+        bits++;
+    }
+    return bits;
+}
+
+/**
+ * @brief The number of levels of a mipmap with N entries in level 0: log2(N)
+ */
+template <size_t N>
+constexpr size_t mipMapLevels() {
+    return log2Of(N);
+}
+
+/**
+ * @brief The number of entries of a level of a mipmap: 64 per harmonic, at most N
+ * (the same layout as dds_mipmap_entries() in lib/dds)
+ */
+template <size_t N>
+constexpr size_t mipMapEntries(size_t level) {
+    return level > 5 ? (size_t)1 << (log2Of(N) + 5 - level) : N;
+}
+
+/**
+ * @brief The harmonics of a level of a mipmap: 2^(log2(N) - 1 - level), at most N/2 - 1.
+ * Level i is played while the frequency is below sampleRate / 2^(log2(N) - i), so the
+ * highest harmonic stays below Nyquist.
+ */
+template <size_t N>
+constexpr int mipMapHarmonics(size_t level) {
+    return level == 0 ? (int)(N / 2) - 1 : 1 << (log2Of(N) - 1 - level);
+}
+
+/**
+ * @brief The total number of entries of a mipmap
+ */
+template <size_t N>
+constexpr size_t mipMapSize() {
+    size_t size = 0;
+    for (size_t level = 0; level < mipMapLevels<N>(); level++) {
+        size += mipMapEntries<N>(level);
+    }
+    return size;
+}
+
+/**
+ * @brief Builds a mipmap of a band-limited shape as 8-bit DAC values: one cycle per octave of
+ * the playback frequency (see mipMapHarmonics()), level 0 first, for dds_mipmap_player_t.
+ *
+ *   value = maxAmplitude * attenuation * (verticalOffset + wave(2πi / entries) / peak)
+ *
+ * Every level is scaled by the same peak (the largest of all levels), so the fundamental keeps
+ * its amplitude when the player changes level. A level with fewer harmonics is taken from a
+ * cycle of N entries, every N / entries-th one.
+ *
+ * @tparam N the number of entries of level 0 (a power of 2, at least 4)
+ * @param shape the waveform (a Sine is the same at every level)
+ * @param attenuation between 0.0 and 1.0 (check it with validAttenuation())
+ * @param maxAmplitude half of the DAC's peak-to-peak range (127 for 8 bits)
+ * @param verticalOffset 1.0 to avoid negative outputs
+ * @param duty Pulse only: the fraction of the cycle that is high (0.0 to 1.0)
+ */
+template <size_t N>
+constexpr Table<uint8_t, mipMapSize<N>()> makeMipMap(Shape shape, double attenuation, int maxAmplitude = 127,
+                                                     double verticalOffset = 1.0, double duty = 0.5) {
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "N must be a power of 2, at least 4");
+
+    Table<uint8_t, mipMapSize<N>()> table{};
+    Table<double, N> wave{};
+    Table<double, N> im{};
+    double peak = 0.0;
+    for (size_t level = 0; level < mipMapLevels<N>(); level++) {
+        renderWave(wave, im, shape, mipMapHarmonics<N>(level), duty, false);
+        double levelPeak = peakOf(wave);
+        peak = levelPeak > peak ? levelPeak : peak;
+    }
+    size_t offset = 0;
+    for (size_t level = 0; level < mipMapLevels<N>(); level++) {
+        renderWave(wave, im, shape, mipMapHarmonics<N>(level), duty, false);
+        size_t entries = mipMapEntries<N>(level);
+        for (size_t i = 0; i < entries; i++) {
+            // truncated, the same as makeWaveCycle()
+            double value = wave.values[i * (N / entries)] / peak;
+            table.values[offset + i] = (uint8_t)(long)(maxAmplitude * attenuation * (verticalOffset + value));
+        }
+        offset += entries;
+    }
+    return table;
+}
+
+/**
+ * @brief Builds one cycle of a sine wave as 8-bit DAC values:
+ *
+ *   value = maxAmplitude * attenuation * (verticalOffset + sin(2πi / N))
+ *
+ * with N = SAMPLES_PER_SECOND / FREQUENCY samples.
+ *
+ * @tparam FREQUENCY the output frequency in Hz
+ * @tparam SAMPLES_PER_SECOND the timer callback rate
+ * @param attenuation between 0.0 and 1.0 (check it with validAttenuation())
+ * @param maxAmplitude half of the DAC's peak-to-peak range (127 for 8 bits)
+ * @param verticalOffset 1.0 to avoid negative outputs
+ */
+template <long FREQUENCY, long SAMPLES_PER_SECOND>
+constexpr Table<uint8_t, (size_t)(SAMPLES_PER_SECOND / FREQUENCY)>
+makeSineTable(double attenuation, int maxAmplitude = 127, double verticalOffset = 1.0) {
+    static_assert(FREQUENCY > 0, "FREQUENCY must be positive");
+    static_assert(SAMPLES_PER_SECOND > 0, "SAMPLES_PER_SECOND must be positive");
+    static_assert(SAMPLES_PER_SECOND >= 2 * FREQUENCY,
+                  "SAMPLES_PER_SECOND must be at least 2 x FREQUENCY (Nyquist)");
+
+    return makeSineCycle<(size_t)(SAMPLES_PER_SECOND / FREQUENCY)>(attenuation, maxAmplitude, verticalOffset);
+}
+
+} // namespace wave_table
+
+#endif // WAVE_TABLE_H